@@ -19,7 +19,6 @@ private:
 	eType		type_;
 	int			hopcount_;
 	int 		source_socket_;
-	std::string	buff_;
 	time_t		last_msg_time_;
 	int 		token_;
 	time_t 		launch_time_;
@@ -33,7 +32,6 @@ public:
 	int 			socket				() const;
 	eType 			type				() const;
 	int 			hopcount			() const;
-	std::string&	buff				();
 	void			update_time			();
 	double			last_msg_time		() const;
 	int 			token				() const;
@@ -0,0 +1,125 @@
+
+#include "Admission.hpp"
+
+#include <netinet/in.h>
+#include <cstring>
+
+Admission::Admission() : max_per_ip_(0), rate_(0), burst_(1) {}
+
+size_t	Admission::KeyHash::operator()(const Key& key) const
+{
+	uint64_t hash = key.high * 0x9e3779b97f4a7c15ULL ^ key.low;
+	hash ^= hash >> 29;
+	hash *= 0xbf58476d1ce4e5b9ULL;
+	return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+/**
+ * @description	Sets limits, already open sockets keep their slots
+ * @param		max_per_ip: concurrent sockets of one address (0 is no cap)
+ * @param		rate: new connections of one address per second (0 is no throttling)
+ * @param		burst: connections an idle address can make at once
+ */
+void	Admission::configure(unsigned max_per_ip, double rate, unsigned burst)
+{
+	max_per_ip_ = max_per_ip;
+	rate_ = rate;
+	burst_ = (burst == 0) ? 1 : burst;
+}
+
+bool	Admission::make_key(const sockaddr* address, Key& key)
+{
+	unsigned char bytes[16];
+
+	if (address->sa_family == AF_INET)
+	{
+		memset(bytes, 0, 10);
+		bytes[10] = 0xff;
+		bytes[11] = 0xff;
+		memcpy(bytes + 12, &reinterpret_cast<const sockaddr_in*>(address)->sin_addr, 4);
+	}
+	else if (address->sa_family == AF_INET6)
+		memcpy(bytes, &reinterpret_cast<const sockaddr_in6*>(address)->sin6_addr, 16);
+	else
+		return false;
+	memcpy(&key.high, bytes, 8);
+	memcpy(&key.low, bytes + 8, 8);
+	return true;
+}
+
+void	Admission::refill(Peer& peer, unsigned long now) const
+{
+	if (rate_ <= 0 || now <= peer.refilled)
+		return;
+	peer.tokens += static_cast<double>(now - peer.refilled) * rate_ / 1e6;
+	if (peer.tokens > burst_)
+		peer.tokens = burst_;
+	peer.refilled = now;
+}
+
+/**
+ * @description	Decides whether accepted socket may stay and takes a slot for it
+ * @param		sock
+ * @param		address: peer address from accept()
+ * @param		now: monotonic time in microseconds
+ * @return		ADMIT_OK or the reason to close the socket
+ */
+eAdmission	Admission::admit(int sock, const sockaddr* address, unsigned long now)
+{
+	Key key;
+
+	if ((max_per_ip_ == 0 && rate_ <= 0) || !make_key(address, key))
+		return ADMIT_OK;
+	std::unordered_map<Key, Peer, KeyHash>::iterator it = peers_.find(key);
+	if (it == peers_.end())
+	{
+		Peer peer = { 0, burst_, now };
+		it = peers_.insert(std::make_pair(key, peer)).first;
+	}
+	Peer& peer = it->second;
+	if (max_per_ip_ != 0 && peer.sockets >= max_per_ip_)
+		return ADMIT_TOO_MANY;
+	if (rate_ > 0)
+	{
+		refill(peer, now);
+		if (peer.tokens < 1)
+			return ADMIT_TOO_FAST;
+		peer.tokens -= 1;
+	}
+	++peer.sockets;
+	sockets_[sock] = key;
+	return ADMIT_OK;
+}
+
+/**
+ * @description	Gives the slot of closed socket back
+ * @param		sock
+ */
+void	Admission::release(int sock)
+{
+	std::unordered_map<int, Key>::iterator it = sockets_.find(sock);
+	if (it == sockets_.end())
+		return;
+	std::unordered_map<Key, Peer, KeyHash>::iterator peer = peers_.find(it->second);
+	if (peer != peers_.end() && peer->second.sockets != 0)
+		--peer->second.sockets;
+	sockets_.erase(it);
+}
+
+/**
+ * @description	Forgets addresses without sockets whose bucket is full again
+ * @param		now: monotonic time in microseconds
+ */
+void	Admission::expire(unsigned long now)
+{
+	for (std::unordered_map<Key, Peer, KeyHash>::iterator it = peers_.begin(); it != peers_.end();)
+	{
+		refill(it->second, now);
+		if (it->second.sockets == 0 && (rate_ <= 0 || it->second.tokens >= burst_))
+			it = peers_.erase(it);
+		else
+			++it;
+	}
+}
+
+size_t	Admission::peers() const { return peers_.size(); }
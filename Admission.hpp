@@ -0,0 +1,65 @@
+
+#ifndef FT_IRC_ADMISSION_HPP
+#define FT_IRC_ADMISSION_HPP
+
+#include <sys/socket.h>
+#include <stdint.h>
+#include <unordered_map>
+
+enum eAdmission
+{
+	ADMIT_OK,
+	ADMIT_TOO_MANY,		// max-per-ip sockets are already open
+	ADMIT_TOO_FAST		// Token bucket of the address is empty
+};
+
+/**
+ * Per-address admission control for accepted sockets: a cap of concurrent
+ * sockets and a token bucket of new connections. Recent addresses live in a
+ * hash table, so admit() and release() are O(1) and entries are dropped by
+ * expire() once they have no sockets and a full bucket.
+ */
+class Admission
+{
+private:
+	struct Key
+	{
+		uint64_t	high;
+		uint64_t	low;	// IPv4 addresses are IPv4-mapped IPv6
+
+		bool	operator==(const Key& other) const { return high == other.high && low == other.low; }
+	};
+
+	struct KeyHash
+	{
+		size_t	operator()(const Key& key) const;
+	};
+
+	struct Peer
+	{
+		unsigned		sockets;
+		double			tokens;
+		unsigned long	refilled;	// Monotonic time of the last refill (microseconds)
+	};
+
+	std::unordered_map<Key, Peer, KeyHash>	peers_;
+	std::unordered_map<int, Key>			sockets_;	// Admitted sockets and their addresses
+	unsigned								max_per_ip_;	// 0 is no cap
+	double									rate_;			// Tokens per second, 0 is no throttling
+	double									burst_;
+
+	static bool	make_key	(const sockaddr* address, Key& key);
+	void		refill		(Peer& peer, unsigned long now) const;
+
+public:
+	Admission();
+
+	void		configure	(unsigned max_per_ip, double rate, unsigned burst);
+	eAdmission	admit		(int sock, const sockaddr* address, unsigned long now);
+	void		release		(int sock);
+	void		expire		(unsigned long now);
+
+	size_t		peers		() const;
+};
+
+#endif //FT_IRC_ADMISSION_HPP
@@ -0,0 +1,87 @@
+
+#include "Arena.hpp"
+
+#include <new>
+#include <stdint.h>
+
+Arena::Arena() : current_(0), offset_(0), used_(0), peak_(0), resets_(0) {}
+
+Arena::~Arena()
+{
+	for (size_t i = 0; i < blocks_.size(); ++i)
+		::operator delete(blocks_[i].data);
+}
+
+/**
+ * @description	Moves to the next block which can hold size bytes, skipped
+ * 				blocks stay unused until reset(). A new block is allocated if
+ * 				none fits (a big one for a request larger than ARENA_BLOCK)
+ * @param		size: bytes with alignment slack
+ */
+void	Arena::next_block(size_t size)
+{
+	size_t next = blocks_.empty() ? 0 : current_ + 1;
+	while (next < blocks_.size() && blocks_[next].size < size)
+		++next;
+	if (next == blocks_.size())
+	{
+		Block block;
+		block.size = (size > ARENA_BLOCK) ? size : ARENA_BLOCK;
+		block.data = static_cast<char*>(::operator new(block.size));
+		blocks_.push_back(block);
+	}
+	current_ = next;
+	offset_ = 0;
+}
+
+/**
+ * @description	Takes memory from the current block
+ * @param		size: bytes
+ * @param		align: power of two
+ * @return		memory valid until reset()
+ */
+void*	Arena::allocate(size_t size, size_t align)
+{
+	if (size == 0)
+		size = 1;
+	if (blocks_.empty() || offset_ + size + align - 1 > blocks_[current_].size)
+		next_block(size + align - 1);
+	char*	base	= blocks_[current_].data;
+	size_t	begin	= (reinterpret_cast<uintptr_t>(base + offset_) + align - 1) & ~(align - 1);
+	char*	ptr		= reinterpret_cast<char*>(begin);
+	offset_ = ptr - base + size;
+	used_ += size;
+	if (used_ > peak_)
+		peak_ = used_;
+	return ptr;
+}
+
+/**
+ * @description	Makes every block empty again (called once per loop iteration),
+ * 				blocks above ARENA_KEEP go back to the heap after a spike
+ */
+void	Arena::reset()
+{
+	while (blocks_.size() > ARENA_KEEP)
+	{
+		::operator delete(blocks_.back().data);
+		blocks_.pop_back();
+	}
+	current_ = 0;
+	offset_ = 0;
+	used_ = 0;
+	++resets_;
+}
+
+size_t			Arena::used		() const { return used_; }
+size_t			Arena::peak		() const { return peak_; }
+size_t			Arena::blocks	() const { return blocks_.size(); }
+unsigned long	Arena::resets	() const { return resets_; }
+
+size_t	Arena::capacity() const
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < blocks_.size(); ++i)
+		bytes += blocks_[i].size;
+	return bytes;
+}
@@ -0,0 +1,90 @@
+
+#ifndef FT_IRC_ARENA_HPP
+#define FT_IRC_ARENA_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#define ARENA_BLOCK		65536	// Bytes of one arena block
+#define ARENA_KEEP		16		// Blocks kept by reset(), the rest go back to the heap
+
+/**
+ * Monotonic allocator for temporaries of one loop iteration: allocate() only
+ * bumps an offset in the current block and nothing is freed until reset(),
+ * which makes all blocks empty again at once. Handlers build their temporary
+ * strings and vectors here instead of the global heap. Nothing allocated
+ * from the arena may outlive the iteration.
+ */
+class Arena
+{
+private:
+	struct Block
+	{
+		char*	data;
+		size_t	size;
+	};
+
+	std::vector<Block>	blocks_;
+	size_t				current_;	// Block being carved
+	size_t				offset_;	// Bytes taken from the current block
+	size_t				used_;		// Bytes handed out since the last reset
+	size_t				peak_;
+	unsigned long		resets_;
+
+	void	next_block	(size_t size);
+
+	/// Unused constructors
+	Arena(const Arena& other);
+	Arena& operator=(const Arena& other);
+
+public:
+	Arena();
+	~Arena();
+
+	void*	allocate	(size_t size, size_t align);
+	void	reset		();
+
+	size_t			used		() const;
+	size_t			capacity	() const;
+	size_t			peak		() const;
+	size_t			blocks		() const;
+	unsigned long	resets		() const;
+};
+
+/**
+ * Standard allocator taking memory from an Arena, deallocate() does nothing
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T	value_type;
+
+	Arena*	arena_;
+
+	ArenaAllocator(Arena& arena) : arena_(&arena) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) {}
+
+	T*		allocate	(size_t n)		{ return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T))); }
+	void	deallocate	(T*, size_t)	{}
+
+	template <typename U>
+	struct rebind
+	{
+		typedef ArenaAllocator<U>	other;
+	};
+};
+
+template <typename T, typename U>
+bool	operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena_ == b.arena_; }
+template <typename T, typename U>
+bool	operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena_ != b.arena_; }
+
+/// Handler temporaries: ScratchString line(scratch_), ScratchVector<std::string> targets(scratch_)
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char> >	ScratchString;
+template <typename T>
+using ScratchVector = std::vector<T, ArenaAllocator<T> >;
+
+#endif //FT_IRC_ARENA_HPP
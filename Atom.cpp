@@ -0,0 +1,101 @@
+
+#include "Atom.hpp"
+
+#include <functional>
+#include <unordered_map>
+
+typedef std::unordered_map<std::string, Atom::Entry>	SymbolTable;
+
+static SymbolTable& table()
+{
+	static SymbolTable* symbols = new SymbolTable;	// Never destroyed: atoms may outlive statics
+	return *symbols;
+}
+
+static size_t			g_bytes = 0;		// Text bytes of all symbols
+static unsigned long	g_references = 0;	// Atoms pointing to symbols
+
+static const std::string	g_empty;
+
+/**
+ * @description	Finds symbol of text or adds it, and takes a reference
+ * @param		text: not empty
+ * @return		symbol with the text
+ */
+Atom::Symbol*	Atom::intern(const std::string& text)
+{
+	SymbolTable& symbols = table();
+	SymbolTable::iterator it = symbols.find(text);
+	if (it == symbols.end())
+	{
+		Entry entry = { std::hash<std::string>()(text), 0 };
+		it = symbols.insert(std::make_pair(text, entry)).first;
+		g_bytes += text.size();
+	}
+	++it->second.refs;
+	++g_references;
+	return &*it;
+}
+
+/**
+ * @description	Drops the reference, the last one erases the symbol
+ */
+void	Atom::release()
+{
+	if (symbol_ == nullptr)
+		return;
+	--g_references;
+	if (--symbol_->second.refs == 0)
+	{
+		g_bytes -= symbol_->first.size();
+		table().erase(symbol_->first);
+	}
+	symbol_ = nullptr;
+}
+
+Atom::Atom() : symbol_(nullptr) {}
+
+Atom::Atom(const std::string& text) : symbol_(text.empty() ? nullptr : intern(text)) {}
+
+Atom::Atom(const Atom& other) : symbol_(other.symbol_)
+{
+	if (symbol_ != nullptr)
+	{
+		++symbol_->second.refs;
+		++g_references;
+	}
+}
+
+Atom::~Atom() { release(); }
+
+Atom&	Atom::operator=(const Atom& other)
+{
+	if (symbol_ == other.symbol_)
+		return *this;
+	release();
+	symbol_ = other.symbol_;
+	if (symbol_ != nullptr)
+	{
+		++symbol_->second.refs;
+		++g_references;
+	}
+	return *this;
+}
+
+Atom&	Atom::operator=(const std::string& text)
+{
+	if (symbol_ != nullptr && symbol_->first == text)
+		return *this;
+	Symbol* symbol = text.empty() ? nullptr : intern(text);	// Before release(): text may be our own symbol
+	release();
+	symbol_ = symbol;
+	return *this;
+}
+
+const std::string&	Atom::str	() const { return (symbol_ == nullptr) ? g_empty : symbol_->first; }
+size_t				Atom::hash	() const { return (symbol_ == nullptr) ? 0 : symbol_->second.hash; }
+bool				Atom::empty	() const { return symbol_ == nullptr; }
+
+size_t			Atom::symbols	() { return table().size(); }
+size_t			Atom::bytes		() { return g_bytes; }
+unsigned long	Atom::references() { return g_references; }
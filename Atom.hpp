@@ -0,0 +1,61 @@
+
+#ifndef FT_IRC_ATOM_HPP
+#define FT_IRC_ATOM_HPP
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Interned string for nicks, hosts, server and channel names. Equal texts
+ * share one refcounted entry of the symbol table, so a copy is a pointer and
+ * a counter, equality is a pointer comparison and the hash is computed once.
+ * The entry is freed with its last Atom. The symbol table isn't thread-safe
+ * (neither is the rest of the server).
+ */
+class Atom
+{
+public:
+	struct Entry
+	{
+		size_t		hash;
+		unsigned	refs;
+	};
+
+private:
+	typedef std::pair<const std::string, Entry>	Symbol;
+
+	Symbol*	symbol_;	// nullptr for the empty string
+
+	static Symbol*	intern	(const std::string& text);
+	void			release	();
+
+public:
+	Atom();
+	explicit Atom(const std::string& text);
+	Atom(const Atom& other);
+	~Atom();
+
+	Atom&	operator=	(const Atom& other);
+	Atom&	operator=	(const std::string& text);
+
+	bool	operator==	(const Atom& other) const { return symbol_ == other.symbol_; }
+	bool	operator!=	(const Atom& other) const { return symbol_ != other.symbol_; }
+
+	const std::string&	str		() const;
+	size_t				hash	() const;
+	bool				empty	() const;
+
+	operator const std::string&	() const { return str(); }
+
+	static size_t			symbols		();
+	static size_t			bytes		();
+	static unsigned long	references	();
+};
+
+/// Hasher for unordered containers keyed by atoms
+struct AtomHash
+{
+	size_t	operator()(const Atom& atom) const { return atom.hash(); }
+};
+
+#endif //FT_IRC_ATOM_HPP
@@ -1,6 +1,19 @@
 #include "Channel.hpp"
 
-Channel::Channel(const std::string &name) : name_(name), max_users_(0){
+SlabPool &Channel::pool() {
+    static SlabPool *pool = new SlabPool("Channel", sizeof(Channel));
+    return *pool;
+}
+
+void *Channel::operator new(size_t size) {
+    return pool().allocate(size);
+}
+
+void Channel::operator delete(void *ptr, size_t size) {
+    pool().release(ptr, size);
+}
+
+Channel::Channel(const std::string &name) : name_(name), max_users_(0), topic_time_(0), created_(get_time()), names_width_(0){
 //    mode_.insert(std::pair<char, int>('O', 0)); //give "channel creator" status
     mode_.insert(std::pair<char, int>('o', 0)); //give/take channel operator privileges
     mode_.insert(std::pair<char, int>('v', 0)); //give/take the voice privilege
@@ -15,9 +28,9 @@ Channel::Channel(const std::string &name) : name_(name), max_users_(0){
     mode_.insert(std::pair<char, int>('t', 1)); //toggle the topic settable by channel operator only flag
     mode_.insert(std::pair<char, int>('k', 0)); //set/remove the channel key (password)
     mode_.insert(std::pair<char, int>('l', 0)); //set/remove the user limit to channel
-//    mode_.insert(std::pair<char, int>('b', 0)); //set/remove ban mask to keep users out
-//    mode_.insert(std::pair<char, int>('e', 0)); //set/remove an exception mask to override a ban mask
-//    mode_.insert(std::pair<char, int>('I', 0)); //set/remove an invitation mask to automatically override the invite-only flag
+    mode_.insert(std::pair<char, int>('b', 0)); //set/remove ban mask to keep users out
+    mode_.insert(std::pair<char, int>('e', 0)); //set/remove an exception mask to override a ban mask
+    mode_.insert(std::pair<char, int>('I', 0)); //set/remove an invitation mask to automatically override the invite-only flag
 }
 
 Channel::~Channel() {
@@ -30,6 +43,15 @@ const std::string &Channel::getTopic() const {
 
 void Channel::setTopic(const std::string &topic_msg) {
     topic_ = topic_msg;
+    topic_time_ = get_time();
+}
+
+time_t Channel::getTopicTime() const {
+    return topic_time_;
+}
+
+time_t Channel::getCreationTime() const {
+    return created_;
 }
 
 const std::map<char, int> &Channel::getMode() const {
@@ -59,6 +81,10 @@ void Channel::addUser(User* user) {
         itr++;
     }
     users_.push_back(user);
+    if (!isOperator(user) && !isModerator(user))
+        appendName(user->nick());
+    else
+        invalidateNames();
 }
 
 void Channel::delUser(User* user) {
@@ -67,11 +93,30 @@ void Channel::delUser(User* user) {
 
     while (itr != ite){
         if (*itr == user){
+            if (isOperator(user))
+                removeName("@" + user->nick());
+            else if (isModerator(user))
+                removeName("+" + user->nick());
+            else
+                removeName(user->nick());
             users_.erase(itr);
             break;
         }
         itr++;
     }
+    // Status doesn't outlive membership, otherwise a quit leaves dangling pointers here
+    for (itr = operators_.begin(); itr != operators_.end(); ++itr){
+        if (*itr == user){
+            operators_.erase(itr);
+            break;
+        }
+    }
+    for (itr = moderator_users_.begin(); itr != moderator_users_.end(); ++itr){
+        if (*itr == user){
+            moderator_users_.erase(itr);
+            break;
+        }
+    }
 }
 
 void Channel::setType(const char type) {
@@ -89,6 +134,7 @@ void Channel::addOperators(User* oper) {
         itr++;
     }
     operators_.push_back(oper);
+    invalidateNames();
 }
 
 void Channel::delOperators(User* oper) {
@@ -98,6 +144,7 @@ void Channel::delOperators(User* oper) {
     while (itr != ite){
         if (*itr == oper){
             operators_.erase(itr);
+            invalidateNames();
             break;
         }
         itr++;
@@ -110,78 +157,117 @@ const std::vector<User *> &Channel::getOperators() const {
     return operators_;
 }
 
-std::string Channel::getListUsers() {
-    std::string list_users;
-    ITERATOR itr = operators_.begin();
-    ITERATOR ite = operators_.end();
-    while (itr != ite){
-        list_users.append("@" + (*itr)->nick() + " ");
-        itr++;
+// Segments are patched on join/part and rebuilt after status or nick changes,
+// so a JOIN into a big channel doesn't re-render the whole member list
+const std::vector<std::string> &Channel::getNames(size_t width) {
+    if (width == names_width_)
+        return names_;
+    names_.clear();
+    names_width_ = width;
+    ITERATOR itr;
+    for (itr = operators_.begin(); itr != operators_.end(); ++itr)
+        appendName("@" + (*itr)->nick());
+    for (itr = moderator_users_.begin(); itr != moderator_users_.end(); ++itr){
+        if (!isOperator(*itr))
+            appendName("+" + (*itr)->nick());
     }
-    itr = moderator_users_.begin();
-    ite = moderator_users_.end();
-    while (itr != ite){
-        list_users.append("+" + (*itr)->nick() + " ");
-        itr++;
+    for (itr = users_.begin(); itr != users_.end(); ++itr){
+        if (!isOperator(*itr) && !isModerator(*itr))
+            appendName((*itr)->nick());
     }
-    ITERATOR itr_u = users_.begin();
-    ITERATOR ite_u = users_.end();
-    while (itr_u != ite_u){
-        itr = operators_.begin();
-        ite = operators_.end();
-        while (itr != ite){
-            if ((*itr) == (*itr_u))
+    return names_;
+}
+
+void Channel::invalidateNames() {
+    names_.clear();
+    names_width_ = 0;
+}
+
+void Channel::appendName(const std::string &token) {
+    if (names_width_ == 0)
+        return;
+    if (names_.empty() || names_.back().size() + 1 + token.size() > names_width_)
+        names_.push_back(token);
+    else
+        names_.back().append(" " + token);
+}
+
+void Channel::removeName(const std::string &token) {
+    if (names_width_ == 0)
+        return;
+    // Search from the end, recent joiners are the most likely to leave
+    for (size_t i = names_.size(); i-- > 0;){
+        std::string &segment = names_[i];
+        size_t pos = segment.rfind(token);
+        while (pos != std::string::npos){
+            size_t end = pos + token.size();
+            if ((pos == 0 || segment[pos - 1] == ' ') && (end == segment.size() || segment[end] == ' ')){
+                if (segment.size() == token.size())
+                    names_.erase(names_.begin() + i);
+                else if (end == segment.size())
+                    segment.erase(pos - 1, token.size() + 1);
+                else
+                    segment.erase(pos, token.size() + 1);
+                return;
+            }
+            if (pos == 0)
                 break;
-            itr++;
+            pos = segment.rfind(token, pos - 1);
         }
-        if (itr == ite)
-            list_users.append((*itr_u)->nick() + " ");
-        itr_u++;
     }
-    list_users.erase(list_users.size() - 1);
-    return list_users;
+    invalidateNames(); // Not found, cache is out of sync
 }
 
 const std::string &Channel::getKey() const {
     return key_;
 }
 
-void Channel::addBanUser(User *user) {
-    ITERATOR itr = ban_users_.begin();
-    ITERATOR ite = ban_users_.end();
+MaskSet *Channel::maskList(char list) {
+    if (list == 'b')
+        return &bans_;
+    if (list == 'e')
+        return &exceptions_;
+    if (list == 'I')
+        return &invites_;
+    return nullptr;
+}
 
-    while (itr != ite){
-        if (*itr == user){
-            return;
-        }
-        itr++;
-    }
-    itr = users_.begin();
-    ite = users_.end();
-    while (itr != ite){
-        if (*itr == user){
-            users_.erase(itr);
-        }
-        itr++;
-    }
-    ban_users_.push_back(user);
+bool Channel::addMask(char list, const std::string &mask, const std::string &setter) {
+    MaskSet* masks = maskList(list);
+    if (masks == nullptr || masks->size() >= MASK_LIST_MAX)
+        return false;
+    return masks->add(mask, setter, get_time());
+}
+
+bool Channel::delMask(char list, const std::string &mask) {
+    MaskSet* masks = maskList(list);
+    if (masks == nullptr)
+        return false;
+    return masks->remove(mask);
+}
+
+const MaskSet &Channel::getMasks(char list) const {
+    if (list == 'e')
+        return exceptions_;
+    if (list == 'I')
+        return invites_;
+    return bans_;
+}
+
+bool Channel::isBanned(const std::string &prefix) const {
+    return bans_.match(prefix) && !exceptions_.match(prefix);
 }
 
-void Channel::delBanUser(User *user) {
-    ITERATOR itr = ban_users_.begin();
-    ITERATOR ite = ban_users_.end();
+bool Channel::isInvited(User *user, const std::string &prefix) const {
+    CITERATOR itr = invite_users_.begin();
+    CITERATOR ite = invite_users_.end();
 
     while (itr != ite){
-        if (*itr == user){
-            users_.erase(itr);
-            break;
-        }
+        if (*itr == user)
+            return true;
         itr++;
     }
-}
-
-const std::vector<User *> &Channel::getBanUsers() const {
-    return ban_users_;
+    return invites_.match(prefix);
 }
 
 void Channel::addInviteUser(User *user) {
@@ -229,6 +315,7 @@ void Channel::addModeratorUser(User *user) {
         itr++;
     }
     moderator_users_.push_back(user);
+    invalidateNames();
 }
 
 void Channel::delModeratorUser(User *user) {
@@ -238,6 +325,7 @@ void Channel::delModeratorUser(User *user) {
     while (itr != ite){
         if (*itr == user){
             moderator_users_.erase(itr);
+            invalidateNames();
             break;
         }
         itr++;
@@ -301,6 +389,10 @@ bool Channel::isModerator(User *user)
 }
 
 const std::string &Channel::getName() const {
+    return name_.str();
+}
+
+const Atom &Channel::getNameAtom() const {
     return name_;
 }
 
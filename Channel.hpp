@@ -4,6 +4,9 @@
 #include "Irisha.hpp"
 #include <string>
 #include "User.hpp"
+#include "MaskSet.hpp"
+#include "Atom.hpp"
+#include "SlabPool.hpp"
 
 #define ITERATOR std::vector<User*>::iterator
 #define CITERATOR std::vector<User*>::const_iterator
@@ -12,24 +15,38 @@ class Channel
 private:
 	std::map<char, int> mode_;
 	char                type_;
-	std::string         name_;
+	Atom                name_;
 	int                 max_users_;
 	std::string         topic_;
+	time_t              topic_time_;	// When topic was set, 0 if never
+	time_t              created_;
 	std::string         key_;
 	std::vector<User*>  users_;
 	std::vector<User*>  operators_;
-	std::vector<User*>  ban_users_;
+	MaskSet             bans_;
+	MaskSet             exceptions_;
+	MaskSet             invites_;	// Invitation masks, invite_users_ are from INVITE
 	std::vector<User*>  moderator_users_;
 	std::vector<User*>  invite_users_;
+	std::vector<std::string> names_;	// NAMES list split into 353 segments
+	size_t              names_width_;	// Segment width names_ is built for, 0 if stale
+
+	void appendName(const std::string &token);
+	void removeName(const std::string &token);
+	MaskSet *maskList(char list);
 public:
 	Channel(const std::string &name);
 
+	static SlabPool &pool();
+	static void *operator new(size_t size);
+	static void operator delete(void *ptr, size_t size);
+
 	void setTopic(const std::string &topic_msg);
 	void setMode(const char c, int mode);
 	void setKey(const std::string &key_msg);
 	void setType(const char type);
-	void addBanUser(User* user);
-	void delBanUser(User* user);
+	bool addMask(char list, const std::string &mask, const std::string &setter);
+	bool delMask(char list, const std::string &mask);
 	void addUser(User* user);
 	void delUser(User* user);
 	void addOperators(User* oper);
@@ -42,17 +59,23 @@ public:
 	const std::string &getTopic() const;
 	const std::string &getKey() const;
 	const std::string &getName() const;
+	const Atom &getNameAtom() const;
 	const std::map<char, int> &getMode() const;
 	const std::vector<User*> &getUsers() const;
 	const std::vector<User*> &getOperators() const;
-	const std::vector<User*> &getBanUsers() const;
+	const MaskSet &getMasks(char list) const;
 	const std::vector<User*> &getInviteUsers() const;
 	const std::vector<User*> &getModerators() const;
 	const int &getMaxUsers() const;
-	std::string getListUsers();
+	time_t getTopicTime() const;
+	time_t getCreationTime() const;
+	const std::vector<std::string> &getNames(size_t width);
+	void invalidateNames();
 	std::string getListMode();
 	bool isOperator(User* user);
 	bool isUser(User* user);
 	bool isModerator(User* user);
+	bool isBanned(const std::string &prefix) const;
+	bool isInvited(User* user, const std::string &prefix) const;
 	~Channel();
 };
\ No newline at end of file
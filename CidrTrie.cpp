@@ -0,0 +1,211 @@
+
+#include "CidrTrie.hpp"
+#include "utils.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <cstdlib>
+#include <cstring>
+
+CidrTrie::CidrTrie()
+{
+	clear();
+}
+
+/**
+ * @description	Parses "a.b.c.d[/n]" or "x:y::z[/n]", host bits are cleared
+ * @param		cidr
+ * @param		address: IPv6 or IPv4-mapped address
+ * @param		bits: prefix length in the 128 bit space
+ * @return		false if cidr is malformed
+ */
+bool	CidrTrie::parse(const std::string& cidr, uint8_t address[16], int& bits)
+{
+	size_t		slash	= cidr.find('/');
+	std::string	ip		= cidr.substr(0, slash);
+	bool		ipv6	= (ip.find(':') != std::string::npos);
+	int			max		= ipv6 ? 128 : 32;
+
+	if (ipv6)
+	{
+		if (inet_pton(AF_INET6, ip.c_str(), address) != 1)
+			return false;
+	}
+	else
+	{
+		uint8_t ipv4[4];
+		if (inet_pton(AF_INET, ip.c_str(), ipv4) != 1)
+			return false;
+		map_ipv4(ipv4, address);
+	}
+	bits = max;
+	if (slash != std::string::npos)
+	{
+		std::string length = cidr.substr(slash + 1);
+		if (length.empty() || length.size() > 3 || length.find_first_not_of("0123456789") != std::string::npos)
+			return false;
+		bits = atoi(length.c_str());
+		if (bits > max)
+			return false;
+	}
+	if (!ipv6)
+		bits += 96;
+	for (int i = bits; i < 128; ++i)
+		address[i / 8] &= static_cast<uint8_t>(~(0x80 >> (i % 8)));
+	return true;
+}
+
+void	CidrTrie::map_ipv4(const uint8_t ipv4[4], uint8_t address[16])
+{
+	memset(address, 0, 10);
+	address[10] = 0xff;
+	address[11] = 0xff;
+	memcpy(address + 12, ipv4, 4);
+}
+
+int		CidrTrie::bit(const uint8_t address[16], int index)
+{
+	return (address[index / 8] >> (7 - index % 8)) & 1;
+}
+
+/**
+ * @description	Makes canonical text of network (IPv4 ones in dotted form)
+ */
+std::string	CidrTrie::format(const uint8_t address[16], int bits)
+{
+	static const uint8_t	mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+	char					text[INET6_ADDRSTRLEN];
+
+	if (bits >= 96 && memcmp(address, mapped, 12) == 0)
+	{
+		inet_ntop(AF_INET, address + 12, text, sizeof(text));
+		bits -= 96;
+	}
+	else
+		inet_ntop(AF_INET6, address, text, sizeof(text));
+	return std::string(text) + "/" + int_to_str(bits);
+}
+
+/**
+ * @description	Adds network with rule
+ * @param		cidr: "192.0.2.0/24", "2001:db8::/32" or a single address
+ * @param		rule: CIDR_BAN or CIDR_EXEMPT
+ * @return		false if cidr is malformed
+ */
+bool	CidrTrie::add(const std::string& cidr, eCidrRule rule)
+{
+	uint8_t	address[16];
+	int		bits;
+
+	if (!parse(cidr, address, bits))
+		return false;
+	uint32_t node = 0;
+	for (int i = 0; i < bits; ++i)
+	{
+		int b = bit(address, i);
+		if (nodes_[node].child[b] == 0)
+		{
+			Node leaf = { { 0, 0 }, 0 };
+			nodes_.push_back(leaf);
+			nodes_[node].child[b] = static_cast<uint32_t>(nodes_.size() - 1);
+		}
+		node = nodes_[node].child[b];
+	}
+	nodes_[node].rules |= static_cast<uint8_t>(rule);
+	networks_[format(address, bits)] |= static_cast<uint8_t>(rule);
+	return true;
+}
+
+/**
+ * @description	Removes rule of network, its nodes stay for reuse until clear()
+ * @param		cidr
+ * @param		rule
+ * @return		false if there was no such rule
+ */
+bool	CidrTrie::remove(const std::string& cidr, eCidrRule rule)
+{
+	uint8_t	address[16];
+	int		bits;
+
+	if (!parse(cidr, address, bits))
+		return false;
+	uint32_t node = 0;
+	for (int i = 0; i < bits; ++i)
+	{
+		node = nodes_[node].child[bit(address, i)];
+		if (node == 0)
+			return false;
+	}
+	if (!(nodes_[node].rules & rule))
+		return false;
+	nodes_[node].rules &= static_cast<uint8_t>(~rule);
+	std::string text = format(address, bits);
+	if ((networks_[text] &= static_cast<uint8_t>(~rule)) == 0)
+		networks_.erase(text);
+	return true;
+}
+
+void	CidrTrie::clear()
+{
+	Node root = { { 0, 0 }, 0 };
+	nodes_.assign(1, root);
+	networks_.clear();
+}
+
+/**
+ * @description	Collects rules of every network on the path of address
+ */
+eCidrRule	CidrTrie::walk(const uint8_t address[16]) const
+{
+	uint32_t	node	= 0;
+	uint8_t		rules	= nodes_[0].rules;
+
+	for (int i = 0; i < 128; ++i)
+	{
+		node = nodes_[node].child[bit(address, i)];
+		if (node == 0)
+			break;
+		rules |= nodes_[node].rules;
+	}
+	if (rules & CIDR_EXEMPT)
+		return CIDR_EXEMPT;
+	return (rules & CIDR_BAN) ? CIDR_BAN : CIDR_NONE;
+}
+
+/**
+ * @description	Checks address of accepted socket
+ * @param		address: sockaddr_in or sockaddr_in6
+ * @return		CIDR_EXEMPT, CIDR_BAN or CIDR_NONE
+ */
+eCidrRule	CidrTrie::lookup(const sockaddr* address) const
+{
+	uint8_t bytes[16];
+
+	if (nodes_.size() == 1 && nodes_[0].rules == 0)
+		return CIDR_NONE;
+	if (address->sa_family == AF_INET)
+		map_ipv4(reinterpret_cast<const uint8_t*>(&reinterpret_cast<const sockaddr_in*>(address)->sin_addr), bytes);
+	else if (address->sa_family == AF_INET6)
+		memcpy(bytes, &reinterpret_cast<const sockaddr_in6*>(address)->sin6_addr, 16);
+	else
+		return CIDR_NONE;
+	return walk(bytes);
+}
+
+/**
+ * @description	Checks textual address
+ * @param		ip
+ * @return		CIDR_EXEMPT, CIDR_BAN or CIDR_NONE (also for malformed ip)
+ */
+eCidrRule	CidrTrie::lookup(const std::string& ip) const
+{
+	uint8_t	bytes[16];
+	int		bits;
+
+	if (!parse(ip, bytes, bits))
+		return CIDR_NONE;
+	return walk(bytes);
+}
+
+size_t									CidrTrie::size		() const { return networks_.size(); }
+const std::map<std::string, uint8_t>&	CidrTrie::networks	() const { return networks_; }
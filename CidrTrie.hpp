@@ -0,0 +1,55 @@
+
+#ifndef FT_IRC_CIDRTRIE_HPP
+#define FT_IRC_CIDRTRIE_HPP
+
+#include <sys/socket.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+enum eCidrRule
+{
+	CIDR_NONE	= 0,
+	CIDR_BAN	= 1,
+	CIDR_EXEMPT	= 2
+};
+
+/**
+ * Binary radix trie of IPv4 and IPv6 networks. IPv4 addresses are stored as
+ * IPv4-mapped IPv6 (::ffff:a.b.c.d), so both families share one tree and a
+ * lookup is at most 128 steps without any allocation. An exemption anywhere
+ * on the path of an address wins over bans.
+ */
+class CidrTrie
+{
+private:
+	struct Node
+	{
+		uint32_t	child[2];	// Node indexes, 0 is none (the root is never a child)
+		uint8_t		rules;		// eCidrRule bits of the network ending here
+	};
+
+	std::vector<Node>					nodes_;
+	std::map<std::string, uint8_t>		networks_;	// Canonical text -> rules, for listing
+
+	static bool		parse		(const std::string& cidr, uint8_t address[16], int& bits);
+	static void		map_ipv4	(const uint8_t ipv4[4], uint8_t address[16]);
+	static int		bit			(const uint8_t address[16], int index);
+	static std::string	format	(const uint8_t address[16], int bits);
+	eCidrRule		walk		(const uint8_t address[16]) const;
+
+public:
+	CidrTrie();
+
+	bool			add			(const std::string& cidr, eCidrRule rule);
+	bool			remove		(const std::string& cidr, eCidrRule rule);
+	void			clear		();
+	eCidrRule		lookup		(const sockaddr* address) const;
+	eCidrRule		lookup		(const std::string& ip) const;
+
+	size_t									size		() const;
+	const std::map<std::string, uint8_t>&	networks	() const;
+};
+
+#endif //FT_IRC_CIDRTRIE_HPP
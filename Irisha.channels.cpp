@@ -0,0 +1,226 @@
+
+#include "Irisha.hpp"
+#include "Channel.hpp"
+#include "User.hpp"
+#include "utils.hpp"
+
+/**
+ * @description	Registers new channel
+ * @param		channel
+ */
+void Irisha::add_channel(Channel* channel)
+{
+	channels_.insert(std::pair<std::string, Channel*>(channel->getName(), channel));
+	channels_by_users_.insert(std::make_pair(channel->getUsers().size(), channel));
+}
+
+/**
+ * @description	Unregisters and deletes channel
+ * @param		channel
+ */
+void Irisha::remove_channel(Channel* channel)
+{
+	channels_by_users_.erase(std::make_pair(channel->getUsers().size(), channel));
+	channels_.erase(channel->getName());
+	delete channel;
+}
+
+/**
+ * @description	Adds user to channel and keeps member count index up to date
+ * @param		channel
+ * @param		user
+ */
+void Irisha::join_channel(Channel* channel, User* user)
+{
+	size_t before = channel->getUsers().size();
+	channel->addUser(user);
+	user->set_channel(channel->getNameAtom());
+	reindex_channel(channel, before);
+}
+
+/**
+ * @description	Removes user from channel, empty channel is deleted
+ * @param		channel
+ * @param		user
+ * @return		true if channel was deleted
+ */
+bool Irisha::part_channel(Channel* channel, User* user)
+{
+	size_t before = channel->getUsers().size();
+	channel->delUser(user);
+	user->del_channel(channel->getNameAtom());
+	if (channel->getUsers().empty())
+	{
+		channels_by_users_.erase(std::make_pair(before, channel));
+		channels_.erase(channel->getName());
+		delete channel;
+		return true;
+	}
+	reindex_channel(channel, before);
+	return false;
+}
+
+/**
+ * @description	Moves channel in member count index
+ * @param		channel
+ * @param		before: member count channel is indexed with
+ */
+void Irisha::reindex_channel(Channel* channel, size_t before)
+{
+	size_t after = channel->getUsers().size();
+	if (after == before)
+		return;
+	channels_by_users_.erase(std::make_pair(before, channel));
+	channels_by_users_.insert(std::make_pair(after, channel));
+}
+
+/**
+ * @description	Adds or removes a mask of +b, +e or +I list
+ * @param		channel
+ * @param		list: 'b', 'e' or 'I'
+ * @param		add: true for +, false for -
+ * @param		mask: completed to nick!user@host form in place
+ * @param		setter: nick or server
+ * @return		true if the list changed
+ */
+bool Irisha::set_list_mode(Channel* channel, char list, bool add, std::string& mask, const std::string& setter)
+{
+	mask = MaskSet::normalize(mask);
+	if (add)
+		return channel->addMask(list, mask, setter);
+	return channel->delMask(list, mask);
+}
+
+/**
+ * @description	Sends +b, +e or +I list of channel in one batch
+ * @param		user: local receiver
+ * @param		channel
+ * @param		list: 'b', 'e' or 'I'
+ */
+void Irisha::send_mask_list(User* user, const Channel* channel, char list) const
+{
+	typedef std::map<std::string, MaskEntry>::const_iterator entry_it;
+	eReply		item	= RPL_BANLIST;
+	eReply		end		= RPL_ENDOFBANLIST;
+	std::string	text	= "ban";
+	std::string	batch;
+
+	if (list == 'e')
+	{
+		item = RPL_EXCEPTLIST;
+		end = RPL_ENDOFEXCEPTLIST;
+		text = "exception";
+	}
+	else if (list == 'I')
+	{
+		item = RPL_INVITELIST;
+		end = RPL_ENDOFINVITELIST;
+		text = "invite";
+	}
+	const std::map<std::string, MaskEntry>& entries = channel->getMasks(list).entries();
+	for (entry_it itr = entries.begin(); itr != entries.end(); ++itr)
+		batch_rpl(batch, item, user->nick(), channel->getName() + " " + itr->second.text + " " + itr->second.setter
+				  + " " + ulong_to_str(static_cast<unsigned long>(itr->second.time)));
+	batch_rpl(batch, end, user->nick(), channel->getName() + " :End of channel " + text + " list");
+	queue_msg(user->socket(), batch);
+}
+
+/**
+ * @description	Steps LIST source to the next channel
+ * @param		query
+ * @return		channel or nullptr if source is over
+ */
+Channel* Irisha::next_list_channel(ListQuery& query)
+{
+	if (query.source == LS_NAMES)
+	{
+		while (query.next_index < query.names.size())
+		{
+			std::map<std::string, Channel*>::iterator it = channels_.find(query.names[query.next_index++]);
+			if (it != channels_.end())
+				return it->second;
+		}
+		return nullptr;
+	}
+	if (query.source == LS_BY_USERS)
+	{
+		std::set<std::pair<size_t, Channel*> >::iterator it;
+		if (query.started)
+			it = channels_by_users_.upper_bound(query.next_users);
+		else
+			it = channels_by_users_.lower_bound(std::make_pair(query.min_users, static_cast<Channel*>(nullptr)));
+		query.started = true;
+		if (it == channels_by_users_.end() || it->first > query.max_users)
+			return nullptr;
+		query.next_users = *it;
+		return it->second;
+	}
+	std::map<std::string, Channel*>::iterator it;
+	it = query.started ? channels_.upper_bound(query.next_name) : channels_.begin();
+	query.started = true;
+	if (it == channels_.end())
+		return nullptr;
+	query.next_name = it->first;
+	return it->second;
+}
+
+/**
+ * @description	Sends the next part of LIST reply: stops when the client sendq
+ * 				is LIST_SENDQ_LIMIT deep or LIST_SCAN_BATCH channels were examined
+ * @param		sock: client socket
+ * @param		query
+ * @return		true if the list is complete (RPL_LISTEND is sent)
+ */
+bool Irisha::continue_list(int sock, ListQuery& query)
+{
+	std::map<int, Link>::iterator link = links_.find(sock);
+	if (link == links_.end())
+		return true;
+	for (size_t scanned = 0; scanned < LIST_SCAN_BATCH; ++scanned)
+	{
+		if (link->second.sendq() >= LIST_SENDQ_LIMIT)
+			return false;
+		Channel* channel = next_list_channel(query);
+		if (channel == nullptr)
+		{
+			rpl_listend(sock, query.user->nick());
+			return true;
+		}
+		if (channel->getMode().find('s')->second == 1 && !channel->isUser(query.user))
+			continue;
+		if (query.matches(channel))
+			rpl_list(sock, channel, query.user->nick());
+	}
+	return false;
+}
+
+/**
+ * @description	Continues LIST replies that didn't fit in previous iterations
+ */
+void Irisha::continue_lists()
+{
+	std::map<int, ListQuery>::iterator it = list_queries_.begin();
+	while (it != list_queries_.end())
+	{
+		if (continue_list(it->first, it->second))
+			list_queries_.erase(it++);
+		else
+			++it;
+	}
+}
+
+/**
+ * @description	Checks if some LIST can go on without waiting for the socket
+ * @return		true if select() shouldn't block
+ */
+bool Irisha::lists_ready() const
+{
+	std::map<int, ListQuery>::const_iterator it = list_queries_.begin();
+	for (; it != list_queries_.end(); ++it)
+	{
+		std::map<int, Link>::const_iterator link = links_.find(it->first);
+		if (link != links_.end() && !link->second.blocked() && link->second.sendq() < LIST_SENDQ_LIMIT)
+			return true;
+	}
+	return false;
+}
@@ -1,5 +1,8 @@
 
 #include "Irisha.hpp"
+#include "Channel.hpp"
+#include "Server.hpp"
+#include "parser.hpp"
 
 /**
  * @description	Applies config settings and checks for domain and password validity
@@ -8,20 +11,44 @@
 void Irisha::apply_config(const std::string& path)
 {
 	check_config(path);
+	config_path_	= path;
 	domain_			= get_config_value(path, DOMAIN);
 	welcome_		= get_config_value(path, WELCOME);
 	admin_mail_		= get_config_value(path, ADMIN_MAIL);
 	admin_location_	= get_config_value(path, ADMIN_LOC);
 	admin_info_		= get_config_value(path, ADMIN_INFO);
 	//password_		= get_config_value(path, PASS);
-	ping_timeout_	= str_to_int(get_config_value(path, PING_T));
-	conn_timeout_	= str_to_int(get_config_value(path, CONN_T));
-	reg_timeout_	= str_to_int(get_config_value(path, REG_T));
+	ping_timeout_	= get_config_int(path, PING_T, 20);
+	conn_timeout_	= get_config_int(path, CONN_T, 120);
+	reg_timeout_	= get_config_int(path, REG_T, 20);
 	oper_pass_		= get_config_value(path, OPER_PASS);
 	set_time_stamp(path);
+	set_handler_budget(path);
+	set_metrics_port(path);
+	set_whowas_size(path);
+	set_ip_rules(path);
+	set_admission(path);
+	set_flood_control(path);
+	set_quantums(path);
+	set_classes(path);
+	set_pools(path);
+	stats_shm_		= get_config_value(path, STATS_SHM);
+	if (!stats_shm_.empty() && stats_shm_[0] != '/')
+		stats_shm_ = "/" + stats_shm_;
 
 	check_timeout_values();
 	check_domain();
+	load_motd(motd_file(path));
+}
+
+/**
+ * @description	MOTD file of config, the default one if it isn't set
+ * @param		path: path to config
+ */
+std::string Irisha::motd_file(const std::string& path) const
+{
+	std::string file = get_config_value(path, MOTD_FILE);
+	return file.empty() ? MOTD_DEFAULT_FILE : file;
 }
 
 void Irisha::check_timeout_values()
@@ -78,3 +105,196 @@ void Irisha::set_time_stamp(const std::string& path)
 	else
 		throw std::runtime_error("Config error: wrong time-stamp value");
 }
+
+/**
+ * @description	Reads handler budget in milliseconds (default is 50, 0 disables warnings)
+ * @param		path: path to config
+ */
+void Irisha::set_handler_budget(const std::string& path)
+{
+	int budget = get_config_int(path, HANDLER_BUDGET, 50);
+	if (budget < 0 || budget > 10000)
+	{
+		budget = 50;
+		std::cout << RED "Handler budget is wrong - server will use default setting (50 ms)" CLR << std::endl;
+	}
+	handler_budget_ = static_cast<unsigned long>(budget) * 1000;
+}
+
+/**
+ * @description	Reads WHOWAS history size in entries (default is 1024)
+ * @param		path: path to config
+ */
+void Irisha::set_whowas_size(const std::string& path)
+{
+	int size = get_config_int(path, WHOWAS_SIZE, WHOWAS_DEFAULT_SIZE);
+	if (size < 1 || size > 1000000)
+	{
+		size = WHOWAS_DEFAULT_SIZE;
+		std::cout << RED "WHOWAS size is wrong - server will use default setting (1024)" CLR << std::endl;
+	}
+	whowas_.resize(static_cast<size_t>(size));
+}
+
+/**
+ * @description	Reads Z-lines and their exemptions (comma separated networks)
+ * @param		path: path to config
+ */
+void Irisha::set_ip_rules(const std::string& path)
+{
+	ip_rules_.clear();
+	add_ip_rules(get_config_value(path, Z_LINES), CIDR_BAN);
+	add_ip_rules(get_config_value(path, Z_EXEMPT), CIDR_EXEMPT);
+}
+
+/**
+ * @description	Adds networks of config value, malformed ones are reported and skipped
+ * @param		list: "192.0.2.0/24, 2001:db8::/32"
+ * @param		rule
+ */
+void Irisha::add_ip_rules(const std::string& list, eCidrRule rule)
+{
+	std::vector<std::string>	networks;
+	std::string					value = list;
+
+	parse_arr(networks, value, ',');
+	for (size_t i = 0; i < networks.size(); ++i)
+	{
+		string_trim(networks[i], " \t");
+		if (!networks[i].empty() && !ip_rules_.add(networks[i], rule))
+			std::cout << RED "Wrong network in config: " << networks[i] << " - skipped" CLR << std::endl;
+	}
+}
+
+/**
+ * @description	Reads listen backlog and connection limits
+ * @param		path: path to config
+ */
+void Irisha::set_admission(const std::string& path)
+{
+	listen_backlog_ = get_config_int(path, LISTEN_BACKLOG, 128);
+	if (listen_backlog_ < 1 || listen_backlog_ > 65535)
+	{
+		listen_backlog_ = 128;
+		std::cout << RED "Listen backlog is wrong - server will use default setting (128)" CLR << std::endl;
+	}
+	int max_per_ip	= get_config_int(path, MAX_PER_IP, 0);
+	int rate		= get_config_int(path, ACCEPT_RATE, 0);
+	int burst		= get_config_int(path, ACCEPT_BURST, 5);
+	if (max_per_ip < 0 || rate < 0 || burst < 1)
+	{
+		max_per_ip = 0;
+		rate = 0;
+		std::cout << RED "Connection limits are wrong - limits are disabled" CLR << std::endl;
+	}
+	admission_.configure(static_cast<unsigned>(max_per_ip), rate, static_cast<unsigned>(burst));
+	int max_unregistered = get_config_int(path, MAX_UNREG, 1024);
+	if (max_unregistered < 0)
+	{
+		max_unregistered = 1024;
+		std::cout << RED "Unregistered connections cap is wrong - server will use default setting (1024)" CLR << std::endl;
+	}
+	max_unregistered_ = static_cast<size_t>(max_unregistered);
+}
+
+/**
+ * @description	Reads client flood control: flood-rate lines per second after
+ * 				a burst of flood-burst lines (rate 0 disables it)
+ * @param		path: path to config
+ */
+void Irisha::set_flood_control(const std::string& path)
+{
+	int rate	= get_config_int(path, FLOOD_RATE, 2);
+	int burst	= get_config_int(path, FLOOD_BURST, 10);
+	if (rate < 0 || rate > 1000000 || burst < 1 || burst > 10000)
+	{
+		rate = 2;
+		burst = 10;
+		std::cout << RED "Flood control settings are wrong - server will use default settings (2 lines per second, burst of 10)" CLR << std::endl;
+	}
+	flood_unit_ = (rate == 0) ? 0 : 1000000 / static_cast<unsigned long>(rate);
+	flood_window_ = flood_unit_ * static_cast<unsigned long>(burst);
+}
+
+/**
+ * @description	Reads how many lines of one connection a scheduling pass handles
+ * @param		path: path to config
+ */
+void Irisha::set_quantums(const std::string& path)
+{
+	int client = get_config_int(path, CLIENT_QUANTUM, 16);
+	int server = get_config_int(path, SERVER_QUANTUM, 256);
+	if (client < 1 || server < 1)
+	{
+		client = 16;
+		server = 256;
+		std::cout << RED "Scheduling quantums are wrong - server will use default settings (16 and 256 lines)" CLR << std::endl;
+	}
+	client_quantum_ = static_cast<size_t>(client);
+	server_quantum_ = static_cast<size_t>(server);
+}
+
+/**
+ * @description	Reads sendq and recvq caps (bytes) of client, operator and server classes
+ * @param		path: path to config
+ */
+void Irisha::set_classes(const std::string& path)
+{
+	const char*	names[CL_COUNT]			= { "client", "oper", "server" };
+	const char*	sendq_keys[CL_COUNT]	= { CLIENT_SENDQ, OPER_SENDQ, SERVER_SENDQ };
+	const char*	recvq_keys[CL_COUNT]	= { CLIENT_RECVQ, OPER_RECVQ, SERVER_RECVQ };
+	const int	sendq_defaults[CL_COUNT]	= { 1048576, 4194304, 33554432 };
+	const int	recvq_defaults[CL_COUNT]	= { 8192, 16384, 1048576 };
+
+	for (int i = 0; i < CL_COUNT; ++i)
+	{
+		int sendq = get_config_int(path, sendq_keys[i], sendq_defaults[i]);
+		int recvq = get_config_int(path, recvq_keys[i], recvq_defaults[i]);
+		if (sendq < 4096 || recvq < 1024)
+		{
+			sendq = sendq_defaults[i];
+			recvq = recvq_defaults[i];
+			std::cout << RED "Queue caps of " << names[i] << " class are wrong - server will use default settings ("
+					  << sendq << " and " << recvq << " bytes)" CLR << std::endl;
+		}
+		classes_[i].name = names[i];
+		classes_[i].sendq = static_cast<size_t>(sendq);
+		classes_[i].recvq = static_cast<size_t>(recvq);
+	}
+}
+
+/**
+ * @description	Preallocates slab pools of users, servers, channels and unregistered
+ * 				connections (default is 0 - pools grow on demand)
+ * @param		path: path to config
+ */
+void Irisha::set_pools(const std::string& path)
+{
+	SlabPool*	pools[]	= { &User::pool(), &Server::pool(), &Channel::pool(), &RegForm::pool() };
+	const char*	keys[]	= { POOL_USERS, POOL_SERVERS, POOL_CHANNELS, POOL_UNREG };
+
+	for (size_t i = 0; i < sizeof(pools) / sizeof(*pools); ++i)
+	{
+		int objects = get_config_int(path, keys[i], 0);
+		if (objects < 0 || objects > 1000000)
+		{
+			objects = 0;
+			std::cout << RED "Preallocated " << pools[i]->name() << " objects are wrong - server will use default setting (0)" CLR << std::endl;
+		}
+		pools[i]->reserve(static_cast<size_t>(objects));
+	}
+}
+
+/**
+ * @description	Reads metrics endpoint port (default is 0, the endpoint is disabled)
+ * @param		path: path to config
+ */
+void Irisha::set_metrics_port(const std::string& path)
+{
+	metrics_port_ = get_config_int(path, METRICS_PORT, 0);
+	if (metrics_port_ < 0 || metrics_port_ > 65535)
+	{
+		metrics_port_ = 0;
+		std::cout << RED "Metrics port is wrong - metrics endpoint is disabled" CLR << std::endl;
+	}
+}
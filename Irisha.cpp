@@ -1,6 +1,7 @@
 
 #include "Irisha.hpp"
 #include "utils.hpp"
+#include "Channel.hpp"
 #include "parser.hpp"
 
 #include <sys/socket.h>
@@ -8,8 +9,11 @@
 #include <netdb.h>
 #include <fcntl.h>
 
+#include <csignal>
+#include <cerrno>
 #include <cstring>
 #include <list>
+#include <algorithm>
 
 
 Irisha::Irisha(int port)
@@ -41,9 +45,7 @@ void Irisha::connect_to_server(const std::string &host_name, int port)
 	parent_fd_ = socket(PF_INET, SOCK_STREAM, 0); //socket to connect with parent server
 	if (parent_fd_ < 0) throw std::runtime_error("Socket opening error");
 
-	FD_SET(parent_fd_, &all_fds_);
-	if (parent_fd_ > max_fd_)
-		max_fd_ = parent_fd_;
+	attach_socket(parent_fd_);
 
 	server_address.sin_family = AF_INET;
 	server_address.sin_port = htons(port);
@@ -85,9 +87,43 @@ Irisha::Irisha(const std::string& host_name, int network_port, const std::string
 	loop();
 }
 
+/**
+ * @description	Creates server without listening socket and without entering the loop.
+ * 				Connections are given with adopt_connection() and link_server(),
+ * 				the loop is driven by run_once()
+ * @param		config_path: path to config
+ * @param		password: password for clients and servers connection
+ */
+Irisha::Irisha(const std::string& config_path, const std::string& password)
+{
+	prepare(config_path);
+	password_ = password;
+	launch_time_ = get_time();
+	stamp_time_ = 0;
+}
+
 Irisha::~Irisha()
 {
-	close(listener_);
+	for (con_it it = connections_.begin(); it != connections_.end(); ++it)
+		delete it->second;
+	for (std::map<std::string, Channel*>::iterator it = channels_.begin(); it != channels_.end(); ++it)
+		delete it->second;
+	for (std::list<RegForm*>::iterator it = reg_expect_.begin(); it != reg_expect_.end(); ++it)
+		delete *it;
+	for (std::map<int, Link>::iterator it = links_.begin(); it != links_.end(); ++it)
+		close(it->first);
+	for (std::map<int, MetricsClient>::iterator it = metrics_clients_.begin(); it != metrics_clients_.end(); ++it)
+		close(it->first);
+	if (metrics_listener_ != -1)
+		close(metrics_listener_);
+	if (listener_ != -1)
+		close(listener_);
+}
+
+SlabPool&	Irisha::RegForm::pool()
+{
+	static SlabPool* pool = new SlabPool("RegForm", sizeof(RegForm));
+	return *pool;
 }
 
 /**
@@ -101,19 +137,21 @@ void Irisha::launch()
 	int b = bind(listener_, reinterpret_cast<struct sockaddr *>(&address_), sizeof(address_));
 	if (b == -1) throw std::runtime_error("Binding failed!");
 
-	listen(listener_, 5);
-	launch_time_ = time(nullptr);
+	listen(listener_, listen_backlog_);
+	launch_time_ = get_time();
+	stamp_time_ = 0;
+	if (metrics_port_ != 0)
+		open_metrics_listener();
+	if (!stats_shm_.empty())
+		shm_stats_.open(stats_shm_);
 }
 
 void Irisha::init(int port)
 {
-	apply_config(CONFIG_PATH);
-	prepare_commands();
+	prepare(CONFIG_PATH);
 	listener_ = socket(PF_INET, SOCK_STREAM, 0);
 	if (listener_ == -1) throw std::runtime_error("Socket creation failed!");
 
-	signal(SIGPIPE, SIG_IGN);
-	FD_ZERO(&all_fds_);
 	FD_SET(listener_, &all_fds_);
 
 	max_fd_ = listener_;
@@ -124,26 +162,137 @@ void Irisha::init(int port)
 }
 
 /**
- * @description	Accepts one connection (server or client) and
- * 				sends greeting message
- * @return		connection socket
+ * @description	Applies config and resets connection state (doesn't open sockets)
+ * @param		config_path: path to config
+ */
+void Irisha::prepare(const std::string& config_path)
+{
+	apply_config(config_path);
+	prepare_commands();
+
+	signal(SIGPIPE, SIG_IGN);
+	FD_ZERO(&all_fds_);
+	FD_ZERO(&read_fds_);
+	FD_ZERO(&write_fds_);
+	listener_	= -1;
+	metrics_listener_ = -1;
+	shm_published_ = 0;
+	shm_pending_ = false;
+	parent_fd_	= -1;
+	max_fd_		= -1;
+	last_ping_	= get_time();
+}
+
+/**
+ * @description	Accepts one connection (server or client). Z-lined addresses and
+ * 				addresses over their limits are closed at once, the oldest
+ * 				unregistered connection is dropped when there are too many
+ * @return		connection socket or -1 if it was rejected
  */
 int Irisha::accept_connection()
 {
-	sockaddr_in con_addr;
+	sockaddr_storage con_addr;
 	socklen_t con_addr_size = sizeof (con_addr);
-	//int sock = accept(listener_, nullptr, nullptr); //! TODO: remove?
 	int sock = accept(listener_, reinterpret_cast<struct sockaddr*>(&con_addr), &con_addr_size);
 		if (sock == -1) throw std::runtime_error("Accepting failed");
 
+	const sockaddr* peer = reinterpret_cast<sockaddr*>(&con_addr);
+	if (ip_rules_.lookup(peer) == CIDR_BAN)	// Nothing is allocated for it yet
+	{
+		reject_connection(sock, "Z-lined");
+		++counters_.rejected;
+		return -1;
+	}
+	eAdmission admission = admission_.admit(sock, peer, get_usec());
+	if (admission != ADMIT_OK)
+	{
+		reject_connection(sock, (admission == ADMIT_TOO_MANY) ? "Too many connections from your host" : "Reconnecting too fast");
+		++counters_.throttled;
+		return -1;
+	}
+	if (max_unregistered_ != 0 && reg_expect_.size() >= max_unregistered_)
+	{
+		int oldest = reg_expect_.front()->socket_;
+		send_msg(oldest, domain_, "ERROR :Closing Link: (Server is busy, try again)");
+		close_connection(oldest, "evicted", &reg_expect_);
+		++counters_.evicted;
+	}
 	fcntl(sock, F_SETFL, O_NONBLOCK);
+	attach_socket(sock, peer, con_addr_size);
+	++counters_.accepted;
+
+	std::cout << E_PAGER ITALIC PURPLE " New connection from socket №" << sock << CLR << std::endl;
+	return sock;
+}
 
+/**
+ * @description	Sends ERROR to socket which was just accepted and closes it
+ * @param		sock
+ * @param		reason
+ */
+void Irisha::reject_connection(int sock, const std::string& reason)
+{
+	std::string	reply = "ERROR :Closing Link: (" + reason + ")\r\n";
+	int			flags = MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+	flags |= MSG_NOSIGNAL;
+#endif
+	send(sock, reply.data(), reply.size(), flags);
+	close(sock);
+}
+
+/**
+ * @description	Adds socket to the select set and creates its output queue
+ * @param		sock
+ * @param		peer: address from accept(), nullptr for sockets which weren't accepted
+ * @param		peer_size: bytes of peer
+ */
+void Irisha::attach_socket(int sock, const sockaddr* peer, socklen_t peer_size)
+{
 	FD_SET(sock, &all_fds_);
 	if (sock > max_fd_)
 		max_fd_ = sock;
+	links_.erase(sock);
+	Link link(sock);
+	if (sock == parent_fd_)
+		link.set_class(CL_SERVER);
+	if (peer != nullptr)
+		link.set_peer(peer, peer_size);
+	links_.insert(std::pair<int, Link>(sock, link));
+}
 
-	std::cout << E_PAGER ITALIC PURPLE " New connection from socket №" << sock << CLR << std::endl;
-	return sock;
+/**
+ * @description	Takes already connected socket as a new incoming connection
+ * 				(it has to register with PASS and NICK/USER or SERVER)
+ * @param		sock
+ */
+void Irisha::adopt_connection(int sock)
+{
+	fcntl(sock, F_SETFL, O_NONBLOCK);
+	attach_socket(sock);
+	reg_expect_.push_back(new RegForm(sock));
+}
+
+/**
+ * @description	Uses already connected socket as a link to the parent server and registers on it
+ * @param		sock
+ * @param		network_password: parent server password
+ */
+void Irisha::link_server(int sock, const std::string& network_password)
+{
+	fcntl(sock, F_SETFL, O_NONBLOCK);
+	parent_fd_ = sock;
+	attach_socket(sock);
+	send_reg_info(network_password);
+}
+
+/**
+ * @description	Counts network users, servers and channels known to this server
+ */
+void Irisha::network_size(int& users, int& servers, int& channels) const
+{
+	count_global(users, servers);
+	channels = static_cast<int>(channels_.size());
 }
 
 /**
@@ -152,59 +301,285 @@ int Irisha::accept_connection()
  */
 void Irisha::loop()
 {
-	int							n;
-	std::string*				buff;
-	std::list<Irisha::RegForm*>	reg_expect;	// Not registered connections
-    std::deque<std::string>		arr_msg;	// Array messages, not /r/n
-    timeval						timeout;	// Select timeout
-    time_t						last_ping = time(nullptr);	// Time of the last connection ping
-
-	timeout.tv_sec	= ping_timeout_;
-	if (reg_timeout_ < ping_timeout_)
-		timeout.tv_sec = reg_timeout_;
-	timeout.tv_usec	= 0;
+	timeval	timeout;	// Select timeout
+
 	while (true)
 	{
-		read_fds_ = all_fds_;
-		n = select(max_fd_ + 1, &read_fds_, nullptr, nullptr, &timeout);
-		if (n == -1) throw std::runtime_error("Select error");
-		check_reg_timeouts(reg_expect);
-		if (difftime(time(nullptr), last_ping) >= ping_timeout_)
-			ping_connections(last_ping);
-		for (int i = 3; i < max_fd_ + 1; ++i)
+		timeout.tv_sec	= ping_timeout_;
+		if (reg_timeout_ < ping_timeout_)
+			timeout.tv_sec = reg_timeout_;
+		timeout.tv_usec	= 0;
+		run_once(&timeout);
+	}
+}
+
+/**
+ * @description	Runs one loop iteration: waits for sockets (at most timeout), handles
+ * 				timeouts, reads and handles commands, then writes queued messages
+ * @param		timeout: select timeout (nullptr waits forever)
+ */
+void Irisha::run_once(timeval* timeout)
+{
+	int							n;
+	unsigned long				lines = 0;	// Lines handled in this iteration
+	ScratchVector<int>			readable(scratch_);	// Sockets with new input
+
+	read_fds_ = all_fds_;
+	for (std::set<int>::const_iterator it = deferred_.begin(); it != deferred_.end(); ++it)
+		FD_CLR(*it, &read_fds_);		// Don't read more until the held lines are handled
+	FD_ZERO(&write_fds_);
+	for (std::map<int, Link>::iterator it = links_.begin(); it != links_.end(); ++it)
+	{
+		if (it->second.pending())
+			FD_SET(it->first, &write_fds_);
+	}
+	for (std::map<int, MetricsClient>::iterator it = metrics_clients_.begin(); it != metrics_clients_.end(); ++it)
+	{
+		if (!it->second.response.empty())
+			FD_SET(it->first, &write_fds_);
+	}
+	timeval shm_timeout;
+	if (shm_pending_ && (timeout == nullptr || timeout->tv_sec > 0 || timeout->tv_usec > SHM_PUBLISH_USEC))
+	{
+		shm_timeout.tv_sec = 0;
+		shm_timeout.tv_usec = SHM_PUBLISH_USEC;
+		timeout = &shm_timeout;
+	}
+	timeval list_timeout;
+	if (!backlog_.empty() || (!list_queries_.empty() && lists_ready()))	// Don't sleep while lines or a LIST can go on
+	{
+		list_timeout.tv_sec = 0;
+		list_timeout.tv_usec = 0;
+		timeout = &list_timeout;
+	}
+	timeval flood_timeout;
+	if (!deferred_.empty())		// Wake up when the first held client may go on
+	{
+		unsigned long wait = deferred_wait(get_usec());
+		if (timeout == nullptr || static_cast<unsigned long>(timeout->tv_sec) * 1000000 + timeout->tv_usec > wait)
+		{
+			flood_timeout.tv_sec = static_cast<time_t>(wait / 1000000);
+			flood_timeout.tv_usec = static_cast<suseconds_t>(wait % 1000000);
+			timeout = &flood_timeout;
+		}
+	}
+	unsigned long select_start = get_usec();
+	n = select(max_fd_ + 1, &read_fds_, &write_fds_, nullptr, timeout);
+	if (n == -1)
+	{
+		if (errno == EINTR)
+			return;
+		throw std::runtime_error("Select error");
+	}
+	unsigned long timers_start = get_usec();
+	check_reg_timeouts(reg_expect_);
+	if (difftime(get_time(), last_ping_) >= ping_timeout_)
+	{
+		ping_connections(last_ping_);
+		admission_.expire(timers_start);
+	}
+	unsigned long io_start = get_usec();
+	unsigned long handlers_before = loop_stats_.handler_usec;
+	for (int i = 3; i < max_fd_ + 1; ++i)
+	{
+		if (FD_ISSET(i, &write_fds_) && !metrics_clients_.empty() && metrics_clients_.count(i) != 0)
+			write_metrics(i);
+		else if (FD_ISSET(i, &read_fds_))
 		{
-			if (FD_ISSET(i, &read_fds_))
+			if (i == listener_)
+			{
+				int connection_fd = accept_connection();
+				if (connection_fd != -1)
+					reg_expect_.push_back(new RegForm(connection_fd));
+			}
+			else if (i == metrics_listener_)
+				accept_metrics();
+			else if (!metrics_clients_.empty() && metrics_clients_.count(i) != 0)
+				serve_metrics(i);
+			else
 			{
-				if (i == listener_)
-				{
-					int connection_fd = accept_connection();
-					reg_expect.push_back(new RegForm(connection_fd));
-				}
+				std::string* buff = get_msg(i, reg_expect_);
+				std::map<int, Link>::const_iterator link = links_.find(i);
+				if (buff == nullptr || link == links_.end())
+					continue;
+				if (buff->size() > classes_[link->second.link_class()].recvq)	// Too much unhandled input (or a line without end)
+					drop_over_cap(i, false);
 				else
-				{
-					buff = get_msg(i, reg_expect);
-                    parse_arr_msg(arr_msg, *buff);
-                    while (!arr_msg.empty())
-                    {
-                        parse_msg(arr_msg[0], cmd_);
-						print_cmd(PM_LINE, i);
-						arr_msg.pop_front();
-						std::list<RegForm*>::iterator it = expecting_registration(i, reg_expect);	// Is this connection waiting for registration? TODO: add timeout handling to registration
-						if (it != reg_expect.end())														// Yes, register it
-						{
-							if (register_connection(it) == R_SUCCESS)
-							{
-								RegForm* rf = *it;
-								reg_expect.erase(it);
-								delete rf;
-							}
-							continue;
-						}
-						handle_command(i);																// No, handle not registration command
-					}
-				}
+					readable.push_back(i);
+			}
+		}
+	}
+	if (!readable.empty() || !backlog_.empty() || !deferred_.empty())
+		lines += serve_input(readable);
+	counters_.messages_in += lines;
+	if (!list_queries_.empty())
+		continue_lists();
+	if (!slow_consumers_.empty())
+		drop_slow_consumers();
+	unsigned long flush_start = get_usec();
+	flush_links();
+	update_loop_stats(select_start, timers_start, io_start, flush_start, handlers_before, n, lines);
+	if (shm_stats_.active())
+		publish_shm_stats();
+	scratch_.reset();
+#ifdef IRISHA_CHECK_COUNTERS
+	check_counters();
+#endif
+}
+
+/**
+ * @description	Tells if the first complete line of buffer is PING or PONG
+ * @param		buff: input buffer
+ */
+static bool keepalive_first(const std::string& buff)
+{
+	size_t begin = command_begin(buff);
+	if (begin == std::string::npos)
+		return false;
+	return buff.compare(begin, 5, "PING ") == 0 || buff.compare(begin, 5, "PONG ") == 0;
+}
+
+/**
+ * @description	Runs one scheduling pass over sockets with unhandled input: every
+ * 				one gets at most its quantum of lines, server links and connections
+ * 				whose next line is PING or PONG go first. Lines left for the next
+ * 				pass keep sockets in backlog_
+ * @param		readable: sockets read in this iteration
+ * @return		lines handled
+ */
+unsigned long Irisha::serve_input(const ScratchVector<int>& readable)
+{
+	ScratchVector<int>	candidates(readable.begin(), readable.end(), scratch_);
+	ScratchVector<int>	first(scratch_);	// Server links and keepalives
+	ScratchVector<int>	rest(scratch_);
+	unsigned long		lines = 0;
+
+	candidates.insert(candidates.end(), backlog_.begin(), backlog_.end());
+	backlog_.clear();
+	if (!deferred_.empty())
+	{
+		unsigned long now = get_usec();
+		for (std::set<int>::iterator it = deferred_.begin(); it != deferred_.end();)
+		{
+			std::map<int, Link>::const_iterator link = links_.find(*it);
+			if (link == links_.end() || !link->second.flooding(now, flood_window_))
+			{
+				candidates.push_back(*it);
+				deferred_.erase(it++);
+			}
+			else
+				++it;
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+	for (ScratchVector<int>::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+	{
+		std::map<int, Link>::const_iterator link = links_.find(*it);
+		if (link == links_.end() || deferred_.count(*it) != 0)
+			continue;
+		if (link->second.server() || *it == parent_fd_ || keepalive_first(*choose_buff(*it, reg_expect_)))
+			first.push_back(*it);
+		else
+			rest.push_back(*it);
+	}
+	first.insert(first.end(), rest.begin(), rest.end());
+	for (size_t i = 0; i < first.size(); ++i)
+	{
+		int sock = first[i];
+		std::map<int, Link>::const_iterator link = links_.find(sock);
+		if (link == links_.end())		// Closed by an earlier line
+			continue;
+		size_t quantum = (link->second.server() || sock == parent_fd_) ? server_quantum_ : client_quantum_;
+		cmd_.type_ = connection_type(sock);
+		lines += handle_lines(sock, choose_buff(sock, reg_expect_), quantum);
+	}
+	return lines;
+}
+
+/**
+ * @description	Handles up to quantum complete lines of socket buffer. The rest
+ * 				waits in the buffer for the next pass, or until the flood budget
+ * 				of the client refills
+ * @param		sock
+ * @param		buff: input buffer of the socket
+ * @param		quantum: lines to handle at most
+ * @return		lines handled
+ */
+unsigned long Irisha::handle_lines(int sock, std::string* buff, size_t quantum)
+{
+	std::string&	line = input_line_;
+	size_t			begin = 0;
+	unsigned long	lines = 0;
+	unsigned long	now = (flood_unit_ != 0) ? get_usec() : 0;
+
+	while (lines < quantum)
+	{
+		size_t next = begin;
+		if (!next_line(*buff, next, line))
+		{
+			begin = next;		// Skip empty lines
+			break;
+		}
+		parse_msg(line, cmd_);
+		if (flood_unit_ != 0 && !charge_line(sock, now))
+		{
+			deferred_.insert(sock);
+			++counters_.deferred;
+			break;
+		}
+		begin = next;
+		print_cmd(PM_LINE, sock);
+		++lines;
+		std::list<RegForm*>::iterator it = expecting_registration(sock, reg_expect_);	// Is this connection waiting for registration?
+		if (it != reg_expect_.end())													// Yes, register it
+		{
+			if (register_connection(it) == R_SUCCESS)	// The rest of the buffer stays with the link
+			{
+				delete *it;
+				reg_expect_.erase(it);
 			}
 		}
+		else
+			handle_command(sock);														// No, handle not registration command
+		if (links_.find(sock) == links_.end())	// Closed, its buffer is gone
+			return lines;
+	}
+	buff->erase(0, begin);
+	if (deferred_.count(sock) == 0 && buff->find('\n') != std::string::npos)
+		backlog_.insert(sock);
+	return lines;
+}
+
+/**
+ * @description	Accounts one loop iteration in loop_stats_ (STATS e)
+ * @param		select_start, timers_start, io_start, flush_start: stage start times (microseconds)
+ * @param		handlers_before: handler time total before the iteration
+ * @param		ready: sockets reported by select()
+ * @param		lines: lines handled
+ */
+void Irisha::update_loop_stats(unsigned long select_start, unsigned long timers_start, unsigned long io_start,
+							   unsigned long flush_start, unsigned long handlers_before, int ready, unsigned long lines)
+{
+	unsigned long end = get_usec();
+	unsigned long handlers = loop_stats_.handler_usec - handlers_before;
+	unsigned long io = flush_start - io_start;
+
+	++loop_stats_.iterations;
+	loop_stats_.select_usec += timers_start - select_start;
+	loop_stats_.timer_usec += io_start - timers_start;
+	loop_stats_.io_usec += (io > handlers) ? io - handlers : 0;
+	loop_stats_.flush_usec += end - flush_start;
+	loop_stats_.timers.record(io_start - timers_start);
+	loop_stats_.iteration.record(end - timers_start);
+	loop_stats_.last_usec = end - timers_start;
+	loop_stats_.last_ready = static_cast<unsigned long>(ready);
+	loop_stats_.last_lines = lines;
+	if (ready > 0)
+	{
+		++loop_stats_.wakeups;
+		loop_stats_.ready.record(static_cast<unsigned long>(ready));
+		loop_stats_.lines.record(lines);
 	}
 }
 
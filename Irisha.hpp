@@ -5,6 +5,15 @@
 #include "AConnection.hpp"
 #include "User.hpp"
 #include "Server.hpp"
+#include "Link.hpp"
+#include "Stats.hpp"
+#include "ShmStats.hpp"
+#include "ListQuery.hpp"
+#include "Whowas.hpp"
+#include "CidrTrie.hpp"
+#include "Admission.hpp"
+#include "Arena.hpp"
+#include "Motd.hpp"
 #include "utils.hpp"
 
 #include <unistd.h>
@@ -15,6 +24,7 @@
 #include <map>
 #include <vector>
 #include <list>
+#include <set>
 
 #define CONFIG_PATH "irisha.conf"
 #define NO_PREFIX	""
@@ -43,24 +53,36 @@ private:
 	{
 		int			socket_;
 		bool		pass_received_;
-		std::string buff_;
 		time_t		connection_time_;
 
 		explicit RegForm(int sock)
 		{
 			socket_ = sock;
 			pass_received_ = false;
-			connection_time_ = time(nullptr);
+			connection_time_ = get_time();
 		}
+
+		static SlabPool&	pool			();
+		static void*		operator new	(size_t size) { return pool().allocate(size); }
+		static void			operator delete	(void* ptr, size_t size) { pool().release(ptr, size); }
+	};
+
+	struct MetricsClient
+	{
+		std::string	request;	// Partial request
+		std::string	response;	// Rendered response, the socket only waits to write it once it's set
+		size_t		sent;		// Bytes of response already written
+
+		MetricsClient() : sent(0) {}
 	};
 
 	typedef eResult (Irisha::*func)(const int sock);
 
 	int			listener_;
-	std::string buff_;
 	sockaddr_in	address_;
 	fd_set		all_fds_;
 	fd_set		read_fds_;
+	fd_set		write_fds_;
 	fd_set		serv_fds_;
 	int			max_fd_;
     Command		cmd_;			// Struct for parsed command
@@ -69,10 +91,39 @@ private:
 	time_t		launch_time_;	// Server launch time
 	int 		parent_fd_;
 	std::string oper_pass_;
+	std::string	config_path_;	// Config read at start, MOTD file is taken from it again on REHASH
+	Motd		motd_;			// Pre-rendered MOTD block
 
 	std::map<std::string, AConnection*>		connections_;	// Server and client connections
 	std::map<std::string, func>				commands_;		// IRC commands
     std::map<std::string ,Channel*>          channels_;
+	std::map<int, AConnection*>				sockets_;			// Local connections by socket
+	std::multimap<std::string, User*>		nicks_;				// Users by casefolded nick
+	std::multimap<std::string, User*>		nicks_reversed_;	// and by reversed one (WHO "*tail" masks)
+	std::multimap<std::string, User*>		hosts_;				// Users by casefolded host
+	std::multimap<std::string, User*>		hosts_reversed_;
+	Whowas									whowas_;			// Departed nicks (WHOWAS)
+	CidrTrie								ip_rules_;			// Z-lines and exemptions checked at accept()
+	Admission								admission_;			// Per-address connection limits
+	std::set<std::pair<size_t, Channel*> >	channels_by_users_;	// Channels by member count (LIST filters)
+	std::map<int, ListQuery>				list_queries_;		// LIST replies in progress by client socket
+	mutable std::map<int, Link>				links_;			// Output queues of local sockets
+	std::set<int>							deferred_;		// Sockets with lines held back by flood control
+	std::set<int>							backlog_;		// Sockets with lines left for the next pass
+	ConnectionClass							classes_[CL_COUNT];	// Queue caps of clients, operators and servers
+	mutable std::vector<int>				slow_consumers_;	// Sockets over their sendq cap, dropped before flushing
+	mutable Arena							scratch_;		// Handler temporaries, emptied after every loop iteration
+	std::string								input_line_;	// Line being handled, its capacity is reused
+	std::list<RegForm*>						reg_expect_;	// Not registered connections
+	time_t									last_ping_;		// Time of the last connection ping
+	std::map<std::string, CommandStats>		command_stats_;	// Per command counters and handler latency (STATS m, STATS t)
+	mutable ServerCounters					counters_;		// Connection gauges and traffic counters
+	LoopStats								loop_stats_;	// Event loop health (STATS e)
+	int										metrics_listener_;	// Local HTTP listener for metrics, -1 if disabled
+	std::map<int, MetricsClient>			metrics_clients_;	// Scraper sockets, their requests and responses
+	ShmStats								shm_stats_;			// Shared memory snapshot for irisha_top and agents
+	unsigned long							shm_published_;		// Time of the last snapshot (microseconds)
+	bool									shm_pending_;		// Changes happened after the last snapshot
 
 	/// Configuration members
 	std::string	domain_;        // Server name
@@ -84,6 +135,17 @@ private:
 	int			conn_timeout_;	// Seconds without respond until disconnection
 	int			reg_timeout_;	// Seconds for registration until disconnection
 	eUtils		time_stamp_;	// Enabled or disabled time stamps
+	mutable std::string	stamp_;			// Time stamp of the current second
+	mutable time_t		stamp_time_;	// Second of stamp_
+	unsigned long	handler_budget_;	// Microseconds a command handler may run before a warning, 0 disables
+	int				metrics_port_;		// Port of the metrics endpoint on 127.0.0.1, 0 disables
+	std::string		stats_shm_;			// POSIX shared memory name for stats, empty disables
+	int				listen_backlog_;	// Pending connections the kernel keeps for accept()
+	size_t			max_unregistered_;	// Unregistered connections before the oldest is dropped, 0 is no cap
+	unsigned long	flood_unit_;		// Flood penalty of one line (microseconds), 0 disables flood control
+	unsigned long	flood_window_;		// How far a client's flood clock may run ahead (microseconds)
+	size_t			client_quantum_;	// Lines of one client handled per pass
+	size_t			server_quantum_;	// Lines of one server link handled per pass
 
 	std::list<Irisha::RegForm*>::iterator	expecting_registration(int i, std::list<RegForm*>& reg_expect);
 	int										register_connection	(std::list<RegForm*>::iterator rf);
@@ -96,40 +158,101 @@ private:
 	void			prepare_commands	();
 	void			launch				();
 	void 			init				(int port);
+	void			prepare				(const std::string& config_path);
 	void			loop				();
+	void			update_loop_stats	(unsigned long select_start, unsigned long timers_start, unsigned long io_start,
+										 unsigned long flush_start, unsigned long handlers_before, int ready, unsigned long lines);
 
 	/// Config
 	void			apply_config		(const std::string& path);
 	void			check_timeout_values();
 	void			check_domain		();
 	void			set_time_stamp		(const std::string& path);
+	void			set_handler_budget	(const std::string& path);
+	void			set_metrics_port	(const std::string& path);
+	void			set_whowas_size		(const std::string& path);
+	void			set_ip_rules		(const std::string& path);
+	void			add_ip_rules		(const std::string& list, eCidrRule rule);
+	void			set_admission		(const std::string& path);
+	void			set_flood_control	(const std::string& path);
+	void			set_quantums		(const std::string& path);
+	void			set_classes			(const std::string& path);
+	void			set_pools			(const std::string& path);
+
+	/// Metrics endpoint
+	void			open_metrics_listener();
+	void			accept_metrics		();
+	void			serve_metrics		(int sock);
+	void			write_metrics		(int sock);
+	void			close_metrics		(int sock);
+	std::string		render_metrics		() const;
+	void			publish_shm_stats	();
 
 	/// Connections
 	int				accept_connection	();
+	void			reject_connection	(int sock, const std::string& reason);
+	void			attach_socket		(int sock, const sockaddr* peer = nullptr, socklen_t peer_size = 0);
+	void			close_socket		(int sock);
+	void			flush_links			();
+	void			drop_over_cap		(int sock, bool sendq);
+	void			drop_slow_consumers	();
+	size_t			recvq				(int sock) const;
 	void			close_connection	(const int sock, const std::string& comment, std::list<Irisha::RegForm*>* reg_expect);
 	void			handle_command		(const int sock);
+	unsigned long	serve_input			(const ScratchVector<int>& readable);
+	unsigned long	handle_lines		(int sock, std::string* buff, size_t quantum);
+	bool			charge_line			(int sock, unsigned long now);
+	unsigned long	deferred_wait		(unsigned long now) const;
 	AConnection*	find_connection		(const int sock) const;
 	AConnection*	find_connection		(const std::string& name) const;
+	void			add_connection		(const std::string& name, AConnection* connection);
+	void			erase_connection	(const std::string& name);
+	void			rename_connection	(const std::string& old_name, const std::string& new_name);
+	void			count_connection	(const AConnection* connection, int delta);
 	void			ping_connections	(time_t& last_ping);
 	void			check_reg_timeouts	(std::list<Irisha::RegForm*>& reg_expect);
-	std::string		connection_name		(const int sock) const;
-	std::string		connection_name		(AConnection* connection) const;
+	const std::string&	connection_name	(const int sock) const;
+	const std::string&	connection_name	(AConnection* connection) const;
 
 	/// Users
 	void			add_user			(const int sock, const std::string& nick);
 	void			add_user			(int source_sock);
 	void			remove_user			(const std::string& nick);
 	void			remove_user			(User*& user);
+	void			invalidate_names	(User* user);
+
 	void			remove_server_users	(const std::string& name);
 	User*			find_user			(const std::string& nick) const;
 	User*			find_user			(const int sock) const;
 	bool			is_user_operator	(const int sock);
     eResult         check_user          (int sock, User*& user, const std::string& nick);
+	void			index_user			(User* user, const std::string& nick, int delta);
+	void			index_user			(std::multimap<std::string, User*>& index, const std::string& key, User* user, int delta);
+	User*			find_user_folded	(const std::string& nick) const;
+	std::string		user_server			(const User* user) const;
+	bool			is_visible_to		(User* target, User* viewer) const;
+	void			who_reply			(std::string& batch, User* viewer, User* target, Channel* channel) const;
+	void			who_mask			(std::string& batch, User* viewer, const std::string& mask, bool opers_only) const;
+	void			whois_reply			(std::string& batch, User* viewer, User* target) const;
+
+	/// Channels
+	void			add_channel			(Channel* channel);
+	void			remove_channel		(Channel* channel);
+	void			join_channel		(Channel* channel, User* user);
+	bool			part_channel		(Channel* channel, User* user);
+	void			reindex_channel		(Channel* channel, size_t before);
+	bool			set_list_mode		(Channel* channel, char list, bool add, std::string& mask, const std::string& setter);
+	void			send_mask_list		(User* user, const Channel* channel, char list) const;
+	Channel*		next_list_channel	(ListQuery& query);
+	bool			continue_list		(int sock, ListQuery& query);
+	void			continue_lists		();
+	bool			lists_ready			() const;
 
 	/// Servers
 	void			remove_server		(const std::string& name);
 	void			remove_server		(Server*& server);
 	void			remove_local_server	(Server*& server);
+	void			remove_link_users	(int sock);
 	Server*			find_server			(const std::string& name) const;
 	Server*			find_server			(const int sock) const;
 	eResult			check_server		(int sock, Server*& server, const std::string& name);
@@ -137,21 +260,31 @@ private:
 	/// Utils
 	std::string*		choose_buff			(int sock, std::list<Irisha::RegForm*>& reg_expect);
 	std::string* 		get_msg				(int sock, std::list<Irisha::RegForm*>& reg_expect);
-	std::string 		time_stamp			() const;
+	const std::string&	time_stamp			() const;
 	RegForm*	 		find_regform		(int sock, std::list<Irisha::RegForm*>& reg_expect);
 	bool				is_valid_prefix		(const int sock);
-	void				send_msg			(int sock, const std::string& prefix, const std::string& msg) const;
-	void				send_msg			(int sock, const std::string& msg) const;
+	void				send_msg			(int sock, const std::string& prefix, StringRef msg) const;
+	void				send_msg			(int sock, StringRef msg) const;
+	void				send_msg			(int sock, const User* sender, StringRef msg) const;
+	void				queue_msg			(int sock, StringRef message) const;
+	void				queue_block			(int sock, const struct iovec* parts, size_t count, unsigned long lines) const;
+	bool				fits_sendq			(int sock, Link& out, size_t size) const;
+	template <typename... Parts>
+	void				send_numeric		(int sock, int code, StringRef target, const Parts&... parts) const;
+	template <typename... Parts>
+	void				batch_numeric		(std::string& batch, int code, StringRef target, const Parts&... parts) const;
+	void				batch_rpl			(std::string& batch, eReply rpl, const std::string& target, const std::string& msg) const;
+	void				batch_rpl			(std::string& batch, eError rpl, const std::string& target, const std::string& msg) const;
 	void				send_rpl_msg		(int sock, eReply rpl, const std::string& msg) const;
 	void				send_rpl_msg		(int sock, eReply rpl, const std::string& msg
 												, const std::string& target) const;
 	void				send_rpl_msg		(int sock, eError rpl, const std::string& msg) const;
 	void				send_rpl_msg		(int sock, eError rpl, const std::string& msg
 												, const std::string& target) const;
-	void				send_servers		(const std::string& prefix, const std::string& msg) const;
-	void				send_servers		(const std::string& prefix, const std::string& msg, const int sock) const;
-	void				send_servers		(const std::string& msg, const int sock) const;
-	void				send_everyone		(const std::string& prefix, const std::string& msg) const;
+	void				send_servers		(const std::string& prefix, StringRef msg) const;
+	void				send_servers		(const std::string& prefix, StringRef msg, const int sock) const;
+	void				send_servers		(StringRef msg, const int sock) const;
+	void				send_everyone		(const std::string& prefix, StringRef msg) const;
 	void				print_info			() const;
 	int 				next_token			();
 	int 				choose_sock			(AConnection* connection);
@@ -200,10 +333,15 @@ private:
 	eResult			RPL_421 			(const int sock);
 	eResult			NAMES				(const int sock);
 	eResult			LIST				(const int sock);
+	eResult			WHO					(const int sock);
+	eResult			WHOIS				(const int sock);
+	eResult			WHOWAS				(const int sock);
+	eResult			ZLINE				(const int sock);
 	eResult			INVITE				(const int sock);
 	eResult			KICK				(const int sock);
 	eResult			MOTD				(const int sock);
 	eResult			MOTD_REPLIES		(const int sock);
+	eResult			REHASH				(const int sock);
 	eResult			LUSERS				(const int sock);
 	eResult			SQUIT				(const int sock);
     eResult         NJOIN               (const int sock);
@@ -216,16 +354,18 @@ private:
 
 	/// IRC commands utils
 	void			admin_info			(const int sock, const std::string& receiver);
-	void            send_channel    	(Channel *channel, std::string msg, std::string prefix);
-    void            send_channel		(Channel *channel, std::string msg, std::string prefix, int sock);
-    void            send_local_channel  (Channel *channel, std::string msg, std::string prefix, int sock);
-	int             check_mode_channel	(const Channel* channel, const int sock, std::list<std::string>& arr_key, std::string& arr_channel);
+	void            send_channel    	(Channel *channel, StringRef msg, const User* sender);
+    void            send_channel		(Channel *channel, StringRef msg, const User* sender, int sock);
+    void            send_local_channel  (Channel *channel, StringRef msg, const User* sender, int sock);
+	int             check_mode_channel	(const Channel* channel, User* user, const int sock, std::list<std::string>& arr_key, std::string& arr_channel);
 	eResult			NICK_user			(User* const connection, const int sock, const std::string& new_nick);
 	eResult			NICK_server			(const std::string& new_nick, int source_sock);
 	std::string		createPASSmsg		(std::string password) const ;
 	std::string		createSERVERmsg		(AConnection* server) const;
 	std::string		createNICKmsg		(User* usr) const;
-	void			send_motd			(const int sock);
+	void			send_motd			(const int sock, const std::string& target);
+	void			load_motd			(const std::string& path);
+	std::string		motd_file			(const std::string& path) const;
 	void			count_operators		(int& operators) const;
 	void			count_global		(int& users, int& servers) const;
 	void			count_local			(int& users, int& servers) const;
@@ -273,6 +413,7 @@ private:
 	void			err_yourebannedcreep	(const int sock) const;
 	void 			err_nooperhost			(const int sock) const;
 	void 			err_cantkillserver		(const int sock) const;
+	void			err_nomotd				(const int sock, const std::string& target) const;
 
 	/// Common Replies
 	void			rpl_welcome				(const int sock) const;
@@ -284,9 +425,7 @@ private:
 	void			rpl_endofbanlist		(const int sock, const std::string& channel) const;
 	void			rpl_info				(const int sock, const std::string& info) const;
 	void			rpl_endofinfo			(const int sock) const;
-	void			rpl_motdstart			(const int sock, const std::string& server) const;
-	void			rpl_motd				(const int sock, const std::string& text) const;
-	void			rpl_endofmotd			(const int sock) const;
+	void			rpl_rehashing			(const int sock, const std::string& target) const;
 	void			rpl_umodeis				(const int sock, const std::string& mode_string) const;
 	void			rpl_topic				(const int sock, const std::string& channel, const std::string& topic) const;
 	void			rpl_notopic				(const int sock, const std::string& channel) const;
@@ -305,9 +444,17 @@ private:
 	void 			rpl_endofstats			(const int sock, const std::string& letter, const std::string &target) const;
 	void 			rpl_statslinkinfo		(const int sock, const std::string &msg, const std::string &target);
 	void 			rpl_statsuptime			(const int sock, const std::string &msg, const std::string &target);
+	void 			rpl_statscommands		(const int sock, const std::string &command, const CommandStats& stats, const std::string &target) const;
+	void 			rpl_statsdebug			(const int sock, const std::string &msg, const std::string &target) const;
+	void 			rpl_statskline			(const int sock, const std::string &msg, const std::string &target) const;
+	void 			rpl_statsyline			(const int sock, const std::string &msg, const std::string &target) const;
 	void 			rpl_links				(const int sock, const std::string &serv_name, int hopcount, const std::string &target);
 	void 			rpl_endoflinks			(const int sock, const std::string &serv_name, const std::string &target);
 	void 			rpl_ison				(const int sock, const std::string &nick);
+	void			rpl_namreply			(const int sock, Channel* channel, const std::string& target) const;
+	void			rpl_endofnames			(const int sock, const std::string& channel, const std::string& target) const;
+	void			rpl_list				(const int sock, const Channel* channel, const std::string& target) const;
+	void			rpl_listend				(const int sock, const std::string& target) const;
 
 	/// Unused constructors
 	Irisha				() {};
@@ -321,6 +468,13 @@ public:
 		   						, int port, const std::string& password);
 	~Irisha				();
 
+	/// Embedding (several servers in one process, see bench/netsim.cpp)
+	Irisha				(const std::string& config_path, const std::string& password);
+	void		run_once			(timeval* timeout);
+	void		adopt_connection	(int sock);
+	void		link_server			(int sock, const std::string& network_password);
+	void		network_size		(int& users, int& servers, int& channels) const;
+	bool		check_counters		() const;
 
 	/// ‼️ ⚠️ DEVELOPMENT UTILS (REMOVE OR COMMENT WHEN PROJECT IS READY) ⚠️ ‼️ //! TODO: DEV -> REMOVE ///
 	enum ePrintMode
@@ -7,6 +7,7 @@
 #include "parser.hpp"
 
 #include <sstream>
+#include <algorithm>
 
 /**
  * @description	Inserts all supported IRC commands to map
@@ -29,6 +30,10 @@ void	Irisha::prepare_commands()
 	commands_.insert(std::pair<std::string, func>("NOTICE", &Irisha::NOTICE));
 	commands_.insert(std::pair<std::string, func>("NAMES", &Irisha::NAMES));
 	commands_.insert(std::pair<std::string, func>("LIST", &Irisha::LIST));
+	commands_.insert(std::pair<std::string, func>("WHO", &Irisha::WHO));
+	commands_.insert(std::pair<std::string, func>("WHOIS", &Irisha::WHOIS));
+	commands_.insert(std::pair<std::string, func>("WHOWAS", &Irisha::WHOWAS));
+	commands_.insert(std::pair<std::string, func>("ZLINE", &Irisha::ZLINE));
 	commands_.insert(std::pair<std::string, func>("KICK", &Irisha::KICK));
 	commands_.insert(std::pair<std::string, func>("INVITE", &Irisha::INVITE));
 	commands_.insert(std::pair<std::string, func>("TIME", &Irisha::TIME));
@@ -50,6 +55,8 @@ void	Irisha::prepare_commands()
 	commands_.insert(std::pair<std::string, func>("375", &Irisha::MOTD_REPLIES));
 	commands_.insert(std::pair<std::string, func>("372", &Irisha::MOTD_REPLIES));
 	commands_.insert(std::pair<std::string, func>("376", &Irisha::MOTD_REPLIES));
+	commands_.insert(std::pair<std::string, func>("422", &Irisha::MOTD_REPLIES));
+	commands_.insert(std::pair<std::string, func>("REHASH", &Irisha::REHASH));
 	commands_.insert(std::pair<std::string, func>("LUSERS", &Irisha::LUSERS));
 	commands_.insert(std::pair<std::string, func>("SQUIT", &Irisha::SQUIT));
 	commands_.insert(std::pair<std::string, func>("VERSION", &Irisha::VERSION));
@@ -115,6 +122,24 @@ eResult Irisha::LINKS(const int sock)
 	return R_SUCCESS;
 }
 
+/**
+ * Handles IRC REHASH command (operators only)
+ * reads MOTD file of the config again
+ */
+eResult Irisha::REHASH(const int sock)
+{
+	User* user = determine_user(sock);
+	if (user == 0 || !(user->is_operator()))
+	{
+		err_noprivileges(sock);
+		return R_FAILURE;
+	}
+	rpl_rehashing(sock, user->nick());
+	load_motd(motd_file(config_path_));
+	sys_msg(E_GEAR, "Operator", user->nick(), "reloaded MOTD");
+	return R_SUCCESS;
+}
+
 /**
  * Handles IRC STATS command
  * show statistic of this server or send STATS message to other server
@@ -147,31 +172,130 @@ eResult Irisha::STATS(const int sock)
 		return R_SUCCESS;
 	}
 
-	if (cmd_.arguments_[0] == "l")
+	if (cmd_.arguments_[0] == "l")	// Local links with sendq and recvq fill against their class caps
 	{
-		time_t cur_time = time(0);
+		time_t cur_time = get_time();
 		for(std::map<std::string, AConnection*>::iterator it = connections_.begin(); it != connections_.end(); it++)
 		{
 			if (it->second->socket() == U_EXTERNAL_CONNECTION)
 				continue;
 			std::string launch_time = double_to_str(difftime(cur_time, it->second->launch_time()));
+			std::string queues;
+			std::map<int, Link>::const_iterator link = links_.find(it->second->socket());
+			if (link != links_.end())
+			{
+				const ConnectionClass& link_class = classes_[link->second.link_class()];
+				queues = "[" + link_class.name + "] sendq " + ulong_to_str(link->second.sendq()) + "/" + ulong_to_str(link_class.sendq)
+						 + " recvq " + ulong_to_str(recvq(link->first)) + "/" + ulong_to_str(link_class.recvq) + " ";
+			}
 			if (it->second->type() == T_SERVER)
 			{
 				Server *server = static_cast<Server*>(it->second);
-				rpl_statslinkinfo(sock, server->name() + " " + launch_time + " sec ", user->nick());
+				rpl_statslinkinfo(sock, server->name() + queues + launch_time + " sec ", user->nick());
 			}
 			else
 			{
 				User *client = static_cast<User*>(it->second);
-				rpl_statslinkinfo(sock, user->nick() + "@" + client->host() + " " + launch_time + " sec ", user->nick());
+				rpl_statslinkinfo(sock, client->nick() + "@" + client->host() + queues + launch_time + " sec ", user->nick());
 			}
 		}
 	}
+	else if (cmd_.arguments_[0] == "y")	// Connection classes: caps, the fullest queues now and drops
+	{
+		size_t	links[CL_COUNT]		= { 0, 0, 0 };
+		size_t	max_sendq[CL_COUNT]	= { 0, 0, 0 };
+		size_t	max_recvq[CL_COUNT]	= { 0, 0, 0 };
+		for (std::map<int, Link>::const_iterator it = links_.begin(); it != links_.end(); ++it)
+		{
+			eClass link_class = it->second.link_class();
+			++links[link_class];
+			max_sendq[link_class] = std::max(max_sendq[link_class], it->second.sendq());
+			max_recvq[link_class] = std::max(max_recvq[link_class], recvq(it->first));
+		}
+		for (int i = 0; i < CL_COUNT; ++i)
+		{
+			const ConnectionClass& link_class = classes_[i];
+			rpl_statsyline(sock, "Y " + link_class.name + " links " + ulong_to_str(links[i])
+							+ " sendq " + ulong_to_str(max_sendq[i]) + "/" + ulong_to_str(link_class.sendq)
+							+ " recvq " + ulong_to_str(max_recvq[i]) + "/" + ulong_to_str(link_class.recvq)
+							+ " drops " + ulong_to_str(link_class.sendq_drops) + "/" + ulong_to_str(link_class.recvq_drops), user->nick());
+		}
+	}
 	else if (cmd_.arguments_[0] == "u")
 	{
-		std::string up_time = double_to_str(time(0) - this->launch_time_);
+		std::string up_time = double_to_str(get_time() - this->launch_time_);
 		rpl_statsuptime(sock, "Server up " + up_time + " sec", user->nick());
 	}
+	else if (cmd_.arguments_[0] == "m")	// Calls, bytes received and calls from servers
+	{
+		for (std::map<std::string, CommandStats>::const_iterator it = command_stats_.begin(); it != command_stats_.end(); ++it)
+			rpl_statscommands(sock, it->first, it->second, user->nick());
+	}
+	else if (cmd_.arguments_[0] == "t")	// Handler time percentiles in microseconds
+	{
+		for (std::map<std::string, CommandStats>::const_iterator it = command_stats_.begin(); it != command_stats_.end(); ++it)
+		{
+			const Histogram& latency = it->second.latency;
+			rpl_statsdebug(sock, "t :" + it->first + " calls " + ulong_to_str(latency.count())
+							+ " " + latency.summary() + " out " + ulong_to_str(it->second.bytes_out), user->nick());
+		}
+	}
+	else if (cmd_.arguments_[0] == "e")	// Event loop health, durations in microseconds
+	{
+		const LoopStats& loop = loop_stats_;
+		rpl_statsdebug(sock, "e :iterations " + ulong_to_str(loop.iterations) + " wakeups " + ulong_to_str(loop.wakeups)
+						+ " budget-overruns " + ulong_to_str(loop.budget_overruns)
+						+ " budget " + ulong_to_str(handler_budget_), user->nick());
+		rpl_statsdebug(sock, "e :time select " + ulong_to_str(loop.select_usec) + " timers " + ulong_to_str(loop.timer_usec)
+						+ " io " + ulong_to_str(loop.io_usec) + " handlers " + ulong_to_str(loop.handler_usec)
+						+ " flush " + ulong_to_str(loop.flush_usec), user->nick());
+		rpl_statsdebug(sock, "e :iteration " + loop.iteration.summary() + " last " + ulong_to_str(loop.last_usec), user->nick());
+		rpl_statsdebug(sock, "e :ready " + loop.ready.summary() + " last " + ulong_to_str(loop.last_ready), user->nick());
+		rpl_statsdebug(sock, "e :lines " + loop.lines.summary() + " last " + ulong_to_str(loop.last_lines), user->nick());
+		rpl_statsdebug(sock, "e :timers " + loop.timers.summary(), user->nick());
+	}
+	else if (cmd_.arguments_[0] == "z")	// Slab pools of connections and channels, the loop arena, interned names, user memory
+	{
+		const std::vector<SlabPool*>& pools = SlabPool::pools();
+		for (std::vector<SlabPool*>::const_iterator it = pools.begin(); it != pools.end(); ++it)
+		{
+			const SlabPool& pool = **it;
+			rpl_statsdebug(sock, "z :" + pool.name() + " used " + ulong_to_str(pool.used()) + "/" + ulong_to_str(pool.capacity())
+							+ " peak " + ulong_to_str(pool.peak()) + " object " + ulong_to_str(pool.object_size())
+							+ " slabs " + ulong_to_str(pool.slabs()) + " allocations " + ulong_to_str(pool.allocations()), user->nick());
+		}
+		rpl_statsdebug(sock, "z :scratch capacity " + ulong_to_str(scratch_.capacity()) + " peak " + ulong_to_str(scratch_.peak())
+						+ " blocks " + ulong_to_str(scratch_.blocks()) + " resets " + ulong_to_str(scratch_.resets()), user->nick());
+		rpl_statsdebug(sock, "z :atoms " + ulong_to_str(Atom::symbols()) + " references " + ulong_to_str(Atom::references())
+						+ " bytes " + ulong_to_str(Atom::bytes()), user->nick());
+		unsigned long	users[2] = { 0, 0 };	// Local, remote
+		unsigned long	bytes[2] = { 0, 0 };
+		for (con_const_it it = connections_.begin(); it != connections_.end(); ++it)
+		{
+			if (it->second->type() != T_CLIENT)
+				continue;
+			const User*		usr = static_cast<const User*>(it->second);
+			std::map<int, Link>::const_iterator link = links_.find(usr->socket());
+			bool			remote = (usr->socket() == U_EXTERNAL_CONNECTION || link == links_.end());
+			++users[remote];
+			bytes[remote] += usr->footprint() + (remote ? 0 : link->second.footprint());
+		}
+		rpl_statsdebug(sock, "z :users local " + ulong_to_str(users[0]) + " bytes " + ulong_to_str(bytes[0])
+						+ " per-user " + ulong_to_str(users[0] ? bytes[0] / users[0] : 0)
+						+ " remote " + ulong_to_str(users[1]) + " bytes " + ulong_to_str(bytes[1])
+						+ " per-user " + ulong_to_str(users[1] ? bytes[1] / users[1] : 0), user->nick());
+	}
+	else if (cmd_.arguments_[0] == "k")	// Z-lines and exemptions
+	{
+		const std::map<std::string, uint8_t>& networks = ip_rules_.networks();
+		for (std::map<std::string, uint8_t>::const_iterator it = networks.begin(); it != networks.end(); ++it)
+		{
+			if (it->second & CIDR_BAN)
+				rpl_statskline(sock, "Z " + it->first + " * ban", user->nick());
+			if (it->second & CIDR_EXEMPT)
+				rpl_statskline(sock, "Z " + it->first + " * exempt", user->nick());
+		}
+	}
 	rpl_endofstats(sock, cmd_.arguments_[0], user->nick());
 	return R_SUCCESS;
 }
@@ -201,7 +325,13 @@ eResult Irisha::CONNECT(const int sock)
 	if (cmd_.arguments_.size() == 2 ||
 		(cmd_.arguments_.size() > 2 && cmd_.arguments_[2] == this->domain_)) //connect this server to other
 	{
-		try	{ connect_to_server(cmd_.arguments_[0], str_to_int(cmd_.arguments_[1])); }
+		int port;
+		try
+		{
+			if (!parse_int(cmd_.arguments_[1], port) || port <= 0 || port > 65535)
+				throw std::runtime_error("bad port");
+			connect_to_server(cmd_.arguments_[0], port);
+		}
 		catch (std::runtime_error &ex)
 		{
 			err_nosuchserver(sock, cmd_.arguments_[0] + ":" + cmd_.arguments_[1]);
@@ -307,6 +437,10 @@ eResult Irisha::OPER(const int sock)
 		if (user->is_operator())
 			return R_SUCCESS;
 		user->set_operator(true);
+		++counters_.operators;
+		std::map<int, Link>::iterator link = links_.find(user->socket());
+		if (user->socket() != U_EXTERNAL_CONNECTION && link != links_.end())
+			link->second.set_class(CL_OPER);
 		user->set_mode_str('o');
 		rpl_youreoper(choose_sock(user));
 		//send msg to other servers to make user operator
@@ -344,8 +478,10 @@ eResult	Irisha::NICK_user(User* const connection, const int sock, const std::str
 		err_nicknameinuse(sock, new_nick);
 		return R_FAILURE;
 	}
-	send_msg(sock, old_nick, "NICK " + new_nick); // Reply for user about nick changing success
+	send_msg(sock, connection, "NICK " + new_nick); // Reply for user about nick changing success
+	rename_connection(old_nick, new_nick);
 	connection->set_nick(new_nick);
+	invalidate_names(connection);
 	send_servers(old_nick, "NICK " + new_nick);
 
 	sys_msg(E_GEAR, "User", old_nick, "changed nick to", new_nick);
@@ -375,7 +511,9 @@ eResult	Irisha::NICK_server(const std::string& new_nick, int source_sock)
 		return R_SUCCESS;
 	}
 	old_nick = user->nick();
+	rename_connection(old_nick, new_nick);
 	user->set_nick(new_nick);	// Change nick for external user
+	invalidate_names(user);
 	sys_msg(E_GEAR, "User", old_nick, "changed nick to", new_nick);
 
 	return R_SUCCESS;
@@ -470,7 +608,7 @@ eResult Irisha::USER(const int sock)
 			user->set_mode_str('i');
 	}
 	rpl_welcome(sock);
-	send_motd(sock);
+	send_motd(sock, user->nick());
 
 	sys_msg(E_MAN, "New local user", user->nick(), "registered!");
 	// NICK <nickname> <hopcount> <username> <host> <servertoken> <umode> <realname>
@@ -527,29 +665,28 @@ eResult Irisha::SERVER(const int sock)
 		(cmd_.arguments_[1].find_first_not_of("0123456789") == std::string::npos))
 	{
 		hopcount = 1;
-		try
-		{
-			token = str_to_int(cmd_.arguments_[1]);
-		}
-		catch(std::exception ex) { return R_FAILURE; }
+		if (!parse_int(cmd_.arguments_[1], token))
+			return R_FAILURE;
 	}
 	//servername, hopcount, token sent
 	else if (cmd_.arguments_.size() == 4
 				&& (cmd_.arguments_[1].find_first_not_of("0123456789") == std::string::npos)
 				&& (cmd_.arguments_[2].find_first_not_of("0123456789") == std::string::npos))
 	{
-		try
-		{
-			hopcount = str_to_int(cmd_.arguments_[1]);
-			token = str_to_int(cmd_.arguments_[2]);
-		}
-		catch(std::exception ex) { return R_FAILURE; }
+		if (!parse_int(cmd_.arguments_[1], hopcount) || !parse_int(cmd_.arguments_[2], token))
+			return R_FAILURE;
 	}
 
 	if (find_server(sock) == nullptr)	//new connection to this server
 	{
 		AConnection* server = new Server(cmd_.arguments_[0], sock, hopcount, token, sock);
-		connections_.insert(std::pair<std::string, AConnection*>(cmd_.arguments_[0], server));
+		add_connection(cmd_.arguments_[0], server);
+		std::map<int, Link>::iterator link = links_.find(sock);
+		if (link != links_.end())
+		{
+			link->second.set_server(true);
+			link->second.set_class(CL_SERVER);
+		}
 		if (sock != parent_fd_)
 		{
 			send_msg(sock, NO_PREFIX, createPASSmsg(password_));
@@ -572,7 +709,7 @@ eResult Irisha::SERVER(const int sock)
 	else	//handle message from known server about new server
 	{
 		AConnection* server = new Server(cmd_.arguments_[0], U_EXTERNAL_CONNECTION, hopcount, token, sock);
-		connections_.insert(std::pair<std::string, AConnection*>(cmd_.arguments_[0], server));
+		add_connection(cmd_.arguments_[0], server);
 
 		//send to connected servers about new server, except current server and server-sender this message
 		std::map<std::string, AConnection*>::iterator it = connections_.begin();
@@ -687,9 +824,7 @@ eResult Irisha::QUIT(const int sock)
 	if (user->socket() != U_EXTERNAL_CONNECTION) // If local user
 	{
 		send_servers(user->nick(), "QUIT " + msg);
-		FD_CLR(sock, &all_fds_);
-		FD_CLR(sock, &read_fds_);
-		close(sock);
+		close_socket(sock);
 	}
 	else
 		send_servers(user->nick(), "QUIT " + msg, sock);
@@ -712,8 +847,34 @@ eResult Irisha::MODE(const int sock) // Доделать !!!
         if (channels_.find(cmd_.arguments_[0]) != channels_.end()){
             if (cmd_.arguments_.size() != 1){
                 if ((cmd_.arguments_[0][0] == '#' || cmd_.arguments_[0][0] == '&' || cmd_.arguments_[0][0] == '+' || cmd_.arguments_[0][0] == '!')){
-                    for (size_t i = 1; i < cmd_.arguments_[1].size(); ++i) {
-                        channels_.find(cmd_.arguments_[0])->second->setMode(cmd_.arguments_[1][i], 1);
+                    Channel* channel = channels_.find(cmd_.arguments_[0])->second;
+                    size_t param = 2;
+                    flag_mode = 1;
+                    for (size_t i = 0; i < cmd_.arguments_[1].size(); ++i) {
+                        char c = cmd_.arguments_[1][i];
+                        if (c == '+' || c == '-'){
+                            flag_mode = (c == '+');
+                            continue;
+                        }
+                        if (c == 'b' || c == 'e' || c == 'I'){
+                            if (param < cmd_.arguments_.size())
+                                set_list_mode(channel, c, flag_mode == 1, cmd_.arguments_[param++], cmd_.prefix_);
+                        }
+                        else if (c == 'o' || c == 'v'){
+                            User* target = (param < cmd_.arguments_.size()) ? find_user(cmd_.arguments_[param++]) : nullptr;
+                            if (target == nullptr || !channel->isUser(target))
+                                continue;
+                            if (c == 'o' && flag_mode == 1)
+                                channel->addOperators(target);
+                            else if (c == 'o')
+                                channel->delOperators(target);
+                            else if (flag_mode == 1)
+                                channel->addModeratorUser(target);
+                            else
+                                channel->delModeratorUser(target);
+                        }
+                        else if (mode_flag.find(c) != std::string::npos && channel->getMode().count(c))
+                            channel->setMode(c, flag_mode);
                     }
                 }
                 else
@@ -752,6 +913,12 @@ eResult Irisha::MODE(const int sock) // Доделать !!!
             send_msg(user->socket(), domain_, "324 " + user->nick() + " " + cmd_.arguments_[0] + " +" + (*itr).second->getListMode());
             return R_SUCCESS;
         }
+        std::string list_query = (cmd_.arguments_[1][0] == '+') ? cmd_.arguments_[1].substr(1) : cmd_.arguments_[1];
+        if (cmd_.arguments_.size() == 2 && list_query.size() == 1 && std::string("beI").find(list_query[0]) != std::string::npos){
+            if (cmd_.type_ == T_LOCAL_CLIENT) // Lists can be seen by anyone
+                send_mask_list(user, (*itr).second, list_query[0]);
+            return R_SUCCESS;
+        }
         if (!(*itr).second->isOperator(user)){ // Error is operator
             send_msg(user->socket(), domain_, "482 " + user->nick() + " " + cmd_.arguments_[0] + " :You're not channel operator");
             return R_SUCCESS;
@@ -823,6 +990,32 @@ eResult Irisha::MODE(const int sock) // Доделать !!!
                         arr_param.pop_front();
                     }
                 }
+                else if (cmd_.arguments_[1][i] == 'b' || cmd_.arguments_[1][i] == 'e' || cmd_.arguments_[1][i] == 'I'){ // mask lists
+                    if (arr_param.empty()){
+                        if (cmd_.type_ == T_LOCAL_CLIENT)
+                            send_mask_list(user, (*itr).second, cmd_.arguments_[1][i]);
+                        continue;
+                    }
+                    std::string mask = arr_param.front();
+                    arr_param.pop_front();
+                    if (flag_mode == 1 && (*itr).second->getMasks(cmd_.arguments_[1][i]).size() >= MASK_LIST_MAX){
+                        if (cmd_.type_ == T_LOCAL_CLIENT)
+                            send_msg(user->socket(), domain_, "478 " + user->nick() + " " + cmd_.arguments_[0] + " " + mask + " :Channel list is full");
+                        continue;
+                    }
+                    if (!set_list_mode((*itr).second, cmd_.arguments_[1][i], flag_mode == 1, mask, user->nick()))
+                        continue;
+                    if (flag_mode == 0 && (add_flag == 0 || add_flag == 2)) {
+                        return_mode.push_back('-');
+                        add_flag = 1;
+                    }
+                    else if (flag_mode == 1 && (add_flag == 0 || add_flag == 1)) {
+                        return_mode.push_back('+');
+                        add_flag = 2;
+                    }
+                    return_mode.push_back(cmd_.arguments_[1][i]);
+                    std_params.append(mask + " ");
+                }
                 else if (cmd_.arguments_[1][i] == 'v'){ // mode voice
                     if (arr_param.empty() || !is_a_valid_nick(arr_param.front())){ // empty param or nick not valid
                         if (!arr_param.empty())
@@ -857,13 +1050,15 @@ eResult Irisha::MODE(const int sock) // Доделать !!!
                 }
             }
         }
+        if (return_mode.empty())
+            return R_SUCCESS;
         if (!std_params.empty()){
             std_params.pop_back();
             return_mode.append(" " + std_params);
         }
         if (cmd_.type_ == T_LOCAL_CLIENT)
-            send_msg(user->socket(), user->nick(), "MODE " + cmd_.arguments_[0] + " " + return_mode);
-        send_channel((*itr).second, "MODE " + cmd_.arguments_[0] + " " + return_mode, user->nick(), sock);
+            send_msg(user->socket(), user, "MODE " + cmd_.arguments_[0] + " " + return_mode);
+        send_channel((*itr).second, "MODE " + cmd_.arguments_[0] + " " + return_mode, user, sock);
     }
     else{ // user mode
         if (find_user(cmd_.arguments_[0]) == nullptr){
@@ -894,7 +1089,7 @@ eResult Irisha::MODE(const int sock) // Доделать !!!
                 continue;
             if (cmd_.arguments_[1][i] == 'o'){
                 if (flag_mode == 1){
-                    if (user->mode_str().find(cmd_.arguments_[1][i]) == std::string::npos){
+                    if (!user->has_mode(cmd_.arguments_[1][i])){
                         user->set_mode_str('o');
                         if (add_flag == 0 || add_flag == 1) {
                             return_mode.push_back('+');
@@ -903,7 +1098,7 @@ eResult Irisha::MODE(const int sock) // Доделать !!!
                         return_mode.push_back(cmd_.arguments_[1][i]);
                     }
                 } else {
-                    if (user->mode_str().find(cmd_.arguments_[1][i]) != std::string::npos){
+                    if (user->has_mode(cmd_.arguments_[1][i])){
                         user->del_mode_str('o');
                         if (add_flag == 0 || add_flag == 2) {
                             return_mode.push_back('-');
@@ -916,7 +1111,7 @@ eResult Irisha::MODE(const int sock) // Доделать !!!
             }
             if (cmd_.arguments_[1][i] == 'i'){
                 if (flag_mode == 1){
-                    if (user->mode_str().find(cmd_.arguments_[1][i]) == std::string::npos){
+                    if (!user->has_mode(cmd_.arguments_[1][i])){
                         user->set_mode_str('i');
                         if (add_flag == 0 || add_flag == 1) {
                             return_mode.push_back('+');
@@ -925,7 +1120,7 @@ eResult Irisha::MODE(const int sock) // Доделать !!!
                         return_mode.push_back(cmd_.arguments_[1][i]);
                     }
                 } else {
-                    if (user->mode_str().find(cmd_.arguments_[1][i]) != std::string::npos){
+                    if (user->has_mode(cmd_.arguments_[1][i])){
                         user->del_mode_str('i');
                         if (add_flag == 0 || add_flag == 2) {
                             return_mode.push_back('-');
@@ -940,16 +1135,15 @@ eResult Irisha::MODE(const int sock) // Доделать !!!
         if (return_mode.empty())
             return R_SUCCESS;
         if (cmd_.type_ == T_LOCAL_CLIENT)
-            send_msg(user->socket(), user->nick(), "MODE " + cmd_.arguments_[0] + " " + return_mode);
+            send_msg(user->socket(), user, "MODE " + cmd_.arguments_[0] + " " + return_mode);
         send_servers(user->nick(), "MODE " + cmd_.arguments_[0] + " " + return_mode, sock);
     }
     return R_SUCCESS;
 }
 
-int     Irisha::check_mode_channel(const Channel* channel, const int sock, std::list<std::string>& arr_key, std::string& arr_channel)
+int     Irisha::check_mode_channel(const Channel* channel, User* user, const int sock, std::list<std::string>& arr_key, std::string& arr_channel)
 {
-    CITERATOR itr = channel->getBanUsers().begin();
-    CITERATOR ite = channel->getBanUsers().end();
+    std::string prefix = user->prefix();
     if (!channel->getKey().empty()){
         if (arr_key.empty() || arr_key.front() != channel->getKey()) {
             send_msg(sock, domain_, "475 " + arr_channel + " :Cannot join channel (+k)");
@@ -958,26 +1152,13 @@ int     Irisha::check_mode_channel(const Channel* channel, const int sock, std::
         }
         arr_key.pop_front();
     }
-    while (itr != ite)
-    {
-        if ((*itr) == find_user(sock)){
-            send_msg(sock, domain_, "474 " + arr_channel + " :Cannot join channel (+b)");
-            return 1;
-        }
-        itr++;
+    if (channel->isBanned(prefix)){
+        send_msg(sock, domain_, "474 " + arr_channel + " :Cannot join channel (+b)");
+        return 1;
     }
-    if (channel->getMode().find('i')->second == 1){
-        itr = channel->getInviteUsers().begin();
-        ite = channel->getInviteUsers().end();
-        while (itr != ite){
-            if ((*itr) == find_user(sock))
-                break;
-            itr++;
-        }
-        if (itr == ite){
-            send_msg(sock, domain_, "473 " + arr_channel + " :Cannot join channel (+i)");
-            return 1;
-        }
+    if (channel->getMode().find('i')->second == 1 && !channel->isInvited(user, prefix)){
+        send_msg(sock, domain_, "473 " + arr_channel + " :Cannot join channel (+i)");
+        return 1;
     }
     if (channel->getMode().find('l')->second == 1){
         if (channel->getUsers().size() >= static_cast<size_t>(channel->getMaxUsers())){
@@ -1012,42 +1193,38 @@ eResult Irisha::JOIN(const int sock)
                     err_nosuchchannel(sock, arr_channel[i]);
                     continue;
                 }
-                //send_msg(sock, "", ":" + user->nick() + " JOIN " + arr_channel[i]);
                 Channel* channel = new Channel(arr_channel[i]);
                 channel->setType(arr_channel[i][0]);
                 channel->addOperators(user);
-                channel->addUser(user);
-                user->set_channel(arr_channel[i]);
                 if (!arr_key.empty())
                     channel->setKey(arr_key.front());
-                channels_.insert(std::pair<std::string, Channel*>(arr_channel[i], channel));
+                add_channel(channel);
+                join_channel(channel, user);
                 if (cmd_.type_ == T_LOCAL_CLIENT){
-                    send_msg(user->socket(), "", ":" + user->nick() + " JOIN " + arr_channel[i]);
-                    send_msg(user->socket(), domain_, "353 " + user->nick() + " = " + arr_channel[i] +" :" + channel->getListUsers());
-                    send_msg(user->socket(), domain_, "366 " + user->nick() + " " + arr_channel[i] +" :End of NAMES list");
+                    send_msg(user->socket(), user, "JOIN " + arr_channel[i]);
+                    rpl_namreply(user->socket(), channel, user->nick());
+                    rpl_endofnames(user->socket(), arr_channel[i], user->nick());
                     send_servers(user->nick(), "JOIN " + arr_channel[i]);
                 }
                 else
                     send_servers(user->nick(), "JOIN " + arr_channel[i], sock);
             }
             else{
-				if (check_mode_channel((*itr).second, sock, arr_key, arr_channel[i]) == 1)
+				if (cmd_.type_ == T_LOCAL_CLIENT && check_mode_channel((*itr).second, user, sock, arr_key, arr_channel[i]) == 1)
 					continue;
-				itr->second->addUser(user);
-                user->set_channel(arr_channel[i]);
+				join_channel(itr->second, user);
                 if (cmd_.type_ == T_LOCAL_CLIENT) {
-                    send_msg(user->socket(), "", ":" + user->nick() + " JOIN " + arr_channel[i]);
+                    send_msg(user->socket(), user, "JOIN " + arr_channel[i]);
                     if (itr->second->getTopic().empty())
                         send_msg(user->socket(), domain_, "331 " + user->nick() + " " + arr_channel[i] + " :No topic is set");
                     else
                         send_msg(user->socket(), domain_,
                                  "332 " + user->nick() + " " + arr_channel[i] + " :" + itr->second->getTopic());
-                    send_msg(user->socket(), domain_,
-                             "353 " + user->nick() + " = " + arr_channel[i] + " :" + itr->second->getListUsers());
-                    send_msg(user->socket(), domain_, "366 " + user->nick() + " " + arr_channel[i] + " :End of NAMES list");
+                    rpl_namreply(user->socket(), itr->second, user->nick());
+                    rpl_endofnames(user->socket(), arr_channel[i], user->nick());
 
                 }
-                send_channel((*itr).second, "JOIN " + arr_channel[i], user->nick(), sock);
+                send_channel((*itr).second, "JOIN " + arr_channel[i], user, sock);
             }
         }
     }
@@ -1059,7 +1236,7 @@ eResult Irisha::NJOIN(const int sock)
 	(void)sock;
     std::vector<std::string> arr_users;
 
-    if (cmd_.arguments_.size() == 0)
+    if (cmd_.arguments_.size() < 2 || cmd_.arguments_[1].empty())
         return R_SUCCESS;
     cmd_.arguments_[1].erase(cmd_.arguments_[1].begin());
     parse_arr(arr_users, cmd_.arguments_[1], ',');
@@ -1068,19 +1245,22 @@ eResult Irisha::NJOIN(const int sock)
     {
         Channel* channel = new Channel(cmd_.arguments_[0]);
         channel->setType(cmd_.arguments_[0][0]);
+        add_channel(channel);
         for (size_t i = 0; i < arr_users.size(); ++i) {
-            if (arr_users[i][0] == '@'){
-                arr_users[i].erase(arr_users[i].begin());
-                channel->addOperators(find_user(arr_users[i]));
-            }
-            else if (arr_users[i][0] == '+'){
+            char status = arr_users[i].empty() ? '\0' : arr_users[i][0];
+            if (status == '@' || status == '+')
                 arr_users[i].erase(arr_users[i].begin());
-                channel->addModeratorUser(find_user(arr_users[i]));
-            }
-            channel->addUser(find_user(arr_users[i]));
-            find_user(arr_users[i])->set_channel(cmd_.arguments_[0]);
+            User* member = find_user(arr_users[i]);
+            if (member == nullptr) // Unknown nick, skip it
+                continue;
+            if (status == '@')
+                channel->addOperators(member);
+            else if (status == '+')
+                channel->addModeratorUser(member);
+            join_channel(channel, member);
         }
-        channels_.insert(std::pair<std::string, Channel*>(cmd_.arguments_[0], channel));
+        if (channel->getUsers().empty())
+            remove_channel(channel);
     }
     return R_SUCCESS;
 }
@@ -1109,26 +1289,14 @@ eResult Irisha::PART(const int sock)
                              "442 " + user->nick() + " " + arr_channel[i] + " :You're not on that channel");
                     continue;
                 }
-                send_channel((*itr).second, "PART " + arr_channel[i], user->nick());
-                (*itr).second->delUser(user);
-                (*itr).second->delOperators(user);
-                user->del_channel(arr_channel[i]);
-                if ((*itr).second->getUsers().size() == 0) {
-                    channels_.erase(itr);
-                    delete ((*itr).second);
-                    //return R_SUCCESS;
-                }
+                send_channel((*itr).second, "PART " + arr_channel[i], user);
+                part_channel((*itr).second, user);
             }
             else{
-                send_channel((*itr).second, "PART " + arr_channel[i], user->nick(), choose_sock(user));
-                (*itr).second->delUser(user);
-                (*itr).second->delOperators(user);
-                user->del_channel(arr_channel[i]);
-                if ((*itr).second->getUsers().size() == 0) {
-                    delete ((*itr).second);
-                    channels_.erase(itr);
-                    //return R_SUCCESS;
-                }
+                if (itr == channels_.end() || !(*itr).second->isUser(user))
+                    continue;
+                send_channel((*itr).second, "PART " + arr_channel[i], user, choose_sock(user));
+                part_channel((*itr).second, user);
 
             }
         }
@@ -1185,7 +1353,7 @@ eResult Irisha::TOPIC(const int sock)
         if (cmd_.arguments_[1] == (*itr).second->getTopic())
             return R_SUCCESS;
         (*itr).second->setTopic(cmd_.arguments_[1]);
-        send_channel((*itr).second, "TOPIC " + cmd_.arguments_[0] + " :" + cmd_.arguments_[1], user->nick());
+        send_channel((*itr).second, "TOPIC " + cmd_.arguments_[0] + " :" + cmd_.arguments_[1], user);
     }
     return R_SUCCESS;
 }
@@ -1205,46 +1373,43 @@ eResult Irisha::PRIVMSG(const int sock)
         return R_SUCCESS;
     }
 
-    std::list<std::string> arr_receiver;
-    std::string str_receiver = cmd_.arguments_[0];
+    ScratchVector<std::string> arr_receiver(scratch_);
+    ScratchString line(scratch_);
     User* user;
 
-    parse_arr_list(arr_receiver, str_receiver, ',');
-    arr_receiver.sort();
-    arr_receiver.unique();
-    while (!arr_receiver.empty()){
-        if ((arr_receiver.front()[0] == '#' || arr_receiver.front()[0] == '&' || arr_receiver.front()[0] == '+' || arr_receiver.front()[0] == '!')){
-            std::map<std::string, Channel*>::iterator itr = channels_.find(arr_receiver.front());
+    parse_arr(arr_receiver, cmd_.arguments_[0], ',');
+    std::sort(arr_receiver.begin(), arr_receiver.end());
+    arr_receiver.erase(std::unique(arr_receiver.begin(), arr_receiver.end()), arr_receiver.end());
+    for (size_t i = 0; i < arr_receiver.size(); ++i){
+        const std::string& receiver = arr_receiver[i];
+        line.assign("PRIVMSG ").append(receiver.data(), receiver.size()).append(" ").append(cmd_.arguments_[1].data(), cmd_.arguments_[1].size());
+        if ((receiver[0] == '#' || receiver[0] == '&' || receiver[0] == '+' || receiver[0] == '!')){
+            std::map<std::string, Channel*>::iterator itr = channels_.find(receiver);
             if (itr == channels_.end()){
-                err_nosuchnick(sender->socket(), arr_receiver.front());
-                arr_receiver.pop_front();
+                err_nosuchnick(sender->socket(), receiver);
                 continue;
             }
             if (!(*itr).second->isUser(sender) && (*itr).second->getMode().find('n')->second == 1){
-                send_msg(sender->socket(), domain_, "404 " + sender->nick() + " " + arr_receiver.front() + " :Cannot send to channel");
-                arr_receiver.pop_front();
+                send_msg(sender->socket(), domain_, "404 " + sender->nick() + " " + receiver + " :Cannot send to channel");
                 continue;
             }
             if (!(*itr).second->isModerator(sender) && !(*itr).second->isOperator(sender) && (*itr).second->getMode().find('m')->second == 1){
-                send_msg(sender->socket(), domain_, "404 " + sender->nick() + " " + arr_receiver.front() + " :Cannot send to channel");
-                arr_receiver.pop_front();
+                send_msg(sender->socket(), domain_, "404 " + sender->nick() + " " + receiver + " :Cannot send to channel");
                 continue;
             }
             if (cmd_.type_ == T_LOCAL_CLIENT)
-                send_channel((*itr).second, "PRIVMSG " + arr_receiver.front() + " " + cmd_.arguments_[1], sender->nick(), sock);
+                send_channel((*itr).second, line, sender, sock);
             else
-                send_channel((*itr).second, "PRIVMSG " + arr_receiver.front() + " " + cmd_.arguments_[1], sender->nick(), choose_sock(sender));
+                send_channel((*itr).second, line, sender, choose_sock(sender));
         } else {
-			user = find_user(arr_receiver.front());
+			user = find_user(receiver);
 			if (user == nullptr)
 			{
-				err_nosuchnick(sock, arr_receiver.front());
-				arr_receiver.pop_front();
+				err_nosuchnick(sock, receiver);
 				continue;
 			}
-			send_msg(choose_sock(user), sender->nick(), "PRIVMSG " + arr_receiver.front() + " " + cmd_.arguments_[1]);
+			send_msg(choose_sock(user), sender, line);
         }
-        arr_receiver.pop_front();
     }
     return R_SUCCESS;
 }
@@ -1257,43 +1422,36 @@ eResult Irisha::NOTICE(const int sock)
     User* sender;
     if (check_user(sock, sender, cmd_.prefix_) == R_FAILURE)
         return R_FAILURE;
-    std::list<std::string> arr_receiver;
-    std::string str_receiver = cmd_.arguments_[0];
+    if (cmd_.arguments_.size() < 2)     // NOTICE is never answered, not even with errors
+        return R_SUCCESS;
+    ScratchVector<std::string> arr_receiver(scratch_);
+    ScratchString line(scratch_);
     User* user;
 
-    parse_arr_list(arr_receiver, str_receiver, ',');
-    arr_receiver.sort();
-    arr_receiver.unique();
-    while (!arr_receiver.empty()){
-        if ((arr_receiver.front()[0] == '#' || arr_receiver.front()[0] == '&' || arr_receiver.front()[0] == '+' || arr_receiver.front()[0] == '!')){
-            std::map<std::string, Channel*>::iterator itr = channels_.find(arr_receiver.front());
-            if (itr == channels_.end()){
-                arr_receiver.pop_front();
+    parse_arr(arr_receiver, cmd_.arguments_[0], ',');
+    std::sort(arr_receiver.begin(), arr_receiver.end());
+    arr_receiver.erase(std::unique(arr_receiver.begin(), arr_receiver.end()), arr_receiver.end());
+    for (size_t i = 0; i < arr_receiver.size(); ++i){
+        const std::string& receiver = arr_receiver[i];
+        line.assign("NOTICE ").append(receiver.data(), receiver.size()).append(" ").append(cmd_.arguments_[1].data(), cmd_.arguments_[1].size());
+        if ((receiver[0] == '#' || receiver[0] == '&' || receiver[0] == '+' || receiver[0] == '!')){
+            std::map<std::string, Channel*>::iterator itr = channels_.find(receiver);
+            if (itr == channels_.end())
                 continue;
-            }
-            if (!(*itr).second->isUser(sender) && (*itr).second->getMode().find('n')->second == 1){
-                arr_receiver.pop_front();
+            if (!(*itr).second->isUser(sender) && (*itr).second->getMode().find('n')->second == 1)
                 continue;
-            }
-            if (!(*itr).second->isModerator(sender) && !(*itr).second->isOperator(sender) && (*itr).second->getMode().find('m')->second == 1){
-                arr_receiver.pop_front();
+            if (!(*itr).second->isModerator(sender) && !(*itr).second->isOperator(sender) && (*itr).second->getMode().find('m')->second == 1)
                 continue;
-            }
             if (cmd_.type_ == T_LOCAL_CLIENT)
-                send_channel((*itr).second, "PRIVMSG " + arr_receiver.front() + " " + cmd_.arguments_[1], sender->nick(), sock);
+                send_channel((*itr).second, line, sender, sock);
             else
-                send_channel((*itr).second, "PRIVMSG " + arr_receiver.front() + " " + cmd_.arguments_[1], sender->nick(), choose_sock(sender));
+                send_channel((*itr).second, line, sender, choose_sock(sender));
         } else {
-			user = find_user(arr_receiver.front());
+			user = find_user(receiver);
 			if (user == nullptr)
-			{
-				err_nosuchnick(sock, arr_receiver.front());
-				arr_receiver.pop_front();
 				continue;
-			}
-			send_msg(choose_sock(user), sender->nick(), "PRIVMSG " + arr_receiver.front() + " " + cmd_.arguments_[1]);
+			send_msg(choose_sock(user), sender, line);
         }
-        arr_receiver.pop_front();
     }
     return R_SUCCESS;
 }
@@ -1315,33 +1473,287 @@ eResult Irisha::NAMES(const int sock) // list users channels
                 continue;
             if (itr->second->getMode().find('s')->second == 1 && !itr->second->isUser(find_user(sock)))
                     continue;
-            send_msg(user->socket(), domain_, "353 " + user->nick() + " = " + arr_channel[i] +" :" + itr->second->getListUsers());
-            send_msg(user->socket(), domain_, "366 " + user->nick() + " " + arr_channel[i] +" :End of NAMES list");
+            rpl_namreply(user->socket(), itr->second, user->nick());
+            rpl_endofnames(user->socket(), arr_channel[i], user->nick());
         }
     }
     return R_SUCCESS;
 }
 
-eResult Irisha::LIST(const int sock) // list server ?
+/**
+ * @description	LIST [<channels> | <filters>]: filters are ELIST-like
+ * 				(">n", "<n", "C<m", "C>m", "T<m", "T>m", "mask", "!mask").
+ * 				The reply is streamed while the client sendq has room,
+ * 				the rest is sent on the next loop iterations
+ * @param		sock
+ * @return		R_SUCCESS or R_FAILURE
+ */
+eResult Irisha::LIST(const int sock)
 {
-    std::map<std::string ,Channel*>::iterator itr = channels_.begin();
-    std::map<std::string ,Channel*>::iterator ite = channels_.end();
     User* user;
 
     if (check_user(sock, user, cmd_.prefix_) == R_FAILURE)
         return R_FAILURE;
-    while (itr != ite){
-        if (itr->second->getMode().find('s')->second == 1 && !itr->second->isUser(user)){
-            itr++;
-            continue;
-        }
-        send_msg(user->socket(), domain_, "322 " + user->nick() + " " + itr->second->getName() + " " + int_to_str(itr->second->getUsers().size()) + " :" + itr->second->getTopic());
-        itr++;
-    }
-    send_msg(user->socket(), domain_, "323 " + user->nick() + " :End of /LIST");
+    if (user->socket() == U_EXTERNAL_CONNECTION)
+        return R_SUCCESS;
+    ListQuery& query = list_queries_[user->socket()];	// A new LIST replaces the one in progress
+    query = ListQuery();
+    query.user = user;
+    if (!cmd_.arguments_.empty())
+        query.parse(cmd_.arguments_[0], get_time());
+    if (continue_list(user->socket(), query))
+        list_queries_.erase(user->socket());
     return R_SUCCESS;
 }
 
+/**
+ * @description	Picks the index that narrows a mask search: the forward one by the
+ * 				literal head, the reversed one by the literal tail, or a full walk
+ * @param		mask
+ * @param		forward, reversed: index by key and by reversed key
+ * @param		index: chosen index
+ * @param		key: keys to walk start with it
+ */
+static void	pick_index(const Mask& mask, const std::multimap<std::string, User*>& forward,
+					   const std::multimap<std::string, User*>& reversed,
+					   const std::multimap<std::string, User*>*& index, std::string& key)
+{
+	if (!mask.prefix().empty() || mask.suffix().empty())
+	{
+		index = &forward;
+		key = mask.prefix();
+	}
+	else
+	{
+		index = &reversed;
+		key.assign(mask.suffix().rbegin(), mask.suffix().rend());
+	}
+}
+
+/**
+ * @description	Appends RPL_WHOREPLY about target
+ * @param		batch
+ * @param		viewer: receiver
+ * @param		target
+ * @param		channel: channel of WHO #channel or nullptr
+ */
+void Irisha::who_reply(std::string& batch, User* viewer, User* target, Channel* channel) const
+{
+	std::string flags = target->has_mode('a') ? "G" : "H";
+	if (target->is_operator())
+		flags += "*";
+	if (channel != nullptr && channel->isOperator(target))
+		flags += "@";
+	else if (channel != nullptr && channel->isModerator(target))
+		flags += "+";
+	batch_rpl(batch, RPL_WHOREPLY, viewer->nick(), (channel ? channel->getName() : "*") + " " + target->username()
+			  + " " + target->host() + " " + user_server(target) + " " + target->nick() + " " + flags
+			  + " :" + int_to_str(target->hopcount()) + " " + target->realname());
+}
+
+/**
+ * @description	Appends WHO replies for users which nick or host matches mask.
+ * 				Nick and host indexes are walked only where keys share the
+ * 				literal head (or tail) of the mask
+ * @param		batch
+ * @param		viewer: receiver
+ * @param		mask
+ * @param		opers_only: WHO <mask> o
+ */
+void Irisha::who_mask(std::string& batch, User* viewer, const std::string& mask, bool opers_only) const
+{
+	typedef std::multimap<std::string, User*>::const_iterator index_it;
+	Mask										compiled(mask);
+	const std::multimap<std::string, User*>*	index;
+	std::string									key;
+
+	pick_index(compiled, nicks_, nicks_reversed_, index, key);
+	for (index_it it = index->lower_bound(key); it != index->end() && it->first.compare(0, key.size(), key) == 0; ++it)
+	{
+		User* target = it->second;
+		if (compiled.match(target->nick()) && (!opers_only || target->is_operator()) && is_visible_to(target, viewer))
+			who_reply(batch, viewer, target, nullptr);
+	}
+	pick_index(compiled, hosts_, hosts_reversed_, index, key);
+	for (index_it it = index->lower_bound(key); it != index->end() && it->first.compare(0, key.size(), key) == 0; ++it)
+	{
+		User* target = it->second;
+		if (compiled.match(target->host()) && !compiled.match(target->nick())	// Matched nicks are sent above
+			&& (!opers_only || target->is_operator()) && is_visible_to(target, viewer))
+			who_reply(batch, viewer, target, nullptr);
+	}
+}
+
+/**
+ * @description	WHO [<mask> ["o"]]: channel members for a channel name,
+ * 				otherwise users which nick or host matches the mask
+ * @param		sock
+ * @return		R_SUCCESS or R_FAILURE
+ */
+eResult Irisha::WHO(const int sock)
+{
+	User*		user;
+	std::string	batch;
+
+	if (check_user(sock, user, cmd_.prefix_) == R_FAILURE)
+		return R_FAILURE;
+	if (user->socket() == U_EXTERNAL_CONNECTION)
+		return R_SUCCESS;
+	std::string	mask		= (cmd_.arguments_.empty() || cmd_.arguments_[0] == "0") ? "*" : cmd_.arguments_[0];
+	bool		opers_only	= (cmd_.arguments_.size() > 1 && cmd_.arguments_[1] == "o");
+
+	if (mask[0] == '#' || mask[0] == '&' || mask[0] == '+' || mask[0] == '!')
+	{
+		std::map<std::string, Channel*>::iterator itr = channels_.find(mask);
+		if (itr != channels_.end())
+		{
+			Channel*	channel	= itr->second;
+			bool		member	= channel->isUser(user);
+			if (member || channel->getMode().find('s')->second == 0)
+			{
+				const std::vector<User*>& members = channel->getUsers();
+				for (size_t i = 0; i < members.size(); ++i)
+				{
+					if (opers_only && !members[i]->is_operator())
+						continue;
+					if (member || !members[i]->has_mode('i'))
+						who_reply(batch, user, members[i], channel);
+				}
+			}
+		}
+	}
+	else
+		who_mask(batch, user, mask, opers_only);
+	batch_rpl(batch, RPL_ENDOFWHO, user->nick(), mask + " :End of WHO list");
+	queue_msg(user->socket(), batch);
+	return R_SUCCESS;
+}
+
+/**
+ * @description	Appends WHOIS replies about target (without RPL_ENDOFWHOIS)
+ * @param		batch
+ * @param		viewer: receiver
+ * @param		target
+ */
+void Irisha::whois_reply(std::string& batch, User* viewer, User* target) const
+{
+	const std::string& nick = viewer->nick();
+
+	batch_rpl(batch, RPL_WHOISUSER, nick, target->nick() + " " + target->username() + " " + target->host()
+			  + " * :" + target->realname());
+	std::string list;
+	std::vector<Atom>& names = target->channels();
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		std::map<std::string, Channel*>::const_iterator itr = channels_.find(names[i]);
+		if (itr == channels_.end())
+			continue;
+		Channel* channel = itr->second;
+		if (viewer != target && channel->getMode().find('s')->second == 1 && !channel->isUser(viewer))
+			continue;
+		if (list.size() + names[i].str().size() > IRC_LINE_MAX - 100)	// Leave room for prefix and nicks
+		{
+			batch_rpl(batch, RPL_WHOISCHANNELS, nick, target->nick() + " :" + list);
+			list.clear();
+		}
+		if (!list.empty())
+			list += " ";
+		if (channel->isOperator(target))
+			list += "@";
+		else if (channel->isModerator(target))
+			list += "+";
+		list += names[i];
+	}
+	if (!list.empty())
+		batch_rpl(batch, RPL_WHOISCHANNELS, nick, target->nick() + " :" + list);
+	batch_rpl(batch, RPL_WHOISSERVER, nick, target->nick() + " " + user_server(target) + " :IRC server");
+	if (target->is_operator())
+		batch_rpl(batch, RPL_WHOISOPERATOR, nick, target->nick() + " :is an IRC operator");
+	if (target->socket() != U_EXTERNAL_CONNECTION)
+		batch_rpl(batch, RPL_WHOISIDLE, nick, target->nick() + " " + int_to_str(static_cast<int>(target->last_msg_time()))
+				  + " " + ulong_to_str(static_cast<unsigned long>(target->launch_time())) + " :seconds idle, signon time");
+}
+
+/**
+ * @description	WHOIS [<server>] <nick>[,<nick>]: nicks are looked up in any case
+ * @param		sock
+ * @return		R_SUCCESS or R_FAILURE
+ */
+eResult Irisha::WHOIS(const int sock)
+{
+	User*						user;
+	std::vector<std::string>	nicks;
+	std::string					batch;
+
+	if (check_user(sock, user, cmd_.prefix_) == R_FAILURE)
+		return R_FAILURE;
+	if (user->socket() == U_EXTERNAL_CONNECTION)
+		return R_SUCCESS;
+	if (cmd_.arguments_.empty())
+	{
+		err_nonicknamegiven(sock);
+		return R_FAILURE;
+	}
+	std::string list = cmd_.arguments_.back();
+	parse_arr(nicks, list, ',');
+	for (size_t i = 0; i < nicks.size(); ++i)
+	{
+		User* target = find_user_folded(nicks[i]);
+		if (target == nullptr)
+			batch_rpl(batch, ERR_NOSUCHNICK, user->nick(), nicks[i] + " :No such nick/channel");
+		else
+			whois_reply(batch, user, target);
+		batch_rpl(batch, RPL_ENDOFWHOIS, user->nick(), nicks[i] + " :End of WHOIS list");
+	}
+	queue_msg(user->socket(), batch);
+	return R_SUCCESS;
+}
+
+/**
+ * @description	WHOWAS <nick>[,<nick>] [<count>]: newest entries first
+ * @param		sock
+ * @return		R_SUCCESS or R_FAILURE
+ */
+eResult Irisha::WHOWAS(const int sock)
+{
+	User*							user;
+	std::vector<std::string>		nicks;
+	std::vector<const WhowasEntry*>	entries;
+	std::string						batch;
+
+	if (check_user(sock, user, cmd_.prefix_) == R_FAILURE)
+		return R_FAILURE;
+	if (user->socket() == U_EXTERNAL_CONNECTION)
+		return R_SUCCESS;
+	if (cmd_.arguments_.empty())
+	{
+		err_nonicknamegiven(sock);
+		return R_FAILURE;
+	}
+	int count = (cmd_.arguments_.size() > 1) ? str_to_int(cmd_.arguments_[1]) : 0;
+	std::string list = cmd_.arguments_[0];
+	parse_arr(nicks, list, ',');
+	for (size_t i = 0; i < nicks.size(); ++i)
+	{
+		entries.clear();
+		whowas_.find(nicks[i], (count > 0) ? static_cast<size_t>(count) : 0, entries);
+		if (entries.empty())
+			batch_rpl(batch, ERR_WASNOSUCHNICK, user->nick(), nicks[i] + " :There was no such nickname");
+		for (size_t j = 0; j < entries.size(); ++j)
+		{
+			const WhowasEntry* entry = entries[j];
+			std::string when = ctime(&entry->time);
+			when.erase(when.size() - 1);
+			batch_rpl(batch, RPL_WHOWASUSER, user->nick(), entry->nick + " " + entry->username + " " + entry->host
+					  + " * :" + entry->realname);
+			batch_rpl(batch, RPL_WHOISSERVER, user->nick(), entry->nick + " " + entry->server + " :" + when);
+		}
+		batch_rpl(batch, RPL_ENDOFWHOWAS, user->nick(), nicks[i] + " :End of WHOWAS");
+	}
+	queue_msg(user->socket(), batch);
+	return R_SUCCESS;
+}
+
 eResult Irisha::INVITE(const int sock) {
     std::map<std::string, Channel *>::iterator itr = channels_.find(cmd_.arguments_[1]);
     User* user;
@@ -1395,13 +1807,18 @@ eResult Irisha::KICK(const int sock)
         err_notochannel(sock, cmd_.arguments_[0]);
         return R_SUCCESS;
     }
+    size_t members = (*itr).second->getUsers().size();
     (*itr).second->delUser(user);
+    user->del_channel((*itr).second->getNameAtom());
+    reindex_channel((*itr).second, members);
     if (user->socket() != U_EXTERNAL_CONNECTION)
-        send_msg(user->socket(), sender->nick(), "KICK " + cmd_.arguments_[0] + " " + cmd_.arguments_[1] + " " + cmd_.arguments_[2]);
+        send_msg(user->socket(), sender, "KICK " + cmd_.arguments_[0] + " " + cmd_.arguments_[1] + " " + cmd_.arguments_[2]);
     if (sender->socket() != U_EXTERNAL_CONNECTION)
-        send_msg(sock, sender->nick(), "KICK " + cmd_.arguments_[0] + " " + cmd_.arguments_[1] + " " + cmd_.arguments_[2]);
-//        send_msg(user->socket(), sender->nick(), "KICK " + cmd_.arguments_[0] + " " + cmd_.arguments_[1] + " " + cmd_.arguments_[2]);
-    send_channel((*itr).second, "KICK " + cmd_.arguments_[0] + " " + cmd_.arguments_[1] + " " + cmd_.arguments_[2], sender->nick(), sock);
+        send_msg(sock, sender, "KICK " + cmd_.arguments_[0] + " " + cmd_.arguments_[1] + " " + cmd_.arguments_[2]);
+//        send_msg(user->socket(), sender, "KICK " + cmd_.arguments_[0] + " " + cmd_.arguments_[1] + " " + cmd_.arguments_[2]);
+    send_channel((*itr).second, "KICK " + cmd_.arguments_[0] + " " + cmd_.arguments_[1] + " " + cmd_.arguments_[2], sender, sock);
+    if ((*itr).second->getUsers().empty())
+        remove_channel((*itr).second);
 //    }
 //    else
 //        send_servers(sender->nick(), "KICK " + cmd_.arguments_[0] + " " + cmd_.arguments_[1] + " " + cmd_.arguments_[2], sock);
@@ -1410,7 +1827,7 @@ eResult Irisha::KICK(const int sock)
 //:WiZ KICK #Finnish John
 eResult Irisha::TIME(const int sock)
 {
-	time_t	current_time = time(nullptr);
+	time_t	current_time = get_time();
 	std::string local_time = ctime(&current_time);
 	local_time = local_time.substr(0, local_time.length() - 1);
 	if (!cmd_.arguments_.empty())
@@ -1472,6 +1889,70 @@ eResult Irisha::KILL(const int sock)
 	return R_FAILURE;
 }
 
+/**
+ * @description	ZLINE [-]<network>: adds (or removes with '-') a Z-line of this
+ * 				server. Local users from the network are disconnected, a Z-line
+ * 				covering the address of the issuer is refused
+ * @param		sock
+ * @return		R_SUCCESS or R_FAILURE
+ */
+eResult Irisha::ZLINE(const int sock)
+{
+	User* user;
+
+	if (check_user(sock, user, cmd_.prefix_) == R_FAILURE)
+		return R_FAILURE;
+	if (user->socket() == U_EXTERNAL_CONNECTION)	// Z-lines aren't propagated
+		return R_SUCCESS;
+	if (!user->is_operator())
+	{
+		err_noprivileges(sock);
+		return R_FAILURE;
+	}
+	if (cmd_.arguments_.empty())
+	{
+		err_needmoreparams(sock, "ZLINE");
+		return R_FAILURE;
+	}
+	std::string	network	= cmd_.arguments_[0];
+	bool		remove	= (network[0] == '-');
+	if (remove)
+		network.erase(0, 1);
+	std::map<int, Link>::const_iterator	own	= links_.find(sock);
+	CidrTrie							rule;	// The new Z-line alone, to check the issuer against it
+	if (!remove && own != links_.end() && own->second.peer() != nullptr
+		&& rule.add(network, CIDR_BAN) && rule.lookup(own->second.peer()) == CIDR_BAN)
+	{
+		send_msg(sock, domain_, "NOTICE " + user->nick() + " :Z-line " + network + " covers your own address");
+		return R_FAILURE;
+	}
+	if (remove ? !ip_rules_.remove(network, CIDR_BAN) : !ip_rules_.add(network, CIDR_BAN))
+	{
+		send_msg(sock, domain_, "NOTICE " + user->nick() + " :" + (remove ? "No such Z-line " : "Wrong network ") + network);
+		return R_FAILURE;
+	}
+	send_msg(sock, domain_, "NOTICE " + user->nick() + " :Z-line " + network + (remove ? " removed" : " added"));
+	if (remove)
+		return R_SUCCESS;
+
+	std::vector<int> victims;	// Local clients and unregistered connections, by their address from accept()
+	for (std::map<int, Link>::const_iterator it = links_.begin(); it != links_.end(); ++it)
+	{
+		const sockaddr* peer = it->second.peer();
+		if (peer == nullptr || it->second.server() || ip_rules_.lookup(peer) != CIDR_BAN)
+			continue;
+		std::map<int, AConnection*>::const_iterator con = sockets_.find(it->first);
+		if (con == sockets_.end() || con->second->type() == T_CLIENT)
+			victims.push_back(it->first);
+	}
+	for (size_t i = 0; i < victims.size(); ++i)
+	{
+		send_msg(victims[i], domain_, "ERROR :Closing Link: (Z-lined)");
+		close_connection(victims[i], "Z-lined", &reg_expect_);
+	}
+	return R_SUCCESS;
+}
+
 void	Irisha::admin_info(const int sock, const std::string& receiver)
 {
 	rpl_adminme(sock, receiver, domain_);
@@ -1575,58 +2056,43 @@ eResult Irisha::RPL_421(const int sock)
     return R_SUCCESS;
 }
 
-void Irisha::send_motd(const int sock)
+/**
+ * @description	Queues the pre-rendered MOTD block addressed to target at once
+ * @param		sock: receiver socket
+ * @param		target: receiver nick
+ */
+void Irisha::send_motd(const int sock, const std::string& target)
 {
-	rpl_motdstart(sock, domain_);
-	rpl_motd(sock, " __      __          ___                                          __");
-	rpl_motd(sock, "/\\ \\  __/\\ \\        /\\_ \\                                        /\\ \\__");
-	rpl_motd(sock, "\\ \\ \\/\\ \\ \\ \\     __\\//\\ \\     ___    ___     ___ ___      __    \\ \\ ,_\\   ___");
-	rpl_motd(sock, " \\ \\ \\ \\ \\ \\ \\  /'__`\\\\ \\ \\   /'___\\ / __`\\ /' __` __`\\  /'__`\\   \\ \\ \\/  / __`\\");
-	rpl_motd(sock, "  \\ \\ \\_/ \\_\\ \\/\\  __/ \\_\\ \\_/\\ \\__//\\ \\L\\ \\/\\ \\/\\ \\/\\ \\/\\  __/    \\ \\ \\_/\\ \\L\\ \\");
-	rpl_motd(sock, "   \\ `\\___x___/\\ \\____\\/\\____\\ \\____\\ \\____/\\ \\_\\ \\_\\ \\_\\ \\____\\    \\ \\__\\ \\____/");
-	rpl_motd(sock, "    '\\/__//__/  \\/____/\\/____/\\/____/\\/___/  \\/_/\\/_/\\/_/\\/____/     \\/__/\\/___/");
-	rpl_motd(sock, "");
-	rpl_motd(sock, "");
-	rpl_motd(sock, " __ __  ______   ____    ______  ____    __  __  ______      ______   ____    ____     __ __");
-	rpl_motd(sock, "/\\ \\\\ \\/\\__  _\\ /\\  _`\\ /\\__  _\\/\\  _`\\ /\\ \\/\\ \\/\\  _  \\    /\\__  _\\ /\\  _`\\ /\\  _`\\  /\\ \\\\ \\");
-	rpl_motd(sock, "\\ \\_\\\\_\\/_/\\ \\/ \\ \\ \\L\\ \\/_/\\ \\/\\ \\,\\L\\_\\ \\ \\_\\ \\ \\ \\L\\ \\   \\/_/\\ \\/ \\ \\ \\L\\ \\ \\ \\/\\_\\\\ \\_\\\\_\\");
-	rpl_motd(sock, " \\/_//_/  \\ \\ \\  \\ \\ ,  /  \\ \\ \\ \\/_\\__ \\\\ \\  _  \\ \\  __ \\     \\ \\ \\  \\ \\ ,  /\\ \\ \\/_/_\\/_//_/");
-	rpl_motd(sock, "           \\_\\ \\__\\ \\ \\\\ \\  \\_\\ \\__/\\ \\L\\ \\ \\ \\ \\ \\ \\ \\/\\ \\     \\_\\ \\__\\ \\ \\\\ \\\\ \\ \\L\\ \\");
-	rpl_motd(sock, "           /\\_____\\\\ \\_\\ \\_\\/\\_____\\ `\\____\\ \\_\\ \\_\\ \\_\\ \\_\\    /\\_____\\\\ \\_\\ \\_\\ \\____/");
-	rpl_motd(sock, "           \\/_____/ \\/_/\\/ /\\/_____/\\/_____/\\/_/\\/_/\\/_/\\/_/    \\/_____/ \\/_/\\/ /\\/___/");
-	rpl_motd(sock, "");
-	rpl_motd(sock, "");
-	rpl_motd(sock, "@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@                                              @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@");
-	rpl_motd(sock, "  @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@                                                  @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@");
-	rpl_motd(sock, "	@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@(          @@@@@@@@&                 /@@@@@@@@@          @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@");
-	rpl_motd(sock, "	  @@@.                                   @@@@@@@@@@@@@@@@@@@@@&          (@@@  @@@@@@               @@@@@@@@@@@@           @@@@@@@@@@@@@@@@@@@@@*                                   #@@@");
-	rpl_motd(sock, "				*@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@ @@@@@@           @@@@  @@@@@ .@@@         @@@@  @@@@@  @@@@          @@@@@@@ @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@");
-	rpl_motd(sock, "		  @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@      /@@@@@@@@@@@@@         @@@@         @@@@@@@@#  @@@@@@@@@         @@@@         @@@@@@@@@@@@@       @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@");
-	rpl_motd(sock, "			@@@@@@@@@@@@@@@@@@@,          /@@@@@@@@@@@@@@@@@@@@@@           @           @@@@@@@    @@@@@@                        @@@@@@@@@@@@@@@@@@@@@@           @@@@@@@@@@@@@@@@@@@");
-	rpl_motd(sock, "			   @@@               ,@@@@@@@@@@@@@@@@@@@@@@  @@@@@@@@                    @   @@@@  @@  @@@   @,                    @@@@@@@   @@@@@@@@@@@@@@@@@@@@@@               %@@@");
-	rpl_motd(sock, "						.@@@@@@@@@@@@@@@@@@@@@@@@     @@@@@@@@@@@@@@           *@@@@@@@@@@  @  @@@@     @@@@@@@@@@           %@@@@@@@@@@@@@@    @@@@@@@@@@@@@@@@@@@@@@@@@");
-	rpl_motd(sock, "					@@@@@@@@@@@@@@@@@@@@@@@      @@@@@@@@@@ @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@  @@@@@@  @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@ @@@@@@@@@&      @@@@@@@@@@@@@@@@@@@@@@@");
-	rpl_motd(sock, "					   @@@@@@@@@@@@@&       @@@@@@@@@@@@ /@@@@@@@@@@@@@@@@@@@@@@@@@@ &@@@@@  @@@@@@@@  @@@@@ @@@@@@@@@@@@@@@@@@@@@@@@@@@  @@@@@@@@@@@        @@@@@@@@@@@@@@");
-	rpl_motd(sock, "						  @@@@          @@@@@@@@@@@@   @@@@@@@@ @@@@@@@@@@@@@@@@@@@  @@@@@  @@@@@@@@@@  @@@@@ @@@@@@@@@@@@@@@@@@@@ @@@@@@@   @@@@@@@@@@@@@         @@@@@");
-	rpl_motd(sock, "								   @@@@@@@@@@@@@@    @@@@@@@@ @@@@@@  @@@@ @@@@  @ @@@@@@  @@@@@@@@@@@@  @@@@@@ @ @@@@@@@@@@ @@@@@@  @@@@@@@@   @@@@@@@@@@@@@@");
-	rpl_motd(sock, "								@@@@@@@@@@@@@@    @@@@@@@@@  @@@@@@  @@@@@ @@@@  @@@@@@@  @@@@@@@@@@@@@@  @@@@@@  @@@@@ @@@@@ @@@@@@@  @@@@@@@@    @@@@@@@@@@@@@@@");
-	rpl_motd(sock, "								   @@@@@@@@     @@@@@@@@@  @@@@@@@  @@@@@  @@@  @@@@@@@  @@@@@@@@@@@@@@@.  @@@@@@@  @@@ @@@@@@  @@@@@@   @@@@@@@@@    @@@@@@@@@");
-	rpl_motd(sock, "									  @@      @@@@@@@@@   @@@@@@@  @@@@@@  @  @@@@@@@@  @@@@@@@@@@@@@@@@@   @@@@@@@@  @  @@@@@   @@@@@@@  @@@@@@@@@@      @@");
-	rpl_motd(sock, "										   @@@@@@@@@@   @@@@@@@@  @@@@@@         @@@@  @@@@@@@@@@@@@@@@@@@   @@@@         @@@@@   @@@@@@@   @@@@@@@@@@");
-	rpl_motd(sock, "											 @@@@@@    @@@@@@@@   @@@@                @@@@@@@@@@@@@@@@@@@@@                @@@@@   @@@@@@@@   @@@@@@");
-	rpl_motd(sock, "													  @@@@@@@@   @@                  @@@@@@@@@@@@@@@@@@@@@@@                   @@   @@@@@@@@");
-	rpl_motd(sock, "																					   @@@@@@@@@@@@@@@@@@@");
-	rpl_motd(sock, "																				    @@@   @@@@@@@@@@@@@    @@@");
-	rpl_motd(sock, "																				  @@@@@   @@@@@@@@@@@@@@  @@@@@");
-	rpl_motd(sock, "																				 @@@@@   @@, @@@@@@@@ @@@  @@@@@ ");
-	rpl_motd(sock, "																		 @@@@@@@@@@@@   @@  @@*@@@ @@@ @@@   @@@@@@@@@@@");
-	rpl_motd(sock, "																		  @@@@@@@@@@@  @@  @@@ @@@@ @@@ @@   @@@@@@@@@@@");
-	rpl_motd(sock, "																		  @  @@@@ @@@@     @@ @@@@@@ @@    @@@@@*@@@");
-	rpl_motd(sock, "																			@@@   @@@        @@@@@@@         @@@  @@@@");
-	rpl_motd(sock, "																		   @@@                 @@@@                 @@@");
-	rpl_motd(sock, "																		   @@@@                                    @@@@");
-
-	rpl_endofmotd(sock);
+	if (!motd_.loaded())
+	{
+		err_nomotd(sock, target);
+		return;
+	}
+	const std::vector<std::string>&	segments = motd_.segments();
+	ScratchVector<struct iovec>		parts(scratch_);
+	parts.reserve(segments.size() * 2);
+	for (size_t i = 0; i < segments.size(); ++i)
+	{
+		struct iovec part = { const_cast<char*>(segments[i].data()), segments[i].size() };
+		parts.push_back(part);
+		if (i + 1 == segments.size())
+			break;
+		struct iovec nick = { const_cast<char*>(target.data()), target.size() };
+		parts.push_back(nick);
+	}
+	std::cout << time_stamp() << ":" << domain_ << " MOTD " << motd_.lines() << " lines " E_SPEECH PURPLE ITALIC " to "
+			  << target << CLR << std::endl;
+	queue_block(sock, parts.data(), parts.size(), motd_.lines() + 2);
+}
+
+/**
+ * @description	Renders MOTD of the file, or forgets it if the file can't be read
+ * @param		path: MOTD file
+ */
+void Irisha::load_motd(const std::string& path)
+{
+	if (!motd_.load(path, domain_))
+		sys_msg(E_CROSS, "MOTD file", path, "can't be read");
 }
 
 eResult Irisha::MOTD(const int sock)
@@ -1636,7 +2102,7 @@ eResult Irisha::MOTD(const int sock)
 		return R_FAILURE;
 
 	if (cmd_.arguments_.empty() || cmd_.arguments_[0] == domain_)
-		send_motd(sock);
+		send_motd(sock, user->nick());
 	else
 	{
 		Server*	server = find_server(cmd_.arguments_[0]);
@@ -1673,46 +2139,54 @@ eResult Irisha::MOTD_REPLIES(const int sock)
 
 void Irisha::count_operators(int& operators) const
 {
-	operators = 0;
-	User* user;
-	for (con_const_it it = connections_.begin(); it != connections_.end(); ++it)
-	{
-		if (it->second->type() == T_CLIENT)
-		{
-			user = static_cast<User*>(it->second);
-			if (user->is_operator())
-				++operators;
-		}
-	}
+	operators = static_cast<int>(counters_.operators);
 }
 
 void Irisha::count_global(int& users, int& servers) const
 {
-	users = 0;
-	servers = 0;
-	for (con_const_it it = connections_.begin(); it != connections_.end(); ++it)
-	{
-		if (it->second->type() == T_CLIENT)
-			++users;
-		else if (it->second->type() == T_SERVER)
-			++servers;
-	}
+	users = static_cast<int>(counters_.local_clients + counters_.remote_clients);
+	servers = static_cast<int>(counters_.local_servers + counters_.remote_servers);
 }
 
 void Irisha::count_local(int& users, int& servers) const
 {
-	users = 0;
-	servers = 0;
+	users = static_cast<int>(counters_.local_clients);
+	servers = static_cast<int>(counters_.local_servers);
+}
+
+/**
+ * @description	Debug check: recounts connections with a full scan and
+ * 				compares the result with the maintained counters
+ * @return		true if they match (mismatches are printed to stderr)
+ */
+bool Irisha::check_counters() const
+{
+	ServerCounters	scan;
+	User*			user;
+
 	for (con_const_it it = connections_.begin(); it != connections_.end(); ++it)
 	{
-		if (it->second->socket() != U_EXTERNAL_CONNECTION)
+		bool local = (it->second->socket() != U_EXTERNAL_CONNECTION);
+		if (it->second->type() == T_CLIENT)
 		{
-			if (it->second->type() == T_CLIENT)
-				++users;
-			else if (it->second->type() == T_SERVER)
-				++servers;
+			++(local ? scan.local_clients : scan.remote_clients);
+			user = static_cast<User*>(it->second);
+			if (user->is_operator())
+				++scan.operators;
 		}
+		else if (it->second->type() == T_SERVER)
+			++(local ? scan.local_servers : scan.remote_servers);
 	}
+	bool consistent = (scan.local_clients == counters_.local_clients && scan.remote_clients == counters_.remote_clients
+					   && scan.local_servers == counters_.local_servers && scan.remote_servers == counters_.remote_servers
+					   && scan.operators == counters_.operators);
+	if (!consistent)
+		std::cerr << RED "Counters mismatch on " << domain_ << ": clients " << counters_.local_clients << "/" << scan.local_clients
+				  << " local, " << counters_.remote_clients << "/" << scan.remote_clients << " remote; servers "
+				  << counters_.local_servers << "/" << scan.local_servers << " local, " << counters_.remote_servers << "/"
+				  << scan.remote_servers << " remote; operators " << counters_.operators << "/" << scan.operators
+				  << " (counted/scanned)" CLR << std::endl;
+	return consistent;
 }
 
 void Irisha::send_lusers_replies(const int sock) const
@@ -1828,9 +2302,6 @@ eResult Irisha::SQUIT(const int sock)
  * INFO
  * SERVLIST
  * SQUERY
- * WHO
- * WHOIS
- * WHOWAS
  * KILL
  * ERROR
  */
\ No newline at end of file
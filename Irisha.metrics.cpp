@@ -0,0 +1,326 @@
+
+#include "Irisha.hpp"
+#include "utils.hpp"
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+
+#include <cerrno>
+#include <cstring>
+
+#define METRICS_REQUEST_MAX	4096	// Longer requests are dropped
+
+/**
+ * @description	Appends HELP and TYPE lines of a metric family
+ * @param		out: response body
+ * @param		name: metric name
+ * @param		type: counter, gauge or summary
+ * @param		help: description
+ */
+static void	metric_family(std::string& out, const std::string& name, const std::string& type, const std::string& help)
+{
+	out += "# HELP " + name + " " + help + "\n# TYPE " + name + " " + type + "\n";
+}
+
+/**
+ * @description	Appends one sample
+ * @param		out: response body
+ * @param		name: metric name
+ * @param		labels: label list without braces (may be empty)
+ * @param		value: formatted value
+ */
+static void	metric_sample(std::string& out, const std::string& name, const std::string& labels, const std::string& value)
+{
+	out += name;
+	if (!labels.empty())
+		out += "{" + labels + "}";
+	out += " " + value + "\n";
+}
+
+/**
+ * @description	Formats microseconds as seconds with all six fraction digits,
+ * 				so large counters still move by every microsecond
+ * @param		usec
+ * @return		fixed-point seconds
+ */
+static std::string	usec_to_seconds(double usec)
+{
+	unsigned long	total = (usec > 0) ? static_cast<unsigned long>(usec + 0.5) : 0;
+	char			text[DIGITS_MAX + 7];
+	size_t			size = write_ulong(text, total / 1000000);
+	unsigned long	fraction = total % 1000000;
+
+	text[size++] = '.';
+	for (unsigned long digit = 100000; digit != 0; digit /= 10)
+		text[size++] = static_cast<char>('0' + fraction / digit % 10);
+	return std::string(text, size);
+}
+
+/**
+ * @description	Opens HTTP listener for metrics on 127.0.0.1:metrics_port_
+ */
+void Irisha::open_metrics_listener()
+{
+	sockaddr_in	address;
+	int			option = 1;
+
+	metrics_listener_ = socket(PF_INET, SOCK_STREAM, 0);
+	if (metrics_listener_ == -1)
+		throw std::runtime_error("Metrics socket creation failed!");
+	setsockopt(metrics_listener_, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(static_cast<uint16_t>(metrics_port_));
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);	// Never exposed outside the host
+	if (bind(metrics_listener_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1)
+		throw std::runtime_error("Metrics binding failed!");
+	listen(metrics_listener_, 8);
+	fcntl(metrics_listener_, F_SETFL, O_NONBLOCK);
+	FD_SET(metrics_listener_, &all_fds_);
+	if (metrics_listener_ > max_fd_)
+		max_fd_ = metrics_listener_;
+	std::cout << E_GEAR ITALIC PURPLE " Metrics are served on http://127.0.0.1:" << metrics_port_ << "/metrics" CLR << std::endl;
+}
+
+/**
+ * @description	Accepts scraper connection
+ */
+void Irisha::accept_metrics()
+{
+	int sock = accept(metrics_listener_, nullptr, nullptr);
+	if (sock == -1)
+		return;
+	fcntl(sock, F_SETFL, O_NONBLOCK);
+	FD_SET(sock, &all_fds_);
+	if (sock > max_fd_)
+		max_fd_ = sock;
+	metrics_clients_[sock];
+}
+
+/**
+ * @description	Reads scraper request and answers it when the headers are complete.
+ * 				What doesn't fit into the socket buffer is written when the
+ * 				socket becomes writable, then the socket is closed
+ * @param		sock: scraper socket
+ */
+void Irisha::serve_metrics(int sock)
+{
+	MetricsClient&	client = metrics_clients_[sock];
+	std::string&	request = client.request;
+	char			buff[1024];
+	ssize_t			n = recv(sock, buff, sizeof(buff), 0);
+
+	if (n <= 0)
+	{
+		close_metrics(sock);
+		return;
+	}
+	request.append(buff, static_cast<size_t>(n));
+	if (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos)
+	{
+		if (request.size() > METRICS_REQUEST_MAX)
+			close_metrics(sock);
+		return;
+	}
+
+	std::string& response = client.response;
+	if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0)
+	{
+		std::string body = render_metrics();
+		response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+				   "Content-Length: " + ulong_to_str(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+	}
+	else
+		response = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+	FD_CLR(sock, &all_fds_);	// Nothing is read anymore, select() waits to write the rest
+	write_metrics(sock);
+}
+
+/**
+ * @description	Writes what is left of scraper response, closes the socket
+ * 				when it's all written or the write fails
+ * @param		sock: scraper socket
+ */
+void Irisha::write_metrics(int sock)
+{
+	MetricsClient&	client = metrics_clients_[sock];
+	int				flags = MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+	flags |= MSG_NOSIGNAL;
+#endif
+	ssize_t n = send(sock, client.response.data() + client.sent, client.response.size() - client.sent, flags);
+	if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return;
+	if (n <= 0)
+	{
+		++counters_.metrics_failed;
+		close_metrics(sock);
+		return;
+	}
+	client.sent += static_cast<size_t>(n);
+	if (client.sent == client.response.size())
+		close_metrics(sock);
+}
+
+void Irisha::close_metrics(int sock)
+{
+	metrics_clients_.erase(sock);
+	FD_CLR(sock, &all_fds_);
+	FD_CLR(sock, &read_fds_);
+	close(sock);
+}
+
+/**
+ * @description	Renders counters in Prometheus text exposition format.
+ * 				Everything here is maintained incrementally, so a scrape costs
+ * 				O(commands), not O(connections)
+ * @return		response body
+ */
+std::string Irisha::render_metrics() const
+{
+	std::string	out;
+
+	metric_family(out, "irisha_connections", "gauge", "Registered connections by type and locality.");
+	metric_sample(out, "irisha_connections", "type=\"client\",scope=\"local\"", ulong_to_str(counters_.local_clients));
+	metric_sample(out, "irisha_connections", "type=\"client\",scope=\"remote\"", ulong_to_str(counters_.remote_clients));
+	metric_sample(out, "irisha_connections", "type=\"server\",scope=\"local\"", ulong_to_str(counters_.local_servers));
+	metric_sample(out, "irisha_connections", "type=\"server\",scope=\"remote\"", ulong_to_str(counters_.remote_servers));
+	metric_family(out, "irisha_operators", "gauge", "IRC operators.");
+	metric_sample(out, "irisha_operators", "", ulong_to_str(counters_.operators));
+	metric_family(out, "irisha_unregistered_connections", "gauge", "Connections waiting for registration.");
+	metric_sample(out, "irisha_unregistered_connections", "", ulong_to_str(reg_expect_.size()));
+	metric_family(out, "irisha_sockets", "gauge", "Open IRC sockets.");
+	metric_sample(out, "irisha_sockets", "", ulong_to_str(links_.size()));
+	metric_family(out, "irisha_channels", "gauge", "Known channels.");
+	metric_sample(out, "irisha_channels", "", ulong_to_str(channels_.size()));
+	metric_family(out, "irisha_accepted_connections_total", "counter", "Accepted sockets.");
+	metric_sample(out, "irisha_accepted_connections_total", "", ulong_to_str(counters_.accepted));
+	metric_family(out, "irisha_rejected_connections_total", "counter", "Sockets closed at accept() by Z-lines.");
+	metric_sample(out, "irisha_rejected_connections_total", "", ulong_to_str(counters_.rejected));
+	metric_family(out, "irisha_metrics_write_errors_total", "counter", "Metrics responses cut short by a failed write.");
+	metric_sample(out, "irisha_metrics_write_errors_total", "", ulong_to_str(counters_.metrics_failed));
+	metric_family(out, "irisha_throttled_connections_total", "counter", "Sockets closed by per-address limits.");
+	metric_sample(out, "irisha_throttled_connections_total", "", ulong_to_str(counters_.throttled));
+	metric_family(out, "irisha_evicted_connections_total", "counter", "Oldest unregistered connections dropped for new ones.");
+	metric_sample(out, "irisha_evicted_connections_total", "", ulong_to_str(counters_.evicted));
+	metric_family(out, "irisha_flood_deferrals_total", "counter", "Times flood control held back lines of a client.");
+	metric_sample(out, "irisha_flood_deferrals_total", "", ulong_to_str(counters_.deferred));
+	metric_family(out, "irisha_sendq_exceeded_total", "counter", "Connections closed for going over their sendq cap.");
+	metric_sample(out, "irisha_sendq_exceeded_total", "", ulong_to_str(counters_.sendq_exceeded));
+	metric_family(out, "irisha_recvq_exceeded_total", "counter", "Connections closed for going over their recvq cap.");
+	metric_sample(out, "irisha_recvq_exceeded_total", "", ulong_to_str(counters_.recvq_exceeded));
+
+	metric_family(out, "irisha_messages_received_total", "counter", "Lines received.");
+	metric_sample(out, "irisha_messages_received_total", "", ulong_to_str(counters_.messages_in));
+	metric_family(out, "irisha_messages_sent_total", "counter", "Lines queued for sending.");
+	metric_sample(out, "irisha_messages_sent_total", "", ulong_to_str(counters_.messages_out));
+	metric_family(out, "irisha_received_bytes_total", "counter", "Bytes received.");
+	metric_sample(out, "irisha_received_bytes_total", "", ulong_to_str(counters_.bytes_in));
+	metric_family(out, "irisha_sent_bytes_total", "counter", "Bytes queued for sending.");
+	metric_sample(out, "irisha_sent_bytes_total", "", ulong_to_str(counters_.bytes_out));
+	metric_family(out, "irisha_sendq_bytes", "gauge", "Bytes waiting in output queues.");
+	metric_sample(out, "irisha_sendq_bytes", "", ulong_to_str(counters_.sendq_bytes));
+
+	const std::vector<SlabPool*>& pools = SlabPool::pools();
+	metric_family(out, "irisha_pool_objects", "gauge", "Objects in use by slab pool.");
+	for (std::vector<SlabPool*>::const_iterator it = pools.begin(); it != pools.end(); ++it)
+		metric_sample(out, "irisha_pool_objects", "pool=\"" + (*it)->name() + "\"", ulong_to_str((*it)->used()));
+	metric_family(out, "irisha_pool_capacity", "gauge", "Objects slab pool can hold without growing.");
+	for (std::vector<SlabPool*>::const_iterator it = pools.begin(); it != pools.end(); ++it)
+		metric_sample(out, "irisha_pool_capacity", "pool=\"" + (*it)->name() + "\"", ulong_to_str((*it)->capacity()));
+
+	metric_family(out, "irisha_command_calls_total", "counter", "Handled commands.");
+	for (std::map<std::string, CommandStats>::const_iterator it = command_stats_.begin(); it != command_stats_.end(); ++it)
+		metric_sample(out, "irisha_command_calls_total", "command=\"" + it->first + "\"", ulong_to_str(it->second.count));
+	metric_family(out, "irisha_command_duration_seconds", "summary", "Command handler time.");
+	for (std::map<std::string, CommandStats>::const_iterator it = command_stats_.begin(); it != command_stats_.end(); ++it)
+	{
+		const Histogram&	latency = it->second.latency;
+		std::string			label = "command=\"" + it->first + "\"";
+		metric_sample(out, "irisha_command_duration_seconds", label + ",quantile=\"0.5\"", usec_to_seconds(latency.percentile(50)));
+		metric_sample(out, "irisha_command_duration_seconds", label + ",quantile=\"0.99\"", usec_to_seconds(latency.percentile(99)));
+		metric_sample(out, "irisha_command_duration_seconds", label + ",quantile=\"1\"", usec_to_seconds(latency.max()));
+		metric_sample(out, "irisha_command_duration_seconds_sum", label, usec_to_seconds(latency.sum()));
+		metric_sample(out, "irisha_command_duration_seconds_count", label, ulong_to_str(latency.count()));
+	}
+	metric_family(out, "irisha_command_sent_bytes_total", "counter", "Bytes queued by command handlers.");
+	for (std::map<std::string, CommandStats>::const_iterator it = command_stats_.begin(); it != command_stats_.end(); ++it)
+		metric_sample(out, "irisha_command_sent_bytes_total", "command=\"" + it->first + "\"", ulong_to_str(it->second.bytes_out));
+
+	metric_family(out, "irisha_loop_iterations_total", "counter", "Event loop iterations.");
+	metric_sample(out, "irisha_loop_iterations_total", "", ulong_to_str(loop_stats_.iterations));
+	metric_family(out, "irisha_loop_seconds_total", "counter", "Event loop time by stage.");
+	metric_sample(out, "irisha_loop_seconds_total", "stage=\"select\"", usec_to_seconds(loop_stats_.select_usec));
+	metric_sample(out, "irisha_loop_seconds_total", "stage=\"timers\"", usec_to_seconds(loop_stats_.timer_usec));
+	metric_sample(out, "irisha_loop_seconds_total", "stage=\"io\"", usec_to_seconds(loop_stats_.io_usec));
+	metric_sample(out, "irisha_loop_seconds_total", "stage=\"handlers\"", usec_to_seconds(loop_stats_.handler_usec));
+	metric_sample(out, "irisha_loop_seconds_total", "stage=\"flush\"", usec_to_seconds(loop_stats_.flush_usec));
+	metric_family(out, "irisha_handler_budget_overruns_total", "counter", "Handler calls longer than handler-budget.");
+	metric_sample(out, "irisha_handler_budget_overruns_total", "", ulong_to_str(loop_stats_.budget_overruns));
+
+	metric_family(out, "irisha_start_time_seconds", "gauge", "Server launch time since epoch.");
+	metric_sample(out, "irisha_start_time_seconds", "", ulong_to_str(static_cast<unsigned long>(launch_time_)));
+	return out;
+}
+
+/**
+ * @description	Writes a snapshot of counters to the shared memory segment
+ * 				(at most every SHM_PUBLISH_USEC, readers compute rates themselves)
+ */
+void Irisha::publish_shm_stats()
+{
+	unsigned long now = get_usec();
+	if (now - shm_published_ < SHM_PUBLISH_USEC)
+	{
+		shm_pending_ = true;	// run_once() shortens the next wait to publish it soon
+		return;
+	}
+	shm_published_ = now;
+	shm_pending_ = false;
+
+	ShmSegment* segment = shm_stats_.begin_write();
+	segment->updated_usec		= now;
+	segment->start_time			= launch_time_;
+	segment->local_clients		= counters_.local_clients;
+	segment->remote_clients		= counters_.remote_clients;
+	segment->local_servers		= counters_.local_servers;
+	segment->remote_servers		= counters_.remote_servers;
+	segment->unregistered		= reg_expect_.size();
+	segment->channels			= channels_.size();
+	segment->messages_in		= counters_.messages_in;
+	segment->messages_out		= counters_.messages_out;
+	segment->bytes_in			= counters_.bytes_in;
+	segment->bytes_out			= counters_.bytes_out;
+	segment->sendq_bytes		= counters_.sendq_bytes;
+	segment->loop_iterations	= loop_stats_.iterations;
+	segment->loop_p50_usec		= loop_stats_.iteration.percentile(50);
+	segment->loop_p99_usec		= loop_stats_.iteration.percentile(99);
+	segment->loop_max_usec		= loop_stats_.iteration.max();
+	segment->loop_last_usec		= loop_stats_.last_usec;
+	segment->budget_overruns	= loop_stats_.budget_overruns;
+
+	// Keep the deepest send queues: replace the smallest published entry when a deeper one shows up
+	uint32_t	count = 0;
+	uint32_t	smallest = 0;
+	for (std::map<int, Link>::const_iterator it = links_.begin(); it != links_.end(); ++it)
+	{
+		uint64_t sendq = it->second.sendq();
+		if (count == SHM_STATS_LINKS && sendq <= segment->links[smallest].sendq)
+			continue;
+		uint32_t slot = (count < SHM_STATS_LINKS) ? count++ : smallest;
+		segment->links[slot].socket = it->first;
+		segment->links[slot].server = it->second.server() ? 1 : 0;
+		segment->links[slot].sendq = sendq;
+		if (count == SHM_STATS_LINKS)
+		{
+			smallest = 0;
+			for (uint32_t i = 1; i < count; ++i)
+				if (segment->links[i].sendq < segment->links[smallest].sendq)
+					smallest = i;
+		}
+	}
+	segment->link_total = static_cast<uint32_t>(links_.size());
+	segment->link_count = count;
+	shm_stats_.end_write();
+}
@@ -1,5 +1,53 @@
 
 #include "Irisha.hpp"
+#include "Channel.hpp"
+
+#include <algorithm>
+
+/**
+ * @description	Writes ":<domain> <code> <target> " and the parts into one line
+ * 				of the scratch arena and queues it. Each reply below is a
+ * 				list of parts fixed at compile time, so nothing is concatenated
+ * 				and numbers are written in place
+ * @param		sock
+ * @param		code: reply or error code
+ * @param		target: receiver name
+ * @param		parts: strings, characters and numbers
+ */
+template <typename... Parts>
+void			Irisha::send_numeric		(int sock, int code, StringRef target, const Parts&... parts) const
+{
+	ScratchString	line(scratch_);
+	char			digits[3];
+
+	line.reserve(IRC_LINE_MAX);
+	write_code(digits, code);
+	append_parts(line, ':', domain_, ' ', StringRef(digits, 3), ' ', target, ' ', parts...);
+	std::cout << time_stamp() << line << " " E_SPEECH PURPLE ITALIC " to " << connection_name(sock) << CLR << std::endl;
+	line.append("\r\n");
+	queue_msg(sock, line);
+}
+
+/**
+ * @description	Appends reply line to batch, the batch is queued by caller
+ * 				with one queue_msg() (multi-line replies: WHO, WHOIS, WHOWAS)
+ * @param		batch
+ * @param		code: reply or error code
+ * @param		target: receiver nick
+ * @param		parts: strings, characters and numbers
+ */
+template <typename... Parts>
+void			Irisha::batch_numeric		(std::string& batch, int code, StringRef target, const Parts&... parts) const
+{
+	size_t	begin = batch.size();
+	char	digits[3];
+
+	write_code(digits, code);
+	append_parts(batch, ':', domain_, ' ', StringRef(digits, 3), ' ', target, ' ', parts...);
+	std::cout << time_stamp() << StringRef(batch.data() + begin, batch.size() - begin)
+			  << " " E_SPEECH PURPLE ITALIC " to " << target << CLR << std::endl;
+	batch.append("\r\n");
+}
 
 /**
  * @description	Sends reply message
@@ -9,9 +57,7 @@
  */
 void			Irisha::send_rpl_msg		(int sock, eReply rpl, const std::string& msg) const
 {
-	std::string	target = connection_name(sock);
-	std::string message = rpl_code_to_str(rpl) + " " + target + " " + msg;
-	send_msg(sock, domain_, message);
+	send_numeric(sock, rpl, connection_name(sock), msg);
 }
 
 /**
@@ -24,8 +70,7 @@ void			Irisha::send_rpl_msg		(int sock, eReply rpl, const std::string& msg) cons
 void			Irisha::send_rpl_msg		(int sock, eReply rpl, const std::string& msg
 							  					, const std::string& target) const
 {
-	std::string message = rpl_code_to_str(rpl) + " " + target + " " + msg;
-	send_msg(sock, domain_, message);
+	send_numeric(sock, rpl, target, msg);
 }
 
 /**
@@ -36,9 +81,7 @@ void			Irisha::send_rpl_msg		(int sock, eReply rpl, const std::string& msg
  */
 void			Irisha::send_rpl_msg		(int sock, eError rpl, const std::string& msg) const
 {
-	std::string	target = connection_name(sock);
-	std::string message = rpl_code_to_str(rpl) + " " + target + " " + msg;
-	send_msg(sock, domain_, message);
+	send_numeric(sock, rpl, connection_name(sock), msg);
 }
 
 /**
@@ -51,293 +94,310 @@ void			Irisha::send_rpl_msg		(int sock, eError rpl, const std::string& msg) cons
 void			Irisha::send_rpl_msg		(int sock, eError rpl, const std::string& msg
 							  					, const std::string& target) const
 {
-	std::string message = rpl_code_to_str(rpl) + " " + target + " " + msg;
-	send_msg(sock, domain_, message);
+	send_numeric(sock, rpl, target, msg);
+}
+
+/**
+ * @description	Appends reply line to batch
+ * @param		batch
+ * @param		rpl: reply code
+ * @param		target: receiver nick
+ * @param		msg: reply message
+ */
+void			Irisha::batch_rpl			(std::string& batch, eReply rpl, const std::string& target, const std::string& msg) const
+{
+	batch_numeric(batch, rpl, target, msg);
+}
+
+/**
+ * @description	Appends error reply line to batch
+ * @param		batch
+ * @param		rpl: error reply code
+ * @param		target: receiver nick
+ * @param		msg: reply message
+ */
+void			Irisha::batch_rpl			(std::string& batch, eError rpl, const std::string& target, const std::string& msg) const
+{
+	batch_numeric(batch, rpl, target, msg);
 }
 
 /// Error replies
 void Irisha::err_nosuchserver(const int sock, const std::string& server) const
 {
-	send_rpl_msg(sock, ERR_NOSUCHSERVER, server + " :No such server");
+	send_numeric(sock, ERR_NOSUCHSERVER, connection_name(sock), server, " :No such server");
 }
 
 void Irisha::err_nonicknamegiven(const int sock) const
 {
-	send_rpl_msg(sock, ERR_NONICKNAMEGIVEN, ":No nickname given");
+	send_numeric(sock, ERR_NONICKNAMEGIVEN, connection_name(sock), ":No nickname given");
 }
 
 void Irisha::err_nosuchnick(const int sock, const std::string& nick) const
 {
-	send_rpl_msg(sock, ERR_NOSUCHNICK, nick + " :No such nick/channel");
+	send_numeric(sock, ERR_NOSUCHNICK, connection_name(sock), nick, " :No such nick/channel");
 }
 
 void Irisha::err_erroneusnickname(const int sock, const std::string& nick) const
 {
-	send_rpl_msg(sock, ERR_ERRONEUSNICKNAME, nick + " :Erroneus nickname");
+	send_numeric(sock, ERR_ERRONEUSNICKNAME, connection_name(sock), nick, " :Erroneus nickname");
 }
 
 void Irisha::err_nicknameinuse(const int sock, const std::string& nick) const
 {
-	send_rpl_msg(sock, ERR_NICKNAMEINUSE, nick + " :Nickname is already in use");
+	send_numeric(sock, ERR_NICKNAMEINUSE, connection_name(sock), nick, " :Nickname is already in use");
 }
 
 void Irisha::err_nickcollision(const int sock, const std::string& nick) const
 {
-	send_rpl_msg(sock, ERR_NICKCOLLISION, nick + " :Nickname collision KILL");
+	send_numeric(sock, ERR_NICKCOLLISION, connection_name(sock), nick, " :Nickname collision KILL");
 }
 
 void Irisha::err_nosuchchannel(const int sock, const std::string& channel) const
 {
-	send_rpl_msg(sock, ERR_NOSUCHCHANNEL, channel + " :No such channel");
+	send_numeric(sock, ERR_NOSUCHCHANNEL, connection_name(sock), channel, " :No such channel");
 }
 
 void Irisha::err_needmoreparams(const int sock, const std::string& command) const
 {
-	send_rpl_msg(sock, ERR_NEEDMOREPARAMS, command + " :Not enough parameters");
+	send_numeric(sock, ERR_NEEDMOREPARAMS, connection_name(sock), command, " :Not enough parameters");
 }
 
 void Irisha::err_alreadyregistered(const int sock) const
 {
-	send_rpl_msg(sock, ERR_ALREADYREGISTRED, ":You may not reregister");
+	send_numeric(sock, ERR_ALREADYREGISTRED, connection_name(sock), ":You may not reregister");
 }
 
 void Irisha::err_noorigin(const int sock) const
 {
-	send_rpl_msg(sock, ERR_NOORIGIN, ":No origin specified");
+	send_numeric(sock, ERR_NOORIGIN, connection_name(sock), ":No origin specified");
 }
 
 void Irisha::err_norecipient(const int sock, const std::string& command) const
 {
-	send_rpl_msg(sock, ERR_NORECIPIENT, ":No recipient given (" + command + ")");
+	send_numeric(sock, ERR_NORECIPIENT, connection_name(sock), ":No recipient given (", command, ")");
 }
 
 void Irisha::err_notexttosend(const int sock) const
 {
-	send_rpl_msg(sock, ERR_NOTEXTTOSEND, ":No text to send");
+	send_numeric(sock, ERR_NOTEXTTOSEND, connection_name(sock), ":No text to send");
 }
 
 void Irisha::err_notoplevel(const int sock, const std::string& mask) const
 {
 	(void)mask;
-	send_rpl_msg(sock, ERR_NOTOPLEVEL, ":No toplevel domain specified");
+	send_numeric(sock, ERR_NOTOPLEVEL, connection_name(sock), ":No toplevel domain specified");
 }
 
 void Irisha::err_wildtoplevel(const int sock, const std::string& mask) const
 {
-	send_rpl_msg(sock, ERR_WILDTOPLEVEL, mask + " :Wildcard in toplevel domain");
+	send_numeric(sock, ERR_WILDTOPLEVEL, connection_name(sock), mask, " :Wildcard in toplevel domain");
 }
 
 void Irisha::err_cannotsendtochan(const int sock, const std::string& channel) const
 {
-	send_rpl_msg(sock, ERR_CANNOTSENDTOCHAN, channel + " :Cannot send to channel");
+	send_numeric(sock, ERR_CANNOTSENDTOCHAN, connection_name(sock), channel, " :Cannot send to channel");
 }
 
 void Irisha::err_toomanytargets(const int sock, const std::string& target) const
 {
-	send_rpl_msg(sock, ERR_TOOMANYTARGETS, target + " :Duplicate recipients. No message delivered");
+	send_numeric(sock, ERR_TOOMANYTARGETS, connection_name(sock), target, " :Duplicate recipients. No message delivered");
 }
 
 void Irisha::err_unknowncommand(const int sock, const std::string& command) const
 {
-	send_rpl_msg(sock, ERR_UNKNOWNCOMMAND, command + " :Unknown command");
+	send_numeric(sock, ERR_UNKNOWNCOMMAND, connection_name(sock), command, " :Unknown command");
 }
 
 void Irisha::err_chanoprivsneeded(const int sock, const std::string& channel) const
 {
-	send_rpl_msg(sock, ERR_CHANOPRIVSNEEDED, channel + " :You're not channel operator");
+	send_numeric(sock, ERR_CHANOPRIVSNEEDED, connection_name(sock), channel, " :You're not channel operator");
 }
 
 void Irisha::err_notochannel(const int sock, const std::string& channel) const
 {
-	send_rpl_msg(sock, ERR_NOTONCHANNEL, channel + " :You're not on that channel");
+	send_numeric(sock, ERR_NOTONCHANNEL, connection_name(sock), channel, " :You're not on that channel");
 }
 
 void Irisha::err_keyset(const int sock, const std::string& channel) const
 {
-	send_rpl_msg(sock, ERR_KEYSET, channel + " :Channel key already set");
+	send_numeric(sock, ERR_KEYSET, connection_name(sock), channel, " :Channel key already set");
 }
 
 void Irisha::err_unknownmode(const int sock, const std::string& mode_char) const
 {
-	send_rpl_msg(sock, ERR_UNKNOWNMODE, mode_char + " :is unknown mode char to me");
+	send_numeric(sock, ERR_UNKNOWNMODE, connection_name(sock), mode_char, " :is unknown mode char to me");
 }
 
 void Irisha::err_usersdontmatch(const int sock) const
 {
-	send_rpl_msg(sock, ERR_USERSDONTMATCH, ":Cannot change mode for other users");
+	send_numeric(sock, ERR_USERSDONTMATCH, connection_name(sock), ":Cannot change mode for other users");
 }
 
 void Irisha::err_umodeunknownflag(const int sock) const
 {
-	send_rpl_msg(sock, ERR_UMODEUNKNOWNFLAG, ":Unknown MODE flag");
+	send_numeric(sock, ERR_UMODEUNKNOWNFLAG, connection_name(sock), ":Unknown MODE flag");
 }
 
 void Irisha::err_bannedfromchan(const int sock, const std::string& channel) const
 {
-	send_rpl_msg(sock, ERR_BANNEDFROMCHAN, channel + " :Cannot join channel (+b)");
+	send_numeric(sock, ERR_BANNEDFROMCHAN, connection_name(sock), channel, " :Cannot join channel (+b)");
 }
 
 void Irisha::err_initeonlychan(const int sock, const std::string& channel) const
 {
-	send_rpl_msg(sock, ERR_INVITEONLYCHAN, channel + " :Cannot join channel (+i)");
+	send_numeric(sock, ERR_INVITEONLYCHAN, connection_name(sock), channel, " :Cannot join channel (+i)");
 }
 
 void Irisha::err_channelisfull(const int sock, const std::string& channel) const
 {
-	send_rpl_msg(sock, ERR_CHANNELISFULL, channel + " :Cannot join channel (+l)");
+	send_numeric(sock, ERR_CHANNELISFULL, connection_name(sock), channel, " :Cannot join channel (+l)");
 }
 
 void Irisha::err_toomanychannels(const int sock, const std::string& channel) const
 {
-	send_rpl_msg(sock, ERR_TOOMANYCHANNELS, channel + " :You have joined too many channels");
+	send_numeric(sock, ERR_TOOMANYCHANNELS, connection_name(sock), channel, " :You have joined too many channels");
 }
 
 void Irisha::err_noprivileges(const int sock) const
 {
-	send_rpl_msg(sock, ERR_NOPRIVILEGES, ":Permission Denied- You're not an IRC operator");
+	send_numeric(sock, ERR_NOPRIVILEGES, connection_name(sock), ":Permission Denied- You're not an IRC operator");
 }
 
 void Irisha::err_useronchannel(const int sock, const std::string& user, const std::string& channel) const
 {
-	send_rpl_msg(sock, ERR_USERONCHANNEL, user + channel +" :is already on channel");
+	send_numeric(sock, ERR_USERONCHANNEL, connection_name(sock), user, channel, " :is already on channel");
 }
 
 void Irisha::err_usersdisabled(const int sock) const
 {
-	send_rpl_msg(sock, ERR_USERSDISABLED, ":USERS has been disabled");
+	send_numeric(sock, ERR_USERSDISABLED, connection_name(sock), ":USERS has been disabled");
 }
 
 void Irisha::err_notregistered(const int sock) const
 {
-	send_rpl_msg(sock, ERR_NOTREGISTERED, ":You have not registered");
+	send_numeric(sock, ERR_NOTREGISTERED, connection_name(sock), ":You have not registered");
 }
 
 void Irisha::err_yourebannedcreep(const int sock) const
 {
-	send_rpl_msg(sock, ERR_YOUREBANNEDCREEP, ":You are banned from this server");
+	send_numeric(sock, ERR_YOUREBANNEDCREEP, connection_name(sock), ":You are banned from this server");
 }
 
 void Irisha::err_nooperhost(const int sock) const
 {
-	send_rpl_msg(sock, ERR_NOOPERHOST, ":No O-lines for your host");
+	send_numeric(sock, ERR_NOOPERHOST, connection_name(sock), ":No O-lines for your host");
 }
 
 void Irisha::err_passwdmismatch(const int sock) const
 {
-	send_rpl_msg(sock, ERR_PASSWDMISMATCH, ":Password incorrect");
+	send_numeric(sock, ERR_PASSWDMISMATCH, connection_name(sock), ":Password incorrect");
+}
+
+void Irisha::err_nomotd(const int sock, const std::string& target) const
+{
+	send_numeric(sock, ERR_NOMOTD, target, ":MOTD File is missing");
 }
 
 void Irisha::err_cantkillserver(const int sock) const
 {
-	send_rpl_msg(sock, ERR_CANTKILLSERVER, ":You cant kill a server!");
+	send_numeric(sock, ERR_CANTKILLSERVER, connection_name(sock), ":You cant kill a server!");
 }
 
 /// Common replies
 void Irisha::rpl_welcome(const int sock) const
 {
-	send_rpl_msg(sock, RPL_WELCOME, welcome_);
+	send_numeric(sock, RPL_WELCOME, connection_name(sock), welcome_);
 }
 
 void Irisha::rpl_youreoper(const int sock) const
 {
-	send_rpl_msg(sock, RPL_YOUREOPER, ":You are now an IRC operator");
+	send_numeric(sock, RPL_YOUREOPER, connection_name(sock), ":You are now an IRC operator");
 }
 
 void Irisha::rpl_time(const int sock, const std::string& server, const std::string& local_time) const
 {
-	send_rpl_msg(sock, RPL_TIME, server + " " + local_time);
+	send_numeric(sock, RPL_TIME, connection_name(sock), server, " ", local_time);
 }
 
 void Irisha::rpl_away(const int sock, const std::string& nick, const std::string& away_msg) const
 {
-	send_rpl_msg(sock, RPL_AWAY, nick + " " + away_msg);
+	send_numeric(sock, RPL_AWAY, connection_name(sock), nick, " ", away_msg);
 }
 
 void Irisha::rpl_channelmodeis(const int sock, const std::string& mode, const std::string& mode_params) const
 {
-	send_rpl_msg(sock, RPL_CHANNELMODEIS, mode + " " + mode_params);
+	send_numeric(sock, RPL_CHANNELMODEIS, connection_name(sock), mode, " ", mode_params);
 }
 
 void Irisha::rpl_banlist(const int sock, const std::string& channel, const std::string& ban_id) const
 {
-	send_rpl_msg(sock, RPL_BANLIST, channel + " " + ban_id);
+	send_numeric(sock, RPL_BANLIST, connection_name(sock), channel, " ", ban_id);
 }
 
 void Irisha::rpl_endofbanlist(const int sock, const std::string& channel) const
 {
-	send_rpl_msg(sock, RPL_ENDOFBANLIST, channel + " :End of channel ban list");
+	send_numeric(sock, RPL_ENDOFBANLIST, connection_name(sock), channel, " :End of channel ban list");
 }
 
 void Irisha::rpl_info(const int sock, const std::string& info) const
 {
-	send_rpl_msg(sock, RPL_INFO, ":" + info);
+	send_numeric(sock, RPL_INFO, connection_name(sock), ":", info);
 }
 
 void Irisha::rpl_endofinfo(const int sock) const
 {
-	send_rpl_msg(sock, RPL_ENDOFINFO, ":End of /INFO list");
+	send_numeric(sock, RPL_ENDOFINFO, connection_name(sock), ":End of /INFO list");
 }
 
-void Irisha::rpl_motdstart(const int sock, const std::string& server) const
+void Irisha::rpl_rehashing(const int sock, const std::string& target) const
 {
-	send_rpl_msg(sock, RPL_MOTDSTART, ":- " + server + " Message of the day - ");
-}
-
-void Irisha::rpl_motd(const int sock, const std::string& text) const
-{
-	send_rpl_msg(sock, RPL_MOTD, ":- " + text);
-}
-
-void Irisha::rpl_endofmotd(const int sock) const
-{
-	send_rpl_msg(sock, RPL_ENDOFMOTD, ":End of /MOTD command");
+	send_numeric(sock, RPL_REHASHIN, target, config_path_, " :Rehashing");
 }
 
 void Irisha::rpl_umodeis(const int sock, const std::string& mode_string) const
 {
-	send_rpl_msg(sock, RPL_UMODEIS, mode_string);
+	send_numeric(sock, RPL_UMODEIS, connection_name(sock), mode_string);
 }
 
 void Irisha::rpl_topic(const int sock, const std::string& channel, const std::string& topic) const
 {
-	send_rpl_msg(sock, RPL_TOPIC, channel + " :" + topic);
+	send_numeric(sock, RPL_TOPIC, connection_name(sock), channel, " :", topic);
 }
 
 void Irisha::rpl_notopic(const int sock, const std::string& channel) const
 {
-	send_rpl_msg(sock, RPL_NOTOPIC, channel + " :No topic is set");
+	send_numeric(sock, RPL_NOTOPIC, connection_name(sock), channel, " :No topic is set");
 }
 
 void Irisha::rpl_inviting(const int sock, const std::string& channel, const std::string& nick) const
 {
-	send_rpl_msg(sock, RPL_INVITING, nick + " " + channel);
+	send_numeric(sock, RPL_INVITING, connection_name(sock), nick, " ", channel);
 }
 
 void Irisha::rpl_version(const int sock, const std::string& target, const std::string& version, const std::string& debug_lvl
 						 	, const std::string& server, const std::string& comments) const
 {
-	send_msg(sock, domain_, rpl_code_to_str(RPL_VERSION) + " " + target + " " + version + "." +
-		debug_lvl + " " + server + " :" + comments);
+	send_numeric(sock, RPL_VERSION, target, version, '.', debug_lvl, ' ', server, " :", comments);
 }
 
 void Irisha::rpl_adminme(const int sock, const std::string& target, const std::string& server) const
 {
-	send_rpl_msg(sock, RPL_ADMINME, server + " :Administrative info", target);
+	send_numeric(sock, RPL_ADMINME, target, server, " :Administrative info");
 }
 
 void Irisha::rpl_adminloc1(const int sock, const std::string& target, const std::string& info) const
 {
-	send_rpl_msg(sock, RPL_ADMINLOC1, ":" + info, target);
+	send_numeric(sock, RPL_ADMINLOC1, target, ":", info);
 }
 
 void Irisha::rpl_adminloc2(const int sock, const std::string& target, const std::string& info) const
 {
-	send_rpl_msg(sock, RPL_ADMINLOC2, ":" + info, target);
+	send_numeric(sock, RPL_ADMINLOC2, target, ":", info);
 }
 
 void Irisha::rpl_adminmail(const int sock, const std::string& target, const std::string& info) const
 {
-	send_rpl_msg(sock, RPL_ADMINEMAIL, ":" + info, target);
+	send_numeric(sock, RPL_ADMINEMAIL, target, ":", info);
 }
 
 void Irisha::rpl_luserclient(const int sock) const
@@ -345,17 +405,16 @@ void Irisha::rpl_luserclient(const int sock) const
 	int users, servers;
 
 	count_global(users, servers);
-	send_rpl_msg(sock, RPL_LUSERCLIENT, ":There are " + int_to_str(users)
-						+ " users on " + int_to_str(servers) + " servers");
+	send_numeric(sock, RPL_LUSERCLIENT, connection_name(sock), ":There are ", users, " users on ", servers, " servers");
 }
 
 void Irisha::rpl_luserop(const int sock) const
 {
 	int operators;
 
-	count_operators(operators); //! TODO: check is_operator function
+	count_operators(operators);
 	if (operators != 0)
-		send_rpl_msg(sock, RPL_LUSEROP, int_to_str(operators) + " operator(s) online");
+		send_numeric(sock, RPL_LUSEROP, connection_name(sock), operators, " :operator(s) online");
 }
 
 void Irisha::rpl_luserchannels(const int sock) const
@@ -363,15 +422,15 @@ void Irisha::rpl_luserchannels(const int sock) const
 	int channels = static_cast<int>(channels_.size());
 
 	if (channels != 0)
-		send_rpl_msg(sock, RPL_LUSERCHANNELS, int_to_str(channels) + " :channels formed");
+		send_numeric(sock, RPL_LUSERCHANNELS, connection_name(sock), channels, " :channels formed");
 }
 
 void Irisha::rpl_luserunknown(const int sock) const
 {
-	int unknown_connections = 0; //! TODO: count unknown connections (in registration)
+	int unknown_connections = static_cast<int>(reg_expect_.size());
 
 	if (unknown_connections != 0)
-		send_rpl_msg(sock, RPL_LUSERUNKNOWN, int_to_str(unknown_connections) + " :unknown connection(s)");
+		send_numeric(sock, RPL_LUSERUNKNOWN, connection_name(sock), unknown_connections, " :unknown connection(s)");
 }
 
 void Irisha::rpl_luserme(const int sock) const
@@ -379,36 +438,91 @@ void Irisha::rpl_luserme(const int sock) const
 	int users, servers;
 
 	count_local(users, servers);
-	send_rpl_msg(sock, RPL_LUSERCLIENT, ":I have " + int_to_str(users)
-										+ " clients and " + int_to_str(servers) + " servers");
+	send_numeric(sock, RPL_LUSERME, connection_name(sock), ":I have ", users, " clients and ", servers, " servers");
 }
 
 void Irisha::rpl_endofstats(const int sock, const std::string& letter, const std::string &target) const
 {
-	send_rpl_msg(sock, RPL_ENDOFSTATS,letter + " :End of /STATS report", target);
+	send_numeric(sock, RPL_ENDOFSTATS, target, letter, " :End of /STATS report");
 }
 
 void Irisha::rpl_statslinkinfo(const int sock, const std::string &msg, const std::string &target)
 {
-	send_rpl_msg(sock, RPL_STATSLINKINFO, msg, target);
+	send_numeric(sock, RPL_STATSLINKINFO, target, msg);
 }
 
 void Irisha::rpl_statsuptime(const int sock, const std::string &msg, const std::string &target)
 {
-	send_rpl_msg(sock, RPL_STATSUPTIME, msg, target);
+	send_numeric(sock, RPL_STATSUPTIME, target, msg);
+}
+
+void Irisha::rpl_statscommands(const int sock, const std::string &command, const CommandStats& stats, const std::string &target) const
+{
+	send_numeric(sock, RPL_STATSCOMMANDS, target, command, " ", stats.count, " ", stats.bytes_in, " ", stats.remote_count);
+}
+
+void Irisha::rpl_statsdebug(const int sock, const std::string &msg, const std::string &target) const
+{
+	send_numeric(sock, RPL_STATSDEBUG, target, msg);
+}
+
+void Irisha::rpl_statskline(const int sock, const std::string &msg, const std::string &target) const
+{
+	send_numeric(sock, RPL_STATSKLINE, target, msg);
+}
+
+void Irisha::rpl_statsyline(const int sock, const std::string &msg, const std::string &target) const
+{
+	send_numeric(sock, RPL_STATSYLINE, target, msg);
 }
 
 void Irisha::rpl_links(const int sock, const std::string &serv_name, int hopcount, const std::string &target)
 {
-	send_rpl_msg(sock, RPL_LINKS, serv_name + " :" + int_to_str(hopcount), target);
+	send_numeric(sock, RPL_LINKS, target, serv_name, " :", hopcount);
 }
 
 void Irisha::rpl_endoflinks(const int sock, const std::string &serv_name, const std::string &target)
 {
-	send_rpl_msg(sock, RPL_ENDOFLINK, serv_name + " :End of /LINKS list", target);
+	send_numeric(sock, RPL_ENDOFLINK, target, serv_name, " :End of /LINKS list");
 }
 
 void Irisha::rpl_ison(const int sock, const std::string &nick)
 {
-	send_rpl_msg(sock, RPL_ISON, nick);
+	send_numeric(sock, RPL_ISON, connection_name(sock), nick);
+}
+
+/**
+ * @description	Sends channel members as 353 lines that fit in 512 bytes.
+ * 				Segments are cached by the channel and sized for the longest
+ * 				allowed nick, so every receiver shares them
+ * @param		sock
+ * @param		channel
+ * @param		target: receiver nick
+ */
+void Irisha::rpl_namreply(const int sock, Channel* channel, const std::string& target) const
+{
+	// ":<domain> 353 <target> = <channel> :<names>\r\n"
+	size_t header = domain_.size() + std::max<size_t>(target.size(), NICK_MAX_LEN)
+					+ channel->getName().size() + 13;
+	size_t width = (header + NICK_MAX_LEN + 1 < IRC_LINE_MAX) ? IRC_LINE_MAX - header : NICK_MAX_LEN + 1;
+	const char* type = (channel->getMode().find('s')->second == 1) ? "@ " : "= ";
+
+	const std::vector<std::string>& names = channel->getNames(width);
+	for (size_t i = 0; i < names.size(); ++i)
+		send_numeric(sock, RPL_NAMREPLY, target, type, channel->getName(), " :", names[i]);
+}
+
+void Irisha::rpl_endofnames(const int sock, const std::string& channel, const std::string& target) const
+{
+	send_numeric(sock, RPL_ENDOFNAME, target, channel, " :End of NAMES list");
+}
+
+void Irisha::rpl_list(const int sock, const Channel* channel, const std::string& target) const
+{
+	send_numeric(sock, RPL_LIST, target, channel->getName(), " ", channel->getUsers().size(), " :", channel->getTopic());
+}
+
+void Irisha::rpl_listend(const int sock, const std::string& target) const
+{
+	send_numeric(sock, RPL_LISTEND, target, ":End of LIST");
 }
\ No newline at end of file
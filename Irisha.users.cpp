@@ -10,8 +10,9 @@
  */
 void Irisha::add_user(const int sock, const std::string& nick)
 {
-	User* user = new User(sock, domain_, nick);
-	connections_.insert(std::pair<std::string, AConnection*>(nick, user));
+	std::map<int, Link>::const_iterator link = links_.find(sock);
+	User* user = new User(sock, domain_, nick, peer_host((link == links_.end()) ? nullptr : link->second.peer()));
+	add_connection(nick, user);
 }
 
 /**
@@ -33,7 +34,7 @@ void Irisha::add_user(int source_sock) // [0]<nick> [1]<hopcount> [2]<username>
 		user->set_mode_str(cmd_.arguments_[5]);
 	}
 	user->set_realname(cmd_.arguments_[2]);
-	connections_.insert(std::pair<std::string, AConnection*>(cmd_.arguments_[0], user));
+	add_connection(cmd_.arguments_[0], user);
 
 	sys_msg(E_ALIEN, "New external user", cmd_.arguments_[0], "registered!");
 }
@@ -50,25 +51,37 @@ void Irisha::remove_user(const std::string& nick)
 		std::cout << E_CROSS RED "Can't remove user " + nick + CLR << std::endl;
 		return;
 	}
-	std::string ch_name;
 	while (!user->channels().empty())
 	{
-		ch_name = user->channels().back();
-		channels_.find(ch_name)->second->delUser(user);
-		channels_.find(ch_name)->second->delOperators(user);
-		if (channels_.find(ch_name)->second->getUsers().size() == 0)
+		std::string ch_name = user->channels().back();
+		std::map<std::string, Channel*>::iterator channel = channels_.find(ch_name);
+		if (channel == channels_.end())
 		{
-			Channel* channel = channels_.find(ch_name)->second;
-			channels_.erase(channel->getName());
-			delete channel;
-		} else
-			send_local_channel(channels_.find(ch_name)->second, "PART " + ch_name, user->nick(), user->socket());
-		user->channels().pop_back();
-    }
-	connections_.erase(nick);
+			user->channels().pop_back();
+			continue;
+		}
+		if (!part_channel(channel->second, user))
+			send_local_channel(channel->second, "PART " + ch_name, user, user->socket());
+	}
+	erase_connection(nick);
 	delete user;
 }
 
+/**
+ * @description	Drops cached NAMES of user channels (after nick change)
+ * @param		user
+ */
+void Irisha::invalidate_names(User* user)
+{
+	std::vector<Atom>::const_iterator it = user->channels().begin();
+	for (; it != user->channels().end(); ++it)
+	{
+		std::map<std::string, Channel*>::iterator channel = channels_.find(*it);
+		if (channel != channels_.end())
+			channel->second->invalidateNames();
+	}
+}
+
 /**
  * @description	Removes user by pointer
  * @param		user: pointer to User
@@ -80,22 +93,19 @@ void Irisha::remove_user(User*& user)
         std::cout << E_CROSS RED "Can't remove user " CLR << std::endl;
         return;
     }
-	std::string ch_name;
 	while (!user->channels().empty())
 	{
-		ch_name = user->channels().back();
-		channels_.find(ch_name)->second->delUser(user);
-		channels_.find(ch_name)->second->delOperators(user);
-		if (channels_.find(ch_name)->second->getUsers().size() == 0)
+		std::string ch_name = user->channels().back();
+		std::map<std::string, Channel*>::iterator channel = channels_.find(ch_name);
+		if (channel == channels_.end())
 		{
-			Channel* channel = channels_.find(ch_name)->second;
-			channels_.erase(channel->getName());
-			delete channel;
-		} else
-			send_local_channel(channels_.find(ch_name)->second, "PART " + ch_name, user->nick(), user->socket());
-		user->channels().pop_back();
+			user->channels().pop_back();
+			continue;
+		}
+		if (!part_channel(channel->second, user))
+			send_local_channel(channel->second, "PART " + ch_name, user, user->socket());
 	}
-	connections_.erase(user->nick());
+	erase_connection(user->nick());
 	delete user;
 }
 
@@ -114,6 +124,7 @@ void Irisha::remove_server_users(const std::string& name)
 			++it;
 			if (user->server() == name)
 				remove_user(user);
+			continue;
 		}
 		++it;
 	}
@@ -126,37 +137,114 @@ void Irisha::remove_server_users(const std::string& name)
  */
 User* Irisha::find_user(const std::string& nick) const
 {
-	User*			user;
-	con_const_it	it = connections_.begin();
-	for (; it != connections_.end(); ++it)
+	con_const_it it = connections_.find(nick);
+	if (it == connections_.end() || it->second->type() != T_CLIENT)
+		return nullptr;
+	return static_cast<User*>(it->second);
+}
+
+/**
+ * @description	Finds user by socket
+ * @param		sock: socket
+ * @return		user pointer or nullptr
+ */
+User* Irisha::find_user(const int sock) const
+{
+	AConnection* connection = find_connection(sock);
+	if (connection == nullptr || connection->type() != T_CLIENT)
+		return nullptr;
+	return static_cast<User*>(connection);
+}
+
+/**
+ * @description	Adds user to (delta 1) or removes from (delta -1) nick and host indexes
+ * @param		user
+ * @param		nick: nick user is indexed with
+ * @param		delta
+ */
+void Irisha::index_user(User* user, const std::string& nick, int delta)
+{
+	std::string	folded	= casefold(nick);
+	std::string	host	= casefold(user->host());
+
+	index_user(nicks_, folded, user, delta);
+	index_user(nicks_reversed_, std::string(folded.rbegin(), folded.rend()), user, delta);
+	index_user(hosts_, host, user, delta);
+	index_user(hosts_reversed_, std::string(host.rbegin(), host.rend()), user, delta);
+}
+
+/**
+ * @description	Adds or removes one index entry
+ * @param		index
+ * @param		key
+ * @param		user
+ * @param		delta: 1 adds, -1 removes
+ */
+void Irisha::index_user(std::multimap<std::string, User*>& index, const std::string& key, User* user, int delta)
+{
+	if (delta > 0)
 	{
-		if (it->second->type() == T_CLIENT)
+		index.insert(std::make_pair(key, user));
+		return;
+	}
+	typedef std::multimap<std::string, User*>::iterator index_it;
+	std::pair<index_it, index_it> range = index.equal_range(key);
+	for (index_it it = range.first; it != range.second; ++it)
+	{
+		if (it->second == user)
 		{
-			user = static_cast<User*>(it->second);
-			if (user->nick() == nick)
-				return user;
+			index.erase(it);
+			return;
 		}
 	}
-	return nullptr;
 }
 
 /**
- * @description	Finds user by socket
- * @param		sock: socket
+ * @description	Finds user by nick in any case (RFC 1459 casemapping)
+ * @param		nick
  * @return		user pointer or nullptr
  */
-User* Irisha::find_user(const int sock) const
+User* Irisha::find_user_folded(const std::string& nick) const
 {
-	User*			user;
-	con_const_it	it = connections_.begin();
-	for (; it != connections_.end(); ++it)
+	std::multimap<std::string, User*>::const_iterator it = nicks_.find(casefold(nick));
+	return (it != nicks_.end()) ? it->second : nullptr;
+}
+
+/**
+ * @description	Gets name of the server user is connected to (the uplink for remote users)
+ * @param		user
+ * @return		server name
+ */
+std::string Irisha::user_server(const User* user) const
+{
+	if (user->socket() != U_EXTERNAL_CONNECTION)
+		return domain_;
+	if (!user->server().empty())
+		return user->server();
+	Server* uplink = find_server(user->source_socket());
+	return (uplink != nullptr) ? uplink->name() : domain_;
+}
+
+/**
+ * @description	Checks if viewer may see target in WHO: target isn't invisible (+i)
+ * 				or they share a channel
+ * @param		target
+ * @param		viewer
+ * @return		true if visible
+ */
+bool Irisha::is_visible_to(User* target, User* viewer) const
+{
+	if (target == viewer || !target->has_mode('i'))
+		return true;
+	std::vector<Atom>& theirs = target->channels();
+	std::vector<Atom>& mine = viewer->channels();
+	for (size_t i = 0; i < theirs.size(); ++i)
 	{
-		if (it->second->type() == T_CLIENT)
+		for (size_t j = 0; j < mine.size(); ++j)
 		{
-			user = static_cast<User*>(it->second);
-			if (user->socket() == sock)
-				return user;
+			if (theirs[i] == mine[j])
+				return true;
 		}
 	}
-	return nullptr;
+	return false;
 }
@@ -2,9 +2,11 @@
 #include "Irisha.hpp"
 #include "Channel.hpp"
 #include "utils.hpp"
+#include "parser.hpp"
 
 #include <sstream>
 #include <iomanip>
+#include <cerrno>
 
 /**
  * Determines user which sent message. If command prefix is empty determines by socket, else by prefix
@@ -79,25 +81,22 @@ int Irisha::choose_sock(AConnection *connection)
 
 std::string*	Irisha::choose_buff(int sock, std::list<Irisha::RegForm*>& reg_expect)
 {
-	std::string*	buff;
+	std::map<int, Link>::iterator link = links_.find(sock);
+	if (link == links_.end())
+		return nullptr;
 	AConnection*	sender = find_connection(sock);
 	if (sender == nullptr)
 	{
-		RegForm*	form = find_regform(sock, reg_expect);
-		if (form != nullptr)
+		std::list<RegForm*>::iterator it = expecting_registration(sock, reg_expect);
+		if (it != reg_expect.end())
 		{
-			buff = &form->buff_;
-			form->connection_time_ = time(nullptr);
+			(*it)->connection_time_ = get_time();
+			reg_expect.splice(reg_expect.end(), reg_expect, it);	// Keep the list ordered by time
 		}
-		else
-			return &buff_;
 	}
 	else
-	{
-		buff = &sender->buff();
 		sender->update_time();
-	}
-	return buff;
+	return &link->second.input();
 }
 
 /**
@@ -124,7 +123,7 @@ int 			Irisha::next_token()
 /**
  * @description	Receives a message from socket
  * @param		socket: sender socket
- * @return		message received from socket
+ * @return		input buffer of the socket, nullptr if it was closed
  */
 std::string* Irisha::get_msg(int sock, std::list<Irisha::RegForm*>& reg_expect)
 {
@@ -132,21 +131,20 @@ std::string* Irisha::get_msg(int sock, std::list<Irisha::RegForm*>& reg_expect)
 
     cmd_.type_ = connection_type(sock);
 	int read_bytes = recv(sock, &tmp_buff, 512, 0);
-	if (read_bytes < 0)
-		throw std::runtime_error("Recv error in get_msg()");
-
-	if (read_bytes == 0)
-		close_connection(sock, "connection lost", &reg_expect);
-	else if (read_bytes > 510)
+	if (read_bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		read_bytes = 0;		// Nothing to read yet
+	else if (read_bytes <= 0)	// Closed or reset by peer
 	{
-		send_msg(sock, domain_, "Error! Request is too long");
+		close_connection(sock, (read_bytes == 0) ? "connection lost" : "read error", &reg_expect);
 		read_bytes = 0;
 	}
+	counters_.bytes_in += static_cast<unsigned long>(read_bytes);
 	tmp_buff[read_bytes] = '\0';
 
 	std::string*	buff = choose_buff(sock, reg_expect);
 
-	*buff += tmp_buff;
+	if (buff != nullptr)
+		*buff += tmp_buff;
 	return buff;
 }
 
@@ -157,12 +155,8 @@ std::string* Irisha::get_msg(int sock, std::list<Irisha::RegForm*>& reg_expect)
  */
 AConnection* Irisha::find_connection(const int sock) const
 {
-	for (con_const_it it = connections_.begin(); it != connections_.end(); ++it)
-	{
-		if (it->second->socket() == sock)
-			return it->second;
-	}
-	return nullptr;
+	std::map<int, AConnection*>::const_iterator it = sockets_.find(sock);
+	return (it != sockets_.end()) ? it->second : nullptr;
 }
 
 /**
@@ -172,12 +166,93 @@ AConnection* Irisha::find_connection(const int sock) const
  */
 AConnection* Irisha::find_connection(const std::string& name) const
 {
-	for (con_const_it it = connections_.begin(); it != connections_.end(); ++it)
+	con_const_it it = connections_.find(name);
+	return (it != connections_.end()) ? it->second : nullptr;
+}
+
+/**
+ * @description	Registers connection under name and counts it
+ * @param		name: nick or server name
+ * @param		connection
+ */
+void Irisha::add_connection(const std::string& name, AConnection* connection)
+{
+	if (!connections_.insert(std::pair<std::string, AConnection*>(name, connection)).second)
+		return;
+	count_connection(connection, 1);
+	if (connection->socket() != U_EXTERNAL_CONNECTION)
+		sockets_[connection->socket()] = connection;
+	if (connection->type() == T_CLIENT)
+		index_user(static_cast<User*>(connection), name, 1);
+}
+
+/**
+ * @description	Forgets connection (without deleting it) and uncounts it
+ * @param		name: nick or server name
+ */
+void Irisha::erase_connection(const std::string& name)
+{
+	con_it it = connections_.find(name);
+	if (it == connections_.end())
+		return;
+	AConnection* connection = it->second;
+	count_connection(connection, -1);
+	if (connection->socket() != U_EXTERNAL_CONNECTION)
 	{
-		if (it->first == name)
-			return it->second;
+		std::map<int, AConnection*>::iterator sock = sockets_.find(connection->socket());
+		if (sock != sockets_.end() && sock->second == connection)
+			sockets_.erase(sock);
 	}
-	return nullptr;
+	if (connection->type() == T_CLIENT)
+	{
+		User* user = static_cast<User*>(connection);
+		if (user->is_operator())
+			--counters_.operators;
+		whowas_.add(name, user->username(), user->host(), user->realname(), user_server(user), get_time());
+		index_user(user, name, -1);
+	}
+	connections_.erase(it);
+}
+
+/**
+ * @description	Moves connection to a new name (nick change)
+ * @param		old_name
+ * @param		new_name
+ */
+void Irisha::rename_connection(const std::string& old_name, const std::string& new_name)
+{
+	con_it it = connections_.find(old_name);
+	if (it == connections_.end() || old_name == new_name)
+		return;
+	AConnection* connection = it->second;
+	connections_.erase(it);
+	connections_.insert(std::pair<std::string, AConnection*>(new_name, connection));
+	if (connection->type() == T_CLIENT)
+	{
+		User* user = static_cast<User*>(connection);
+		whowas_.add(old_name, user->username(), user->host(), user->realname(), user_server(user), get_time());
+		index_user(user, old_name, -1);
+		index_user(user, new_name, 1);
+	}
+}
+
+/**
+ * @description	Updates connection gauges by type and locality
+ * @param		connection
+ * @param		delta: 1 when added, -1 when removed
+ */
+void Irisha::count_connection(const AConnection* connection, int delta)
+{
+	bool			local = (connection->socket() != U_EXTERNAL_CONNECTION);
+	unsigned long*	counter;
+
+	if (connection->type() == T_CLIENT)
+		counter = local ? &counters_.local_clients : &counters_.remote_clients;
+	else if (connection->type() == T_SERVER)
+		counter = local ? &counters_.local_servers : &counters_.remote_servers;
+	else
+		return;
+	*counter += static_cast<unsigned long>(static_cast<long>(delta));
 }
 
 /**
@@ -187,18 +262,10 @@ AConnection* Irisha::find_connection(const std::string& name) const
  */
 Server* Irisha::find_server(const std::string& name) const
 {
-	Server*			server;
-	con_const_it	it = connections_.begin();
-	for (; it != connections_.end(); ++it)
-	{
-		if (it->second->type() == T_SERVER)
-		{
-			server = static_cast<Server*>(it->second);
-			if (server->name() == name)
-				return server;
-		}
-	}
-	return nullptr;
+	con_const_it it = connections_.find(name);
+	if (it == connections_.end() || it->second->type() != T_SERVER)
+		return nullptr;
+	return static_cast<Server*>(it->second);
 }
 
 /**
@@ -208,18 +275,10 @@ Server* Irisha::find_server(const std::string& name) const
  */
 Server* Irisha::find_server(const int sock) const
 {
-	Server*			server;
-	con_const_it	it = connections_.begin();
-	for (; it != connections_.end(); ++it)
-	{
-		if (it->second->type() == T_SERVER)
-		{
-			server = static_cast<Server*>(it->second);
-			if (server->socket() == sock)
-				return server;
-		}
-	}
-	return nullptr;
+	AConnection* connection = find_connection(sock);
+	if (connection == nullptr || connection->type() != T_SERVER)
+		return nullptr;
+	return static_cast<Server*>(connection);
 }
 
 /**
@@ -237,21 +296,18 @@ void Irisha::print_info() const
  * @param		sock: receiver socket
  * @param		msg: message
  */
-void Irisha::send_msg(int sock, const std::string& prefix, const std::string& msg) const
+void Irisha::send_msg(int sock, const std::string& prefix, StringRef msg) const
 {
-	std::string message;
+	ScratchString message(scratch_);
+	message.reserve(prefix.size() + msg.size + 4);
 	if (!prefix.empty())
-		message = ":" + prefix + " " + msg;
-	else
-		message = msg;
+		message.append(":").append(prefix.data(), prefix.size()).append(" ");
+	message.append(msg.data, msg.size);
 
-	std::cout << time_stamp() + message + " " E_SPEECH PURPLE ITALIC " to "
-								+ connection_name(sock) << CLR << std::endl;
+	std::cout << time_stamp() << message << " " E_SPEECH PURPLE ITALIC " to "
+			  << connection_name(sock) << CLR << std::endl;
 	message.append("\r\n");
-
-	ssize_t n = send(sock, message.c_str(), message.length(), 0);
-	if (n == -1)
-		throw std::runtime_error("Send error");
+	queue_msg(sock, message);
 }
 
 /**
@@ -259,17 +315,229 @@ void Irisha::send_msg(int sock, const std::string& prefix, const std::string& ms
  * @param		sock: receiver socket
  * @param		msg: message
  */
-void Irisha::send_msg(int sock, const std::string& msg) const
+void Irisha::send_msg(int sock, StringRef msg) const
 {
-	std::string message = msg;
+	ScratchString message(scratch_);
+	message.reserve(msg.size + 2);
+	message.append(msg.data, msg.size);
 
-	std::cout << time_stamp() + message + " " E_SPEECH PURPLE ITALIC " to "
-				 + connection_name(sock) << CLR << std::endl;
+	std::cout << time_stamp() << message << " " E_SPEECH PURPLE ITALIC " to "
+			  << connection_name(sock) << CLR << std::endl;
 	message.append("\r\n");
+	queue_msg(sock, message);
+}
+
+/**
+ * @description	Sends a message from user: clients get the full nick!user@host
+ * 				prefix kept by the user, servers get the nick
+ * @param		sock: receiver socket
+ * @param		sender
+ * @param		msg: message
+ */
+void Irisha::send_msg(int sock, const User* sender, StringRef msg) const
+{
+	std::map<int, Link>::const_iterator link = links_.find(sock);
+	if (link == links_.end() || link->second.server() || sock == parent_fd_)
+	{
+		send_msg(sock, sender->nick(), msg);
+		return;
+	}
+	const std::string&	prefix = sender->wire_prefix();
+	ScratchString		message(scratch_);
+	message.reserve(prefix.size() + msg.size);
+	message.append(prefix.data(), prefix.size()).append(msg.data, msg.size);
+	send_msg(sock, message);
+}
+
+enum eLane
+{
+	LANE_BULK,
+	LANE_KEEPALIVE,
+	LANE_CLOSING
+};
+
+/**
+ * @description	Chooses output lane of message: PING and PONG must not wait behind
+ * 				bulk data or busy peers time out, ERROR is the last thing a closing
+ * 				peer gets (bulk lines not started yet are dropped for it). Lines which depend on the order of the queue (SQUIT, KILL)
+ * 				stay in the bulk lane
+ * @param		message: line with optional prefix
+ */
+static eLane line_lane(StringRef message)
+{
+	size_t begin = command_begin(message);
+	if (begin == std::string::npos || begin + 6 > message.size)
+		return LANE_BULK;
+	const char* command = message.data + begin;
+	if (memcmp(command, "PING ", 5) == 0 || memcmp(command, "PONG ", 5) == 0)
+		return LANE_KEEPALIVE;
+	if (memcmp(command, "ERROR ", 6) == 0)
+		return LANE_CLOSING;
+	return LANE_BULK;
+}
+
+/**
+ * @description	Puts a message (with CRLF) to the socket output queue,
+ * 				it is written when the loop iteration ends. A connection going
+ * 				over the sendq cap of its class gets nothing more and is
+ * 				dropped before the flush (ERROR still passes, the socket is
+ * 				closed right after it). Nothing is queued after ERROR
+ * @param		sock: receiver socket
+ * @param		message
+ */
+void Irisha::queue_msg(int sock, StringRef message) const
+{
+	std::map<int, Link>::iterator link = links_.find(sock);
+	if (link == links_.end())
+		return;
+	Link&	out		= link->second;
+	eLane	lane	= line_lane(message);
+	if (out.closing() || (lane != LANE_CLOSING && !fits_sendq(sock, out, message.size)))
+		return;
+	if (lane == LANE_BULK)
+		out.queue(message.data, message.size);
+	else if (lane == LANE_KEEPALIVE)
+		out.queue_urgent(message.data, message.size);
+	else
+		counters_.sendq_bytes -= out.queue_closing(message.data, message.size);
+	++counters_.messages_out;
+	counters_.bytes_out += message.size;
+	counters_.sendq_bytes += message.size;
+}
+
+/**
+ * @description	Puts a block of complete lines given in parts to the socket
+ * 				output queue at once (bulk lane)
+ * @param		sock: receiver socket
+ * @param		parts: block pieces in order
+ * @param		count: number of parts
+ * @param		lines: lines in the block (for counters)
+ */
+void Irisha::queue_block(int sock, const struct iovec* parts, size_t count, unsigned long lines) const
+{
+	std::map<int, Link>::iterator link = links_.find(sock);
+	if (link == links_.end() || link->second.closing())
+		return;
+	size_t size = 0;
+	for (size_t i = 0; i < count; ++i)
+		size += parts[i].iov_len;
+	if (!fits_sendq(sock, link->second, size))
+		return;
+	link->second.queue(parts, count);
+	counters_.messages_out += lines;
+	counters_.bytes_out += size;
+	counters_.sendq_bytes += size;
+}
 
-	ssize_t n = send(sock, message.c_str(), message.length(), 0);
-	if (n == -1)
-		throw std::runtime_error("Send error");
+/**
+ * @description	Checks that size more bytes fit the sendq cap of the link. The
+ * 				first time they don't, the connection is marked to be dropped
+ * 				before the flush and nothing more is queued for it
+ * @param		sock
+ * @param		out: link of sock
+ * @param		size: bytes to queue
+ * @return		true if they fit
+ */
+bool Irisha::fits_sendq(int sock, Link& out, size_t size) const
+{
+	if (!out.overflow() && out.sendq() + size <= classes_[out.link_class()].sendq)
+		return true;
+	if (!out.overflow())
+	{
+		out.set_overflow(true);
+		slow_consumers_.push_back(sock);
+	}
+	return false;
+}
+
+/**
+ * @description	Closes connection which went over a queue cap of its class
+ * @param		sock
+ * @param		sendq: sendq cap (or recvq one)
+ */
+void Irisha::drop_over_cap(int sock, bool sendq)
+{
+	std::map<int, Link>::iterator link = links_.find(sock);
+	if (link == links_.end())
+		return;
+	ConnectionClass& link_class = classes_[link->second.link_class()];
+	std::string reason = sendq ? "SendQ exceeded" : "RecvQ exceeded";
+	if (sendq)
+	{
+		++link_class.sendq_drops;
+		++counters_.sendq_exceeded;
+	}
+	else
+	{
+		++link_class.recvq_drops;
+		++counters_.recvq_exceeded;
+	}
+	std::cout << time_stamp() + RED + connection_name(sock) + ": " + reason + " (" + link_class.name + " class)" CLR << std::endl;
+	send_msg(sock, domain_, "ERROR :Closing Link: (" + reason + ")");
+	close_connection(sock, reason, &reg_expect_);
+}
+
+/**
+ * @description	Drops connections which went over their sendq cap (closing one
+ * 				can queue QUIT for others and overflow them too)
+ */
+void Irisha::drop_slow_consumers()
+{
+	while (!slow_consumers_.empty())
+	{
+		int sock = slow_consumers_.back();
+		slow_consumers_.pop_back();
+		drop_over_cap(sock, true);
+	}
+}
+
+/**
+ * @description	Bytes of received input which aren't handled yet
+ * @param		sock
+ */
+size_t Irisha::recvq(int sock) const
+{
+	std::map<int, Link>::iterator link = links_.find(sock);
+	return (link != links_.end()) ? link->second.input().size() : 0;
+}
+
+/**
+ * @description	Writes output queues of sockets which can accept data
+ */
+void Irisha::flush_links()
+{
+	for (std::map<int, Link>::iterator it = links_.begin(); it != links_.end(); ++it)
+	{
+		Link&	link = it->second;
+		if (!link.pending() || (link.blocked() && !FD_ISSET(it->first, &write_fds_)))
+			continue;
+		size_t before = link.sendq();
+		link.flush();
+		counters_.sendq_bytes -= before - link.sendq();
+	}
+}
+
+/**
+ * @description	Writes what is left in the socket output queue (without blocking)
+ * 				and closes the socket
+ * @param		sock
+ */
+void Irisha::close_socket(int sock)
+{
+	std::map<int, Link>::iterator link = links_.find(sock);
+	if (link == links_.end())
+		return;
+	link->second.flush();
+	counters_.sendq_bytes -= link->second.sendq();
+	links_.erase(link);
+	list_queries_.erase(sock);
+	deferred_.erase(sock);
+	backlog_.erase(sock);
+	admission_.release(sock);
+	FD_CLR(sock, &all_fds_);
+	FD_CLR(sock, &read_fds_);
+	FD_CLR(sock, &write_fds_);
+	close(sock);
 }
 
 /**
@@ -277,7 +545,7 @@ void Irisha::send_msg(int sock, const std::string& msg) const
  * @param		prefix: sender
  * @param		msg: message
  */
-void Irisha::send_servers(const std::string& prefix, const std::string& msg) const
+void Irisha::send_servers(const std::string& prefix, StringRef msg) const
 {
 	con_const_it	it = connections_.begin();
 	for (; it != connections_.end(); ++it)
@@ -293,7 +561,7 @@ void Irisha::send_servers(const std::string& prefix, const std::string& msg) con
  * @param		msg: message
  * @param		sock: exception socket
  */
-void Irisha::send_servers(const std::string& prefix, const std::string& msg, const int sock) const
+void Irisha::send_servers(const std::string& prefix, StringRef msg, const int sock) const
 {
 	con_const_it	it = connections_.begin();
 	for (; it != connections_.end(); ++it)
@@ -309,7 +577,7 @@ void Irisha::send_servers(const std::string& prefix, const std::string& msg, con
  * @param		msg: message
  * @param		sock: exception socket
  */
-void Irisha::send_servers(const std::string& msg, const int sock) const
+void Irisha::send_servers(StringRef msg, const int sock) const
 {
 	con_const_it	it = connections_.begin();
 	for (; it != connections_.end(); ++it)
@@ -325,7 +593,7 @@ void Irisha::send_servers(const std::string& msg, const int sock) const
  * @param		prefix: sender
  * @param		msg: message
  */
-void Irisha::send_everyone(const std::string& prefix, const std::string& msg) const
+void Irisha::send_everyone(const std::string& prefix, StringRef msg) const
 {
 	con_const_it	it = connections_.begin();
 	for (; it != connections_.end(); ++it)
@@ -344,13 +612,83 @@ void Irisha::handle_command(const int sock)
 	if (!is_valid_prefix(sock))
 		return;
 	std::map<std::string, func>::const_iterator it = commands_.find(cmd_.command_);
-	if (it != commands_.end())	// Execute command
+	if (it != commands_.end())	// Execute command and account its time and traffic
+	{
+		std::map<int, Link>::const_iterator	link = links_.find(sock);
+		bool			remote = (link != links_.end() && link->second.server());
+		size_t			bytes_in = cmd_.line_.size() + 2;
+		unsigned long	queued = counters_.bytes_out;
+		unsigned long	start = get_usec();
+
 		((*this).*it->second)(sock);
+		unsigned long usec = get_usec() - start;
+		command_stats_[it->first].record(usec, bytes_in, counters_.bytes_out - queued, remote);
+		loop_stats_.handler_usec += usec;
+		if (handler_budget_ != 0 && usec > handler_budget_)
+		{
+			++loop_stats_.budget_overruns;
+			std::cout << time_stamp() + YELLOW "Slow handler: " + it->first + " took " + ulong_to_str(usec / 1000)
+						 + " ms (budget " + ulong_to_str(handler_budget_ / 1000) + " ms), sender " + connection_name(sock) << CLR << std::endl;
+		}
+	}
 	else
 		err_unknowncommand(sock, cmd_.command_);
 }
 
-void Irisha::send_local_channel(Channel *channel, std::string msg, std::string prefix, int sock)
+/**
+ * @description	Flood penalty of command in lines: replies which walk many users
+ * 				or channels cost more than a message
+ * @param		command
+ * @return		penalty in lines
+ */
+static unsigned long command_penalty(const std::string& command)
+{
+	if (command == "LIST" || command == "WHO" || command == "WHOIS" || command == "WHOWAS"
+		|| command == "NAMES" || command == "STATS")
+		return 4;
+	return 1;
+}
+
+/**
+ * @description	Charges the line in cmd_ to the flood clock of sender.
+ * 				Server links (and the uplink) are never limited
+ * @param		sock: sender socket
+ * @param		now: monotonic time in microseconds
+ * @return		false if the sender is over its budget and the line has to wait
+ */
+bool Irisha::charge_line(int sock, unsigned long now)
+{
+	std::map<int, Link>::iterator link = links_.find(sock);
+	if (link == links_.end() || sock == parent_fd_)
+		return true;
+	if (link->second.flooding(now, flood_window_))
+		return false;
+	if (!link->second.server())
+		link->second.penalize(now, flood_unit_ * command_penalty(cmd_.command_));
+	return true;
+}
+
+/**
+ * @description	Time until the first held client may send a line again
+ * @param		now: monotonic time in microseconds
+ * @return		microseconds
+ */
+unsigned long Irisha::deferred_wait(unsigned long now) const
+{
+	unsigned long wait = flood_window_;
+	for (std::set<int>::const_iterator it = deferred_.begin(); it != deferred_.end(); ++it)
+	{
+		std::map<int, Link>::const_iterator link = links_.find(*it);
+		if (link == links_.end() || link->second.flood_clock() < now + flood_window_)
+			return 0;
+		unsigned long left = link->second.flood_clock() - flood_window_ - now + 1;
+		if (left < wait)
+			wait = left;
+	}
+	return wait;
+}
+
+void Irisha::send_local_channel(Channel *channel, StringRef msg, const User* sender, int sock)
 {
     std::vector<User*>::const_iterator itr = channel->getUsers().begin();
     std::vector<User*>::const_iterator ite = channel->getUsers().end();
@@ -358,14 +696,13 @@ void Irisha::send_local_channel(Channel *channel, std::string msg, std::string p
     while (itr != ite)
     {
         if ((*itr)->socket() != U_EXTERNAL_CONNECTION && (*itr)->socket() != sock) {
-            send_msg((*itr)->socket(), prefix, msg);
+            send_msg((*itr)->socket(), sender, msg);
         }
         itr++;
-		std::cout << "send_local_channel cycle" << std::endl; //TODO:del it
     }
 }
 /// Send msg channel all users and operators
-void Irisha::send_channel(Channel *channel, std::string msg, std::string prefix)
+void Irisha::send_channel(Channel *channel, StringRef msg, const User* sender)
 {
     std::vector<User*>::const_iterator itr = channel->getUsers().begin();
     std::vector<User*>::const_iterator ite = channel->getUsers().end();
@@ -373,14 +710,14 @@ void Irisha::send_channel(Channel *channel, std::string msg, std::string prefix)
     while (itr != ite)
     {
         if ((*itr)->socket() != U_EXTERNAL_CONNECTION) {
-            send_msg((*itr)->socket(), prefix, msg);
+            send_msg((*itr)->socket(), sender, msg);
         }
         itr++;
     }
-    send_servers(prefix, msg);
+    send_servers(sender->nick(), msg);
 }
 
-void Irisha::send_channel(Channel *channel, std::string msg, std::string prefix, int sock)
+void Irisha::send_channel(Channel *channel, StringRef msg, const User* sender, int sock)
 {
     std::vector<User*>::const_iterator itr = channel->getUsers().begin();
     std::vector<User*>::const_iterator ite = channel->getUsers().end();
@@ -388,10 +725,10 @@ void Irisha::send_channel(Channel *channel, std::string msg, std::string prefix,
     while (itr != ite)
     {
         if ((*itr)->socket() != U_EXTERNAL_CONNECTION && (*itr)->socket() != sock)
-            send_msg((*itr)->socket(), prefix, msg);
+            send_msg((*itr)->socket(), sender, msg);
         itr++;
     }
-    send_servers(prefix, msg, sock);
+    send_servers(sender->nick(), msg, sock);
 }
 
 eType Irisha::connection_type(int sock)
@@ -500,21 +837,9 @@ bool Irisha::is_enough_args(int sock, const std::string& command, int min_args_n
  * @param		sock
  * @return		connection name
  */
-std::string Irisha::connection_name(const int sock) const
+const std::string& Irisha::connection_name(const int sock) const
 {
-	User*	user = find_user(sock);
-
-	std::string name;
-	if (user == nullptr)
-	{
-		Server*	server = find_server(sock);
-		if (server == nullptr)
-			return "unknown";
-		name = server->name();
-	}
-	else
-		name = user->nick();
-	return name;
+	return connection_name(find_connection(sock));
 }
 
 /**
@@ -522,39 +847,26 @@ std::string Irisha::connection_name(const int sock) const
  * @param		connection: AConnection pointer
  * @return		connection name
  */
-std::string Irisha::connection_name(AConnection* connection) const
+const std::string& Irisha::connection_name(AConnection* connection) const
 {
-	User*	user = dynamic_cast<User*>(connection);
+	static const std::string	unknown = "unknown";
 
-	std::string name;
-	if (user == nullptr)
-	{
-		Server*	server = dynamic_cast<Server*>(connection);
-		if (server == nullptr)
-			return "unknown";
-		name = server->name();
-	}
-	else
-		name = user->nick();
-	return name;
+	if (connection != nullptr && connection->type() == T_SERVER)
+		return static_cast<Server*>(connection)->name();
+	if (connection != nullptr && connection->type() == T_CLIENT)
+		return static_cast<User*>(connection)->nick();
+	return unknown;
 }
 
+/**
+ * @description	Closes connections which didn't register in time. Forms are
+ * 				ordered by their last activity, so the scan stops at the first young one
+ * @param		reg_expect
+ */
 void Irisha::check_reg_timeouts(std::list<Irisha::RegForm*>& reg_expect)
 {
-	if (reg_expect.empty())
-		return;
-	RegForm*	form;
-	for (std::list<Irisha::RegForm*>::iterator it = reg_expect.begin(); it != reg_expect.end();)
-	{
-		form = *it;
-		if (difftime(time(nullptr), form->connection_time_) >= reg_timeout_)
-		{
-			++it;
-			close_connection(form->socket_, "timeout", &reg_expect);
-			continue;
-		}
-		++it;
-	}
+	while (!reg_expect.empty() && difftime(get_time(), reg_expect.front()->connection_time_) >= reg_timeout_)
+		close_connection(reg_expect.front()->socket_, "timeout", &reg_expect);
 }
 
 void Irisha::ping_connections(time_t& last_ping)
@@ -580,7 +892,7 @@ void Irisha::ping_connections(time_t& last_ping)
 		}
 		++it;
 	}
-	last_ping = time(nullptr);
+	last_ping = get_time();
 }
 
 bool Irisha::is_valid_prefix(const int sock)
@@ -680,8 +992,9 @@ void Irisha::close_connection(const int sock, const std::string& comment, std::l
 		std::list<RegForm*>::iterator it = expecting_registration(sock, *reg_expect);
 		if (it != reg_expect->end())
 		{
+			RegForm* rf = *it;
 			reg_expect->erase(it);
-			delete *it;
+			delete rf;
 		}
 	}
 
@@ -707,9 +1020,7 @@ void Irisha::close_connection(const int sock, const std::string& comment, std::l
 		send_servers(user->nick(), "QUIT :" + comment);
 		remove_user(user->nick());
 	}
-	FD_CLR(sock, &all_fds_);
-	FD_CLR(sock, &read_fds_);
-	close(sock);
+	close_socket(sock);
 }
 
 void Irisha::remove_server(const std::string& name)
@@ -721,12 +1032,9 @@ void Irisha::remove_server(const std::string& name)
 		return;
 	}
 	if (server->socket() != U_EXTERNAL_CONNECTION)
-	{
-		FD_CLR(server->socket(), &all_fds_);
-		close(server->socket());
-	}
+		close_socket(server->socket());
 	remove_server_users(server->name());
-	connections_.erase(name);
+	erase_connection(name);
 	delete server;
 }
 
@@ -738,12 +1046,9 @@ void Irisha::remove_server(Server*& server)
 		return;
 	}
 	if (server->socket() != U_EXTERNAL_CONNECTION)
-	{
-		FD_CLR(server->socket(), &all_fds_);
-		close(server->socket());
-	}
+		close_socket(server->socket());
 	remove_server_users(server->name());
-	connections_.erase(server->name());
+	erase_connection(server->name());
 	delete server;
 }
 
@@ -767,6 +1072,28 @@ void Irisha::remove_local_server(Server*& server)
 		}
 		++it;
 	}
+	remove_link_users(sock);
+}
+
+/**
+ * @description	Removes external users which were introduced through the server link
+ * @param		sock: server link socket
+ */
+void Irisha::remove_link_users(int sock)
+{
+	User*	user;
+	for (con_it it = connections_.begin(); it != connections_.end();)
+	{
+		if (it->second->type() == T_CLIENT && it->second->socket() == U_EXTERNAL_CONNECTION
+			&& it->second->source_socket() == sock)
+		{
+			user = static_cast<User*>(it->second);
+			++it;
+			remove_user(user);
+			continue;
+		}
+		++it;
+	}
 }
 
 /**
@@ -800,9 +1127,7 @@ void Irisha::print_cmd(ePrintMode mode, const int sock) const
 		print_cmd(PM_LIST, sock);
 		return;
 	}
-	std::stringstream	sender;
-	sender << connection_name(sock);
-	std::cout << time_stamp() << "[" BLUE << sender.str() << CLR "] ";
+	std::cout << time_stamp() << "[" BLUE << connection_name(sock) << CLR "] ";
 	if (!cmd_.prefix_.empty())
 	{
 		if (mode == PM_LIST)
@@ -846,7 +1171,6 @@ void Irisha::user_info(const std::string& nick) const
 	std::cout << "| Nick: "		<< std::setw(23) << user->nick() << " |" << std::endl;
 	std::cout << "| Username: " << std::setw(19)	<< user->username() << " |" << std::endl;
 	std::cout << "| Realname: " << std::setw(19)	<< user->realname() << " |" << std::endl;
-	std::cout << "| Password: " << std::setw(19)	<< user->password() << " |" << std::endl;
 	std::cout << "| Mode: "		<< std::setw(23)	<< user->mode() << " |" << std::endl;
 	std::cout << "| Server: "	<< std::setw(21)	<< user->server() << " |" << std::endl;
 	std::cout << "| Hopcount: "	<< std::setw(19)	<< user->hopcount() << " |" << std::endl;
@@ -883,12 +1207,18 @@ Irisha::RegForm* Irisha::find_regform(int sock, std::list<Irisha::RegForm*>& reg
 	return nullptr;
 }
 
-std::string Irisha::time_stamp() const
+const std::string& Irisha::time_stamp() const
 {
+	time_t now = get_time();
 	if (time_stamp_ == U_DISABLED)
-		return "";
-	std::string msg = int_to_str(time(nullptr) - launch_time_);
-	return "[" + msg + "] ";
+		stamp_.clear();
+	else if (now != stamp_time_ || stamp_.empty())	// Rebuilt once a second
+	{
+		stamp_.clear();
+		append_parts(stamp_, '[', static_cast<long>(now - launch_time_), "] ");
+		stamp_time_ = now;
+	}
+	return stamp_;
 }
 
 void Irisha::send_channels(int sock)
@@ -0,0 +1,223 @@
+
+#include "Link.hpp"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+ConnectionClass::ConnectionClass() : sendq(0), recvq(0), sendq_drops(0), recvq_drops(0) {}
+
+Link::Link(int socket) : socket_(socket), sent_(0), urgent_sent_(0), blocked_(false), server_(false),
+							 class_(CL_CLIENT), overflow_(false), closing_(false), flood_clock_(0)
+{
+	memset(&peer_, 0, sizeof(peer_));
+	peer_.ss_family = AF_UNSPEC;
+}
+
+/**
+ * @description	Remembers peer address, it stays known after the peer resets the connection
+ * @param		address: address from accept()
+ * @param		size: bytes of address
+ */
+void	Link::set_peer(const sockaddr* address, socklen_t size)
+{
+	memcpy(&peer_, address, std::min<size_t>(size, sizeof(peer_)));
+}
+
+/**
+ * @description	Appends line (already terminated with CRLF) to the send queue
+ * @param		line
+ * @param		size: bytes of line
+ */
+void	Link::queue(const char* line, size_t size)
+{
+	sendq_.append(line, size);
+}
+
+/**
+ * @description	Appends line (already terminated with CRLF) to the urgent lane
+ * @param		line
+ * @param		size: bytes of line
+ */
+void	Link::queue_urgent(const char* line, size_t size)
+{
+	urgent_.append(line, size);
+}
+
+/**
+ * @description	Queues ERROR: it goes after the bulk line which is being written
+ * 				and bulk lines behind that one are dropped, nothing is queued after it
+ * @param		line
+ * @param		size: bytes of line
+ * @return		bytes of bulk lines dropped
+ */
+size_t	Link::queue_closing(const char* line, size_t size)
+{
+	size_t end = line_end();
+	size_t dropped = sendq_.size() - end;
+	sendq_.resize(end);
+	urgent_.append(line, size);
+	closing_ = true;
+	return dropped;
+}
+
+/**
+ * @description	Finds where the bulk line which is being written ends
+ * @return		offset in sendq_ right after its LF, sent_ if no line is started
+ */
+size_t	Link::line_end() const
+{
+	if (sent_ == 0 || sendq_[sent_ - 1] == '\n')
+		return sent_;
+	size_t end = sendq_.find('\n', sent_);
+	return (end == std::string::npos) ? sendq_.size() : end + 1;
+}
+
+/**
+ * @description	Appends complete lines given in parts (gathered like writev())
+ * 				to the send queue with one allocation at most
+ * @param		parts
+ * @param		count: number of parts
+ */
+void	Link::queue(const struct iovec* parts, size_t count)
+{
+	size_t size = 0;
+	for (size_t i = 0; i < count; ++i)
+		size += parts[i].iov_len;
+	sendq_.reserve(sendq_.size() + size);
+	for (size_t i = 0; i < count; ++i)
+		sendq_.append(static_cast<const char*>(parts[i].iov_base), parts[i].iov_len);
+}
+
+/**
+ * @description	Writes as much of the send queue as the socket accepts. Urgent
+ * 				lines are written right after the bulk line which is being sent
+ * @return		bytes written, 0 if the socket is full, -1 on socket error
+ */
+ssize_t	Link::flush()
+{
+	if (!pending())
+		return 0;
+	size_t boundary = (urgent_sent_ < urgent_.size()) ? line_end() : sent_;	// Bulk bytes which have to go before urgent ones
+	iovec	iov[3];
+	size_t	lengths[3] = { boundary - sent_, urgent_.size() - urgent_sent_, sendq_.size() - boundary };
+	iov[0].iov_base = const_cast<char*>(sendq_.data() + sent_);
+	iov[1].iov_base = const_cast<char*>(urgent_.data() + urgent_sent_);
+	iov[2].iov_base = const_cast<char*>(sendq_.data() + boundary);
+	for (int i = 0; i < 3; ++i)
+		iov[i].iov_len = lengths[i];
+
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = iov;
+	message.msg_iovlen = 3;
+	int flags = MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+	flags |= MSG_NOSIGNAL;
+#endif
+	ssize_t n = sendmsg(socket_, &message, flags);
+	if (n < 0)
+	{
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+		{
+			blocked_ = true;
+			return 0;
+		}
+		sendq_.clear();
+		urgent_.clear();
+		sent_ = 0;
+		urgent_sent_ = 0;
+		return -1;
+	}
+	size_t left = static_cast<size_t>(n);
+	size_t part = std::min(left, lengths[0]);
+	sent_ += part;
+	left -= part;
+	part = std::min(left, lengths[1]);
+	urgent_sent_ += part;
+	left -= part;
+	sent_ += left;
+	if (urgent_sent_ == urgent_.size())
+	{
+		urgent_.clear();
+		urgent_sent_ = 0;
+	}
+	blocked_ = pending();
+	if (sent_ == sendq_.size())
+	{
+		sendq_.clear();
+		sent_ = 0;
+	}
+	else if (sent_ > 65536 && sent_ * 2 > sendq_.size()) // Drop the written head once it dominates the buffer
+	{
+		size_t head = sendq_.rfind('\n', sent_ - 1) + 1;	// Keep the line being written: urgent lines wait for its end
+		sendq_.erase(0, head);
+		sent_ -= head;
+	}
+	return n;
+}
+
+/**
+ * @description	Charges a handled line to the flood clock
+ * @param		now: monotonic time in microseconds
+ * @param		penalty: cost of the line in microseconds
+ */
+void	Link::penalize(unsigned long now, unsigned long penalty)
+{
+	if (flood_clock_ < now)
+		flood_clock_ = now;
+	flood_clock_ += penalty;
+}
+
+/**
+ * @description	Tells if the next line has to wait (server links never do)
+ * @param		now: monotonic time in microseconds
+ * @param		window: how far the clock may run ahead of now
+ */
+bool	Link::flooding(unsigned long now, unsigned long window) const
+{
+	return !server_ && flood_clock_ >= now + window;
+}
+
+void	Link::set_blocked	(bool blocked)	{ blocked_ = blocked; }
+void	Link::set_server	(bool server)	{ server_ = server; }
+void	Link::set_class		(eClass link_class)	{ class_ = link_class; }
+void	Link::set_overflow	(bool overflow)	{ overflow_ = overflow; }
+
+int		Link::socket		() const { return socket_; }
+size_t	Link::sendq			() const { return sendq_.size() - sent_ + urgent_.size() - urgent_sent_; }
+bool	Link::pending		() const { return sent_ < sendq_.size() || urgent_sent_ < urgent_.size(); }
+bool	Link::blocked		() const { return blocked_; }
+bool	Link::server		() const { return server_; }
+eClass	Link::link_class	() const { return class_; }
+bool	Link::overflow		() const { return overflow_; }
+bool	Link::closing		() const { return closing_; }
+unsigned long	Link::flood_clock	() const { return flood_clock_; }
+
+const sockaddr*	Link::peer() const
+{
+	if (peer_.ss_family == AF_UNSPEC)
+		return nullptr;
+	return reinterpret_cast<const sockaddr*>(&peer_);
+}
+std::string&	Link::input		() { return recvq_; }
+
+/**
+ * @description	Heap bytes of a string: nothing while it fits the inline buffer
+ */
+static size_t	heap_bytes(const std::string& str)
+{
+	std::string empty;
+	return (str.capacity() > empty.capacity()) ? str.capacity() + 1 : 0;
+}
+
+/**
+ * @description	Memory held by the link: the object and its queues
+ * @return		bytes
+ */
+size_t	Link::footprint() const
+{
+	return sizeof(Link) + heap_bytes(recvq_) + heap_bytes(sendq_) + heap_bytes(urgent_);
+}
@@ -0,0 +1,95 @@
+
+#ifndef FT_IRC_LINK_HPP
+#define FT_IRC_LINK_HPP
+
+#include <string>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+enum eClass
+{
+	CL_CLIENT,
+	CL_OPER,
+	CL_SERVER,
+	CL_COUNT
+};
+
+/**
+ * Queue caps of a connection class and how often they were hit
+ */
+struct ConnectionClass
+{
+	std::string		name;
+	size_t			sendq;			// Output queue cap (bytes)
+	size_t			recvq;			// Unhandled input cap (bytes)
+	unsigned long	sendq_drops;	// Connections closed for going over sendq
+	unsigned long	recvq_drops;
+
+	ConnectionClass();
+};
+
+/**
+ * I/O state of one local socket (client, server or not registered yet).
+ * Received bytes wait here until complete lines are handled, so only local
+ * sockets carry an input buffer and remote users and servers carry none.
+ * Messages are queued here and written when the socket is ready, so a slow
+ * peer never blocks the loop and one send() carries many lines. Keepalives and
+ * ERROR go to an urgent lane which is written ahead of bulk lines at the next
+ * line boundary, so a deep queue doesn't delay PING/PONG. Bulk lines which
+ * haven't started yet are dropped when ERROR is queued: it's the last line
+ * a closing peer gets. It also keeps
+ * the flood clock of the client: every handled line moves it forward by the
+ * line's penalty and lines wait while it runs too far ahead of real time.
+ */
+class Link
+{
+private:
+	int			socket_;
+	std::string	recvq_;		// Received bytes which aren't handled yet
+	std::string	sendq_;		// Queued bytes (complete lines with CRLF)
+	size_t		sent_;		// Bytes of sendq_ already written
+	std::string	urgent_;		// Lines which go ahead of the rest of sendq_
+	size_t		urgent_sent_;	// Bytes of urgent_ already written
+	bool		blocked_;	// Last write hit EAGAIN, wait for select() to report the socket writable
+	bool		server_;	// Registered server link
+	eClass		class_;		// Class whose caps apply to the queues
+	bool		overflow_;	// Went over sendq cap, nothing is queued until it's dropped
+	bool		closing_;	// ERROR is queued, nothing else is
+	unsigned long	flood_clock_;	// When the penalty of handled lines is paid off (microseconds)
+	sockaddr_storage	peer_;		// Address from accept(), AF_UNSPEC for sockets which weren't accepted
+
+public:
+	explicit Link(int socket);
+
+	void		queue				(const char* line, size_t size);
+	void		queue_urgent		(const char* line, size_t size);
+	size_t		queue_closing		(const char* line, size_t size);
+	void		queue				(const struct iovec* parts, size_t count);
+	ssize_t		flush				();
+	void		set_blocked			(bool blocked);
+	void		set_server			(bool server);
+	void		set_class			(eClass link_class);
+	void		set_overflow		(bool overflow);
+	void		penalize			(unsigned long now, unsigned long penalty);
+	void		set_peer			(const sockaddr* address, socklen_t size);
+	std::string&	input			();
+
+	int			socket				() const;
+	size_t		sendq				() const;
+	bool		pending				() const;
+	bool		blocked				() const;
+	bool		server				() const;
+	eClass		link_class			() const;
+	bool		overflow			() const;
+	bool		closing				() const;
+	bool		flooding			(unsigned long now, unsigned long window) const;
+	unsigned long	flood_clock		() const;
+	const sockaddr*	peer			() const;
+	size_t		footprint			() const;
+
+private:
+	size_t		line_end			() const;
+};
+
+#endif //FT_IRC_LINK_HPP
@@ -0,0 +1,126 @@
+
+#include "ListQuery.hpp"
+#include "Channel.hpp"
+#include "utils.hpp"
+
+#include <cstdlib>
+#include <cstdint>
+
+ListQuery::ListQuery()
+	: user(nullptr), source(LS_BY_NAME), min_users(0), max_users(SIZE_MAX),
+	  created_min(0), created_max(0), topic_min(0), topic_max(0),
+	  started(false), next_users(0, nullptr), next_index(0) {}
+
+/**
+ * @description	Reads a number of a filter ("<10", "T>5")
+ * @param		str: digits
+ * @param		number: result
+ * @return		false if str isn't a number
+ */
+static bool	filter_number(const std::string& str, size_t& number)
+{
+	if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos)
+		return false;
+	number = strtoul(str.c_str(), nullptr, 10);
+	return true;
+}
+
+/**
+ * @description	Sets time bounds of "C<m"/"C>m" (created) and "T<m"/"T>m" (topic set)
+ * 				filters: "<m" is less than m minutes ago, ">m" more than m minutes ago
+ */
+static void	time_filter(const std::string& filter, time_t now, time_t& min, time_t& max)
+{
+	size_t minutes;
+	if (filter.size() < 3 || !filter_number(filter.substr(2), minutes))
+		return;
+	time_t edge = now - static_cast<time_t>(minutes) * 60;
+	if (filter[1] == '<')
+		min = edge + 1;
+	else if (filter[1] == '>')
+		max = edge - 1;
+}
+
+/**
+ * @description	Parses LIST first argument: channel names or ELIST filters
+ * 				(">n", "<n", "C<m", "C>m", "T<m", "T>m", "mask", "!mask"),
+ * 				comma separated. Unknown filters are ignored
+ * @param		filters
+ * @param		now: current time
+ */
+void	ListQuery::parse(const std::string& filters, time_t now)
+{
+	size_t start = 0;
+	while (start <= filters.size())
+	{
+		size_t end = filters.find(',', start);
+		if (end == std::string::npos)
+			end = filters.size();
+		std::string	filter = filters.substr(start, end - start);
+		bool		wildcard = filter.find_first_of("*?") != std::string::npos;
+		size_t		number;
+		start = end + 1;
+
+		if (filter.empty())
+			continue;
+		if (filter[0] == '>' && filter_number(filter.substr(1), number))
+			min_users = number + 1;
+		else if (filter[0] == '<' && filter_number(filter.substr(1), number))
+		{
+			if (number == 0)
+				min_users = SIZE_MAX;	// Nothing has less than 0 users
+			else
+				max_users = number - 1;
+		}
+		else if (filter[0] == 'C' && filter.size() > 1 && (filter[1] == '<' || filter[1] == '>'))
+			time_filter(filter, now, created_min, created_max);
+		else if (filter[0] == 'T' && filter.size() > 1 && (filter[1] == '<' || filter[1] == '>'))
+			time_filter(filter, now, topic_min, topic_max);
+		else if (filter[0] == '!' && wildcard)
+			not_masks.push_back(Mask(filter.substr(1)));
+		else if (wildcard)
+			masks.push_back(Mask(filter));
+		else if (filter[0] == '#' || filter[0] == '&' || filter[0] == '+' || filter[0] == '!')
+			names.push_back(filter);
+	}
+	if (!names.empty())
+		source = LS_NAMES;
+	else if (min_users != 0 || max_users != SIZE_MAX)
+		source = LS_BY_USERS;
+}
+
+/**
+ * @description	Checks channel against filters (visibility is checked by caller)
+ * @param		channel
+ * @return		true if channel is listed
+ */
+bool	ListQuery::matches(const Channel* channel) const
+{
+	size_t users = channel->getUsers().size();
+	if (users < min_users || users > max_users)
+		return false;
+	if ((created_min != 0 && channel->getCreationTime() < created_min)
+		|| (created_max != 0 && channel->getCreationTime() > created_max))
+		return false;
+	if (topic_min != 0 || topic_max != 0)
+	{
+		time_t topic_time = channel->getTopicTime();
+		if (topic_time == 0 || (topic_min != 0 && topic_time < topic_min)
+			|| (topic_max != 0 && topic_time > topic_max))
+			return false;
+	}
+	if (!masks.empty())
+	{
+		size_t i = 0;
+		while (i < masks.size() && !masks[i].match(channel->getName()))
+			++i;
+		if (i == masks.size())
+			return false;
+	}
+	for (size_t i = 0; i < not_masks.size(); ++i)
+	{
+		if (not_masks[i].match(channel->getName()))
+			return false;
+	}
+	return true;
+}
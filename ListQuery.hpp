@@ -0,0 +1,56 @@
+
+#ifndef FT_IRC_LISTQUERY_HPP
+#define FT_IRC_LISTQUERY_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <ctime>
+
+#include "Mask.hpp"
+
+#define LIST_SENDQ_LIMIT	16384	// LIST pauses while the client sendq is deeper
+#define LIST_SCAN_BATCH		1024	// Channels examined per page
+
+class Channel;
+class User;
+
+enum eListSource
+{
+	LS_BY_NAME,		// channels_ in name order
+	LS_BY_USERS,	// Member count index (">n", "<n" filters)
+	LS_NAMES		// Exact names: LIST #a,#b
+};
+
+/**
+ * One LIST request: ELIST filters and the point to resume from.
+ * Replies are streamed over several loop iterations, so the resume point
+ * is a key (not an iterator) and survives channels created or removed
+ * meanwhile.
+ */
+struct ListQuery
+{
+	User*						user;
+	eListSource					source;
+	size_t						min_users;		// Inclusive bounds
+	size_t						max_users;
+	time_t						created_min;	// Inclusive bounds, 0 if not set
+	time_t						created_max;
+	time_t						topic_min;
+	time_t						topic_max;
+	std::vector<Mask>			masks;			// Name matches one of them (if any)
+	std::vector<Mask>			not_masks;		// and none of these
+	std::vector<std::string>	names;
+
+	bool						started;
+	std::string					next_name;		// Last key sent by source
+	std::pair<size_t, Channel*>	next_users;
+	size_t						next_index;
+
+	ListQuery();
+
+	void	parse	(const std::string& filters, time_t now);
+	bool	matches	(const Channel* channel) const;
+};
+
+#endif //FT_IRC_LISTQUERY_HPP
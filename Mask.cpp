@@ -0,0 +1,136 @@
+
+#include "Mask.hpp"
+#include "utils.hpp"
+
+Mask::Mask() : literal_(true) {}
+
+Mask::Mask(const std::string& mask) : literal_(true)
+{
+	compile(mask);
+}
+
+/**
+ * @description	Casefolds mask and splits off its literal head and tail
+ * @param		mask
+ */
+void	Mask::compile(const std::string& mask)
+{
+	mask_ = casefold(mask);
+	size_t first = mask_.find_first_of("*?");
+	literal_ = (first == std::string::npos);
+	core_.clear();
+	if (literal_)
+	{
+		prefix_ = mask_;
+		suffix_ = mask_;
+		return;
+	}
+	prefix_ = mask_.substr(0, first);
+	size_t last = mask_.find_last_of("*?");
+	suffix_ = mask_.substr(last + 1);
+	for (size_t start = mask_.find_first_not_of("*?", first); start < last; start = mask_.find_first_not_of("*?", start))
+	{
+		size_t end = mask_.find_first_of("*?", start);
+		if (end - start > core_.size())
+			core_ = mask_.substr(start, end - start);
+		start = end;
+	}
+}
+
+/**
+ * @description	Matches string, the literal head and tail are compared first,
+ * 				only the part between them needs backtracking
+ * @param		str: string as is (not casefolded)
+ * @return		true if str matches
+ */
+bool	Mask::match(const std::string& str) const
+{
+	if (literal_)
+	{
+		if (str.size() != mask_.size())
+			return false;
+		for (size_t i = 0; i < str.size(); ++i)
+		{
+			if (fold_char(str[i]) != mask_[i])
+				return false;
+		}
+		return true;
+	}
+	if (str.size() < prefix_.size() + suffix_.size())
+		return false;
+	for (size_t i = 0; i < prefix_.size(); ++i)
+	{
+		if (fold_char(str[i]) != prefix_[i])
+			return false;
+	}
+	size_t tail = str.size() - suffix_.size();
+	for (size_t i = 0; i < suffix_.size(); ++i)
+	{
+		if (fold_char(str[tail + i]) != suffix_[i])
+			return false;
+	}
+	return glob(str, prefix_.size(), tail, prefix_.size(), mask_.size() - suffix_.size());
+}
+
+/**
+ * @description	Matches string which is already casefolded, the literal middle
+ * 				is looked up first, so most strings are rejected without backtracking
+ * @param		folded: casefold() result
+ * @return		true if str matches
+ */
+bool	Mask::match_folded(const std::string& folded) const
+{
+	if (literal_)
+		return folded == mask_;
+	if (folded.size() < prefix_.size() + suffix_.size()
+		|| folded.compare(0, prefix_.size(), prefix_) != 0
+		|| folded.compare(folded.size() - suffix_.size(), suffix_.size(), suffix_) != 0)
+		return false;
+	size_t tail = folded.size() - suffix_.size();
+	if (!core_.empty())
+	{
+		size_t found = folded.find(core_, prefix_.size());
+		if (found == std::string::npos || found + core_.size() > tail)
+			return false;
+	}
+	return glob(folded, prefix_.size(), tail, prefix_.size(), mask_.size() - suffix_.size());
+}
+
+/**
+ * @description	Matches str[s, s_end) against mask_[m, m_end) with one backtrack point
+ * 				(the last '*'), which is enough for '*' and '?' masks
+ */
+bool	Mask::glob(const std::string& str, size_t s, size_t s_end, size_t m, size_t m_end) const
+{
+	size_t star = std::string::npos;
+	size_t star_s = 0;
+
+	while (s < s_end)
+	{
+		if (m < m_end && (mask_[m] == '?' || mask_[m] == fold_char(str[s])))
+		{
+			++m;
+			++s;
+		}
+		else if (m < m_end && mask_[m] == '*')
+		{
+			star = m++;
+			star_s = s;
+		}
+		else if (star != std::string::npos)
+		{
+			m = star + 1;
+			s = ++star_s;
+		}
+		else
+			return false;
+	}
+	while (m < m_end && mask_[m] == '*')
+		++m;
+	return m == m_end;
+}
+
+const std::string&	Mask::str		() const { return mask_; }
+const std::string&	Mask::prefix	() const { return prefix_; }
+const std::string&	Mask::suffix	() const { return suffix_; }
+bool				Mask::literal	() const { return literal_; }
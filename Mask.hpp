@@ -0,0 +1,38 @@
+
+#ifndef FT_IRC_MASK_HPP
+#define FT_IRC_MASK_HPP
+
+#include <string>
+
+/**
+ * Wildcard mask ('*' any sequence, '?' one char) compiled once and matched
+ * many times, case insensitive (RFC 1459 casemapping). The literal head and
+ * tail are exposed so callers can narrow a search with sorted indexes
+ * before matching.
+ */
+class Mask
+{
+private:
+	std::string	mask_;		// Casefolded
+	std::string	prefix_;	// Literal chars before the first wildcard
+	std::string	suffix_;	// Literal chars after the last wildcard
+	std::string	core_;		// Longest literal run between wildcards
+	bool		literal_;	// No wildcards at all
+
+	bool		glob			(const std::string& str, size_t s, size_t s_end, size_t m, size_t m_end) const;
+
+public:
+	Mask();
+	explicit Mask(const std::string& mask);
+
+	void				compile		(const std::string& mask);
+	bool				match		(const std::string& str) const;
+	bool				match_folded(const std::string& folded) const;
+
+	const std::string&	str			() const;
+	const std::string&	prefix		() const;
+	const std::string&	suffix		() const;
+	bool				literal		() const;
+};
+
+#endif //FT_IRC_MASK_HPP
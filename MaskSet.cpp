@@ -0,0 +1,138 @@
+
+#include "MaskSet.hpp"
+#include "utils.hpp"
+
+/**
+ * @description	Adds mask (use normalize() first for ban-like masks)
+ * @param		mask
+ * @param		setter: nick or server which set it
+ * @param		time: when it was set
+ * @return		false if the same mask (in any case) is already there
+ */
+bool	MaskSet::add(const std::string& mask, const std::string& setter, time_t time)
+{
+	std::string key = casefold(mask);
+	if (entries_.find(key) != entries_.end())
+		return false;
+	MaskEntry& entry = entries_[key];
+	entry.mask.compile(mask);
+	entry.text = mask;
+	entry.setter = setter;
+	entry.time = time;
+
+	const std::string& prefix = entry.mask.prefix();
+	const std::string& suffix = entry.mask.suffix();
+	if (suffix.size() > prefix.size())
+	{
+		std::string reversed(suffix.rbegin(), suffix.rend());
+		suffixes_.insert(std::make_pair(reversed, &entry));
+		++suffix_lengths_[reversed.size()];
+	}
+	else
+	{
+		prefixes_.insert(std::make_pair(prefix, &entry));
+		++prefix_lengths_[prefix.size()];
+	}
+	return true;
+}
+
+/**
+ * @description	Removes mask
+ * @param		mask
+ * @return		false if there was no such mask
+ */
+bool	MaskSet::remove(const std::string& mask)
+{
+	std::map<std::string, MaskEntry>::iterator itr = entries_.find(casefold(mask));
+	if (itr == entries_.end())
+		return false;
+	const std::string& prefix = itr->second.mask.prefix();
+	const std::string& suffix = itr->second.mask.suffix();
+	if (suffix.size() > prefix.size())
+		unindex(suffixes_, suffix_lengths_, std::string(suffix.rbegin(), suffix.rend()), &itr->second);
+	else
+		unindex(prefixes_, prefix_lengths_, prefix, &itr->second);
+	entries_.erase(itr);
+	return true;
+}
+
+void	MaskSet::unindex(Index& index, std::map<size_t, size_t>& lengths, const std::string& key, const MaskEntry* entry)
+{
+	std::pair<Index::iterator, Index::iterator> range = index.equal_range(key);
+	for (Index::iterator itr = range.first; itr != range.second; ++itr)
+	{
+		if (itr->second == entry)
+		{
+			index.erase(itr);
+			break;
+		}
+	}
+	if (--lengths[key.size()] == 0)
+		lengths.erase(key.size());
+}
+
+/**
+ * @description	Looks for entries stored under every head (or reversed tail) of key
+ * @param		index
+ * @param		lengths: key lengths present in index
+ * @param		str: casefolded string to match
+ * @param		key: str itself or reversed
+ * @return		first matching entry or nullptr
+ */
+const MaskEntry*	MaskSet::probe(const Index& index, const std::map<size_t, size_t>& lengths,
+								   const std::string& str, const std::string& key)
+{
+	for (std::map<size_t, size_t>::const_iterator len = lengths.begin(); len != lengths.end(); ++len)
+	{
+		if (len->first > key.size())
+			break;
+		std::pair<Index::const_iterator, Index::const_iterator> range = index.equal_range(key.substr(0, len->first));
+		for (Index::const_iterator itr = range.first; itr != range.second; ++itr)
+		{
+			if (itr->second->mask.match_folded(str))
+				return itr->second;
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * @description	Finds a mask matching str
+ * @param		str: usually nick!user@host
+ * @return		matching entry or nullptr
+ */
+const MaskEntry*	MaskSet::find(const std::string& str) const
+{
+	if (entries_.empty())
+		return nullptr;
+	std::string folded = casefold(str);
+	const MaskEntry* entry = probe(prefixes_, prefix_lengths_, folded, folded);
+	if (entry == nullptr && !suffixes_.empty())
+		entry = probe(suffixes_, suffix_lengths_, folded, std::string(folded.rbegin(), folded.rend()));
+	return entry;
+}
+
+bool	MaskSet::match(const std::string& str) const { return find(str) != nullptr; }
+
+size_t									MaskSet::size	() const { return entries_.size(); }
+const std::map<std::string, MaskEntry>&	MaskSet::entries() const { return entries_; }
+
+/**
+ * @description	Completes mask to nick!user@host form: "nick" becomes "nick!*@*",
+ * 				"user@host" becomes "*!user@host", "nick!user" becomes "nick!user@*"
+ * @param		mask
+ * @return		full mask
+ */
+std::string	MaskSet::normalize(const std::string& mask)
+{
+	size_t	bang	= mask.find('!');
+	size_t	at		= mask.find('@');
+
+	if (bang == std::string::npos && at == std::string::npos)
+		return mask + "!*@*";
+	if (bang == std::string::npos)
+		return "*!" + mask;
+	if (at == std::string::npos)
+		return mask + "@*";
+	return mask;
+}
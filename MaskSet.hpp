@@ -0,0 +1,55 @@
+
+#ifndef FT_IRC_MASKSET_HPP
+#define FT_IRC_MASKSET_HPP
+
+#include "Mask.hpp"
+
+#include <ctime>
+#include <map>
+#include <string>
+
+#define MASK_LIST_MAX	1000	// Entries of one channel list (+b, +e or +I)
+
+struct MaskEntry
+{
+	Mask		mask;
+	std::string	text;		// As it was set
+	std::string	setter;
+	time_t		time;
+};
+
+/**
+ * Set of nick!user@host masks. Every mask is indexed by its longest literal
+ * part: the head in prefixes_, or the reversed tail in suffixes_. A lookup
+ * probes one key per distinct literal length and matches only the entries
+ * stored under it, so most masks are never tried against a string.
+ */
+class MaskSet
+{
+private:
+	typedef std::multimap<std::string, const MaskEntry*>	Index;
+
+	std::map<std::string, MaskEntry>	entries_;			// By casefolded mask
+	Index								prefixes_;			// By literal head ("" for "*" masks)
+	Index								suffixes_;			// By reversed literal tail
+	std::map<size_t, size_t>			prefix_lengths_;	// Key length -> entries with it
+	std::map<size_t, size_t>			suffix_lengths_;
+
+	static const MaskEntry*	probe		(const Index& index, const std::map<size_t, size_t>& lengths,
+										 const std::string& str, const std::string& key);
+	static void				unindex		(Index& index, std::map<size_t, size_t>& lengths,
+										 const std::string& key, const MaskEntry* entry);
+
+public:
+	bool					add			(const std::string& mask, const std::string& setter, time_t time);
+	bool					remove		(const std::string& mask);
+	const MaskEntry*		find		(const std::string& str) const;
+	bool					match		(const std::string& str) const;
+
+	size_t									size	() const;
+	const std::map<std::string, MaskEntry>&	entries	() const;
+
+	static std::string		normalize	(const std::string& mask);
+};
+
+#endif //FT_IRC_MASKSET_HPP
@@ -0,0 +1,66 @@
+
+#include "Motd.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+Motd::Motd() : lines_(0), loaded_(false) {}
+
+/**
+ * @description	Reads MOTD file and renders the reply block for domain. Lines
+ * 				are cut to fit 512 bytes with the longest allowed nick
+ * @param		path: text file, one MOTD line per line
+ * @param		domain: server name of the replies
+ * @return		false if the file can't be read (the MOTD is empty then)
+ */
+bool	Motd::load(const std::string& path, const std::string& domain)
+{
+	std::ifstream	file(path.c_str());
+	std::string		head = ":" + domain + " ";
+	std::string		text;
+
+	segments_.clear();
+	path_ = path;
+	lines_ = 0;
+	loaded_ = file.is_open();
+	if (!loaded_)
+		return false;
+
+	// ":<domain> 372 <nick> :- <text>\r\n"
+	size_t width = IRC_LINE_MAX - std::min<size_t>(head.size() + NICK_MAX_LEN + 10, IRC_LINE_MAX);
+	segments_.push_back(head + "375 ");
+	std::string segment = " :- " + domain + " Message of the day - \r\n";
+	while (std::getline(file, text))
+	{
+		if (!text.empty() && text[text.size() - 1] == '\r')
+			text.erase(text.size() - 1);
+		if (text.size() > width)
+			text.erase(width);
+		segment.append(head).append("372 ");
+		segments_.push_back(segment);
+		segment = " :- " + text + "\r\n";
+		++lines_;
+	}
+	segment.append(head).append("376 ");
+	segments_.push_back(segment);
+	segments_.push_back(" :End of /MOTD command\r\n");
+	return true;
+}
+
+const std::vector<std::string>&	Motd::segments	() const { return segments_; }
+const std::string&				Motd::path		() const { return path_; }
+size_t							Motd::lines		() const { return lines_; }
+bool							Motd::loaded	() const { return loaded_; }
+
+/**
+ * @description	Bytes of the block sent to nick
+ * @param		nick_size: length of the receiver nick
+ */
+size_t	Motd::size(size_t nick_size) const
+{
+	size_t bytes = (segments_.empty()) ? 0 : nick_size * (segments_.size() - 1);
+	for (size_t i = 0; i < segments_.size(); ++i)
+		bytes += segments_[i].size();
+	return bytes;
+}
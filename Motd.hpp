@@ -0,0 +1,36 @@
+
+#ifndef FT_IRC_MOTD_HPP
+#define FT_IRC_MOTD_HPP
+
+#include <string>
+#include <vector>
+
+#define MOTD_DEFAULT_FILE	"motd.txt"
+
+/**
+ * Message of the day rendered once into wire-ready replies (375, 372 lines
+ * and 376). The block is kept split at the receiver nick, so sending it only
+ * interleaves segments with the nick: nothing is formatted per receiver and
+ * the whole block is queued at once. Loaded at start and on REHASH.
+ */
+class Motd
+{
+private:
+	std::vector<std::string>	segments_;	// Block parts, the receiver nick goes between each two
+	std::string					path_;
+	size_t						lines_;		// Text lines of the file
+	bool						loaded_;
+
+public:
+	Motd();
+
+	bool	load		(const std::string& path, const std::string& domain);
+
+	const std::vector<std::string>&	segments	() const;
+	const std::string&				path		() const;
+	size_t							lines		() const;
+	bool							loaded		() const;
+	size_t							size		(size_t nick_size) const;
+};
+
+#endif //FT_IRC_MOTD_HPP
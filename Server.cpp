@@ -1,6 +1,15 @@
 
 #include "Server.hpp"
 
+SlabPool&	Server::pool()
+{
+	static SlabPool* pool = new SlabPool("Server", sizeof(Server));
+	return *pool;
+}
+
+void*	Server::operator new	(size_t size)				{ return pool().allocate(size); }
+void	Server::operator delete	(void* ptr, size_t size)	{ pool().release(ptr, size); }
+
 Server::Server(std::string name, int socket, int hopcount, int token, int source_socket)
 		: AConnection(socket, T_SERVER, hopcount, source_socket, token)
 {
@@ -13,6 +22,6 @@ Server::~Server() {}
 
 Server::Server(const Server &server) : AConnection(-1, T_SERVER, -1, U_EXTERNAL_CONNECTION, 0) { (void)server; }
 
-const std::string& Server::name()	{ return name_; }
+const std::string& Server::name()	{ return name_.str(); }
 
 Server& Server::operator=(const Server &rh) { (void)rh; return *this; }
\ No newline at end of file
@@ -3,6 +3,8 @@
 #define FT_IRC_SERVER_HPP
 
 #include "AConnection.hpp"
+#include "Atom.hpp"
+#include "SlabPool.hpp"
 #include "utils.hpp"
 #include <string>
 
@@ -14,8 +16,12 @@ public:
 
 	const std::string&	name();
 
+	static SlabPool&	pool			();
+	static void*		operator new	(size_t size);
+	static void			operator delete	(void* ptr, size_t size);
+
 private:
-	std::string name_;
+	Atom		name_;
 
 
 	Server();
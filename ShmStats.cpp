@@ -0,0 +1,100 @@
+
+#include "ShmStats.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <stdexcept>
+
+ShmStats::ShmStats() : segment_(nullptr) {}
+
+ShmStats::~ShmStats()
+{
+	close();
+}
+
+/**
+ * @description	Creates (or reuses) segment and maps it
+ * @param		name: POSIX shm name, e.g. "/irisha"
+ */
+void	ShmStats::open(const std::string& name)
+{
+	close();
+	int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+	if (fd == -1)
+		throw std::runtime_error("Can't open stats shared memory " + name);
+	if (ftruncate(fd, sizeof(ShmSegment)) == -1)
+	{
+		::close(fd);
+		throw std::runtime_error("Can't resize stats shared memory " + name);
+	}
+	void* memory = mmap(nullptr, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (memory == MAP_FAILED)
+		throw std::runtime_error("Can't map stats shared memory " + name);
+	name_ = name;
+	segment_ = static_cast<ShmSegment*>(memory);
+	memset(segment_, 0, sizeof(ShmSegment));
+	segment_->version = SHM_STATS_VERSION;
+	segment_->pid = getpid();
+	__atomic_store_n(&segment_->magic, SHM_STATS_MAGIC, __ATOMIC_RELEASE);
+}
+
+/**
+ * @description	Unmaps and removes segment
+ */
+void	ShmStats::close()
+{
+	if (segment_ == nullptr)
+		return;
+	munmap(segment_, sizeof(ShmSegment));
+	shm_unlink(name_.c_str());
+	segment_ = nullptr;
+}
+
+bool	ShmStats::active() const { return segment_ != nullptr; }
+
+/**
+ * @description	Marks snapshot as being written (seq becomes odd)
+ * @return		segment to fill
+ */
+ShmSegment*	ShmStats::begin_write()
+{
+	__atomic_store_n(&segment_->seq, segment_->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	return segment_;
+}
+
+/**
+ * @description	Publishes snapshot (seq becomes even)
+ */
+void	ShmStats::end_write()
+{
+	__atomic_store_n(&segment_->seq, segment_->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @description	Copies a consistent snapshot of the segment (reader side)
+ * @param		shared: mapped segment
+ * @param		snapshot: copy
+ * @return		false if the writer kept it busy for too long or the segment isn't initialized
+ */
+bool	ShmStats::read(const ShmSegment* shared, ShmSegment& snapshot)
+{
+	if (__atomic_load_n(&shared->magic, __ATOMIC_ACQUIRE) != SHM_STATS_MAGIC)
+		return false;
+	for (int attempt = 0; attempt < 1000; ++attempt)
+	{
+		uint32_t before = __atomic_load_n(&shared->seq, __ATOMIC_ACQUIRE);
+		if (before & 1U)
+			continue;
+		memcpy(&snapshot, shared, sizeof(ShmSegment));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&shared->seq, __ATOMIC_RELAXED) == before)
+			return snapshot.version == SHM_STATS_VERSION;
+	}
+	return false;
+}
@@ -0,0 +1,85 @@
+
+#ifndef FT_IRC_SHMSTATS_HPP
+#define FT_IRC_SHMSTATS_HPP
+
+#include <string>
+#include <stdint.h>
+
+#define SHM_STATS_MAGIC		0x49524953U	// "IRIS"
+#define SHM_STATS_VERSION	1U
+#define SHM_STATS_LINKS		32			// Deepest send queues published
+#define SHM_PUBLISH_USEC	10000		// Snapshots are written at most 100 times per second
+
+struct ShmLink
+{
+	int32_t		socket;
+	uint32_t	server;			// 1 for server links
+	uint64_t	sendq;			// Bytes waiting in the output queue
+};
+
+/**
+ * Layout of the shared memory segment. The server is the only writer:
+ * seq is odd while a snapshot is being written, so readers copy the
+ * segment and retry when seq was odd or changed during the copy.
+ */
+struct ShmSegment
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	seq;
+	int32_t		pid;
+	uint64_t	updated_usec;		// Monotonic time of the last snapshot
+	int64_t		start_time;			// Launch time since epoch
+
+	uint64_t	local_clients;
+	uint64_t	remote_clients;
+	uint64_t	local_servers;
+	uint64_t	remote_servers;
+	uint64_t	unregistered;
+	uint64_t	channels;
+
+	uint64_t	messages_in;		// Counters, readers compute rates
+	uint64_t	messages_out;
+	uint64_t	bytes_in;
+	uint64_t	bytes_out;
+	uint64_t	sendq_bytes;
+
+	uint64_t	loop_iterations;
+	uint64_t	loop_p50_usec;		// Iteration time without select() wait
+	uint64_t	loop_p99_usec;
+	uint64_t	loop_max_usec;
+	uint64_t	loop_last_usec;
+	uint64_t	budget_overruns;
+
+	uint32_t	link_total;			// All local sockets
+	uint32_t	link_count;			// Entries used in links
+	ShmLink		links[SHM_STATS_LINKS];
+};
+
+/**
+ * Writer side of the stats segment (POSIX shm_open + mmap)
+ */
+class ShmStats
+{
+private:
+	std::string	name_;
+	ShmSegment*	segment_;
+
+	ShmStats	(const ShmStats& other);
+	ShmStats&	operator=	(const ShmStats& other);
+
+public:
+	ShmStats();
+	~ShmStats();
+
+	void			open			(const std::string& name);
+	void			close			();
+	bool			active			() const;
+
+	ShmSegment*		begin_write		();
+	void			end_write		();
+
+	static bool		read			(const ShmSegment* shared, ShmSegment& snapshot);
+};
+
+#endif //FT_IRC_SHMSTATS_HPP
@@ -0,0 +1,96 @@
+
+#include "SlabPool.hpp"
+
+#include <new>
+
+static std::vector<SlabPool*>& registry()
+{
+	static std::vector<SlabPool*>* pools = new std::vector<SlabPool*>;	// Lives as long as the pools
+	return *pools;
+}
+
+/**
+ * @description	Creates an empty pool and lists it for STATS z
+ * @param		name: type name for statistics
+ * @param		object_size: sizeof the type
+ */
+SlabPool::SlabPool(const std::string& name, size_t object_size)
+	: name_(name), free_(nullptr), used_(0), peak_(0), allocations_(0)
+{
+	const size_t align = alignof(std::max_align_t);
+	if (object_size < sizeof(Slot))
+		object_size = sizeof(Slot);
+	object_size_ = (object_size + align - 1) / align * align;
+	registry().push_back(this);
+}
+
+void	SlabPool::grow()
+{
+	char* slab = static_cast<char*>(::operator new(object_size_ * SLAB_OBJECTS));
+	slabs_.push_back(slab);
+	for (size_t i = SLAB_OBJECTS; i > 0; --i)	// The first object of the slab is given first
+	{
+		Slot* slot = reinterpret_cast<Slot*>(slab + (i - 1) * object_size_);
+		slot->next = free_;
+		free_ = slot;
+	}
+}
+
+/**
+ * @description	Takes an object from the free list (a new slab when it's empty)
+ * @param		size: requested size
+ * @return		memory for one object
+ */
+void*	SlabPool::allocate(size_t size)
+{
+	if (size > object_size_)
+		return ::operator new(size);
+	if (free_ == nullptr)
+		grow();
+	Slot* slot = free_;
+	free_ = slot->next;
+	++allocations_;
+	if (++used_ > peak_)
+		peak_ = used_;
+	return slot;
+}
+
+/**
+ * @description	Puts object memory back to the free list
+ * @param		ptr: memory from allocate()
+ * @param		size: the same size as was requested
+ */
+void	SlabPool::release(void* ptr, size_t size)
+{
+	if (ptr == nullptr)
+		return;
+	if (size > object_size_)
+	{
+		::operator delete(ptr);
+		return;
+	}
+	Slot* slot = static_cast<Slot*>(ptr);
+	slot->next = free_;
+	free_ = slot;
+	--used_;
+}
+
+/**
+ * @description	Preallocates slabs for objects, so the first burst doesn't wait for the heap
+ * @param		objects: capacity to have at least
+ */
+void	SlabPool::reserve(size_t objects)
+{
+	while (capacity() < objects)
+		grow();
+}
+
+const std::string&	SlabPool::name			() const { return name_; }
+size_t				SlabPool::object_size	() const { return object_size_; }
+size_t				SlabPool::used			() const { return used_; }
+size_t				SlabPool::capacity		() const { return slabs_.size() * SLAB_OBJECTS; }
+size_t				SlabPool::peak			() const { return peak_; }
+size_t				SlabPool::slabs			() const { return slabs_.size(); }
+unsigned long		SlabPool::allocations	() const { return allocations_; }
+
+const std::vector<SlabPool*>&	SlabPool::pools() { return registry(); }
@@ -0,0 +1,58 @@
+
+#ifndef FT_IRC_SLABPOOL_HPP
+#define FT_IRC_SLABPOOL_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#define SLAB_OBJECTS	64		// Objects carved from one slab
+
+/**
+ * Allocator of fixed size objects for one type. Memory is taken from the heap
+ * in slabs of SLAB_OBJECTS objects and freed objects go to a free list, so a
+ * reconnect storm or a netburst reuses the same slabs instead of fragmenting
+ * the heap. Slabs are never given back: RSS stays at the peak, flat through
+ * churn. Requests of another size (a derived class) go to the heap.
+ */
+class SlabPool
+{
+private:
+	struct Slot
+	{
+		Slot*	next;
+	};
+
+	std::string			name_;
+	size_t				object_size_;	// Rounded up to the alignment of operator new
+	std::vector<char*>	slabs_;
+	Slot*				free_;
+	size_t				used_;
+	size_t				peak_;
+	unsigned long		allocations_;
+
+	void	grow	();
+
+	/// Unused constructors
+	SlabPool(const SlabPool& other);
+	SlabPool& operator=(const SlabPool& other);
+
+public:
+	SlabPool(const std::string& name, size_t object_size);
+
+	void*	allocate	(size_t size);
+	void	release		(void* ptr, size_t size);
+	void	reserve		(size_t objects);
+
+	const std::string&	name		() const;
+	size_t				object_size	() const;
+	size_t				used		() const;
+	size_t				capacity	() const;
+	size_t				peak		() const;
+	size_t				slabs		() const;
+	unsigned long		allocations	() const;
+
+	static const std::vector<SlabPool*>&	pools	();
+};
+
+#endif //FT_IRC_SLABPOOL_HPP
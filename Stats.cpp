@@ -0,0 +1,128 @@
+
+#include "Stats.hpp"
+#include "utils.hpp"
+
+#include <cstring>
+
+Histogram::Histogram()
+{
+	reset();
+}
+
+/**
+ * @description	Finds bucket of value: values below SUB_COUNT have own buckets,
+ * 				bigger ones keep SUB_BITS bits after the most significant one
+ * @param		value
+ * @return		bucket index
+ */
+unsigned	Histogram::bucket_index(unsigned long value)
+{
+	if (value < SUB_COUNT)
+		return static_cast<unsigned>(value);
+	unsigned msb = static_cast<unsigned>(sizeof(unsigned long) * 8 - 1 - __builtin_clzl(value));
+	unsigned shift = msb - SUB_BITS;
+	return (shift + 1) * SUB_COUNT + static_cast<unsigned>((value >> shift) - SUB_COUNT);
+}
+
+/**
+ * @description	Returns the highest value that falls into bucket
+ * @param		index: bucket index
+ */
+unsigned long	Histogram::bucket_value(unsigned index)
+{
+	if (index < SUB_COUNT)
+		return index;
+	unsigned		shift = index / SUB_COUNT - 1;
+	unsigned long	sub = index % SUB_COUNT + SUB_COUNT;
+	return ((sub + 1) << shift) - 1;
+}
+
+void	Histogram::record(unsigned long value)
+{
+	if (value > 0xFFFFFFFFUL)
+		value = 0xFFFFFFFFUL;
+	++buckets_[bucket_index(value)];
+	++count_;
+	sum_ += static_cast<double>(value);
+	if (value > max_)
+		max_ = value;
+}
+
+void	Histogram::reset()
+{
+	memset(buckets_, 0, sizeof(buckets_));
+	count_ = 0;
+	max_ = 0;
+	sum_ = 0;
+}
+
+unsigned long	Histogram::count() const { return count_; }
+unsigned long	Histogram::max() const { return max_; }
+double			Histogram::sum() const { return sum_; }
+
+double	Histogram::mean() const
+{
+	if (count_ == 0)
+		return 0;
+	return sum_ / static_cast<double>(count_);
+}
+
+/**
+ * @description	Returns value below which percent of recorded values fall
+ * @param		percent: 0..100
+ * @return		upper bound of the bucket (never above max), 0 if nothing was recorded
+ */
+unsigned long	Histogram::percentile(double percent) const
+{
+	if (count_ == 0)
+		return 0;
+	unsigned long rank = static_cast<unsigned long>(percent / 100.0 * static_cast<double>(count_) + 0.5);
+	if (rank < 1)
+		rank = 1;
+	if (rank > count_)
+		rank = count_;
+	unsigned long seen = 0;
+	for (unsigned i = 0; i < BUCKETS; ++i)
+	{
+		seen += buckets_[i];
+		if (seen >= rank)
+			return (bucket_value(i) < max_) ? bucket_value(i) : max_;
+	}
+	return max_;
+}
+
+/**
+ * @description	Formats percentiles for STATS replies
+ * @return		"p50 <value> p99 <value> max <value>"
+ */
+std::string	Histogram::summary() const
+{
+	return "p50 " + ulong_to_str(percentile(50)) + " p99 " + ulong_to_str(percentile(99)) + " max " + ulong_to_str(max_);
+}
+
+CommandStats::CommandStats() : count(0), remote_count(0), bytes_in(0), bytes_out(0) {}
+
+/**
+ * @description	Records one handler call
+ * @param		usec: handler time
+ * @param		in: command line size
+ * @param		out: bytes queued by the handler
+ * @param		remote: command came from a server
+ */
+void	CommandStats::record(unsigned long usec, size_t in, size_t out, bool remote)
+{
+	++count;
+	if (remote)
+		++remote_count;
+	bytes_in += in;
+	bytes_out += out;
+	latency.record(usec);
+}
+
+ServerCounters::ServerCounters() : local_clients(0), remote_clients(0), local_servers(0), remote_servers(0), operators(0),
+								  accepted(0), rejected(0), throttled(0), evicted(0), deferred(0), sendq_exceeded(0), recvq_exceeded(0),
+								  messages_in(0), messages_out(0), bytes_in(0), bytes_out(0), sendq_bytes(0),
+								  metrics_failed(0) {}
+
+LoopStats::LoopStats() : iterations(0), wakeups(0), select_usec(0), timer_usec(0), io_usec(0), handler_usec(0),
+						flush_usec(0), budget_overruns(0), last_ready(0), last_lines(0), last_usec(0) {}
@@ -0,0 +1,113 @@
+
+#ifndef FT_IRC_STATS_HPP
+#define FT_IRC_STATS_HPP
+
+#include <string>
+
+/**
+ * Log-linear (HDR-style) histogram of non-negative values, usually microseconds.
+ * Every power of two is split into SUB_COUNT equal buckets, so a reported
+ * value is at most 1/SUB_COUNT above the recorded one. Recording is O(1)
+ * and never allocates.
+ */
+class Histogram
+{
+public:
+	static const unsigned	SUB_BITS	= 4;
+	static const unsigned	SUB_COUNT	= 1U << SUB_BITS;
+	static const unsigned	MAX_BITS	= 32;									// Values are clamped to 2^32 - 1
+	static const unsigned	BUCKETS		= (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+private:
+	unsigned int	buckets_[BUCKETS];
+	unsigned long	count_;
+	unsigned long	max_;
+	double			sum_;
+
+	static unsigned			bucket_index	(unsigned long value);
+	static unsigned long	bucket_value	(unsigned index);
+
+public:
+	Histogram();
+
+	void			record			(unsigned long value);
+	void			reset			();
+
+	unsigned long	count			() const;
+	unsigned long	max				() const;
+	double			mean			() const;
+	double			sum				() const;
+	unsigned long	percentile		(double percent) const;
+	std::string		summary			() const;
+};
+
+/**
+ * Counters of one IRC command, updated by Irisha::handle_command
+ */
+struct CommandStats
+{
+	unsigned long	count;			// Calls
+	unsigned long	remote_count;	// Calls received from servers
+	unsigned long	bytes_in;		// Command lines with CRLF
+	unsigned long	bytes_out;		// Everything queued while the handler ran
+	Histogram		latency;		// Handler time in microseconds
+
+	CommandStats();
+
+	void	record	(unsigned long usec, size_t in, size_t out, bool remote);
+};
+
+/**
+ * Gauges and counters of the whole server, updated on every change so that
+ * reading them (metrics endpoint, LUSERS) never walks connections_
+ */
+struct ServerCounters
+{
+	unsigned long	local_clients;
+	unsigned long	remote_clients;
+	unsigned long	local_servers;
+	unsigned long	remote_servers;
+	unsigned long	operators;			// Users with User::is_operator()
+	unsigned long	accepted;			// Accepted sockets since launch
+	unsigned long	rejected;			// Sockets closed right after accept() (Z-lines)
+	unsigned long	throttled;			// Sockets closed by per-address limits (max-per-ip, accept-rate)
+	unsigned long	evicted;			// Unregistered connections dropped for newer ones (max-unregistered)
+	unsigned long	deferred;			// Times flood control held back lines of a client
+	unsigned long	sendq_exceeded;		// Connections closed for going over their sendq cap
+	unsigned long	recvq_exceeded;		// Connections closed for going over their recvq cap
+	unsigned long	messages_in;		// Lines received
+	unsigned long	messages_out;		// Lines queued
+	unsigned long	bytes_in;			// Bytes received
+	unsigned long	bytes_out;			// Bytes queued
+	unsigned long	sendq_bytes;		// Bytes waiting in all output queues
+	unsigned long	metrics_failed;		// Metrics responses cut short by a failed write
+
+	ServerCounters();
+};
+
+/**
+ * Health of the event loop, updated by Irisha::run_once. Durations are in
+ * microseconds, totals are summed since launch.
+ */
+struct LoopStats
+{
+	unsigned long	iterations;
+	unsigned long	wakeups;			// Iterations with ready sockets
+	unsigned long	select_usec;		// Waiting in select()
+	unsigned long	timer_usec;			// Registration timeouts and ping scans
+	unsigned long	io_usec;			// Accepting, reading and parsing (without handlers)
+	unsigned long	handler_usec;		// Command handlers
+	unsigned long	flush_usec;			// Writing output queues
+	unsigned long	budget_overruns;	// Handler calls longer than the budget
+	unsigned long	last_ready;			// Gauges of the last iteration
+	unsigned long	last_lines;
+	unsigned long	last_usec;
+	Histogram		iteration;			// Iteration time without select() wait
+	Histogram		ready;				// Ready sockets per wakeup
+	Histogram		lines;				// Lines handled per wakeup
+	Histogram		timers;				// Timer scan time
+
+	LoopStats();
+};
+
+#endif //FT_IRC_STATS_HPP
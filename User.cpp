@@ -1,6 +1,15 @@
 
 #include "User.hpp"
 
+SlabPool&	User::pool()
+{
+	static SlabPool* pool = new SlabPool("User", sizeof(User));	// Never destroyed: users may outlive statics
+	return *pool;
+}
+
+void*	User::operator new		(size_t size)				{ return pool().allocate(size); }
+void	User::operator delete	(void* ptr, size_t size)	{ pool().release(ptr, size); }
+
 /**
  * @description	Default User constructor
  * @param		sock
@@ -9,45 +18,96 @@
  * @param		mode
  * @param		real_name
  */
-User::User(const int sock, const std::string& server, const std::string& nick)
-		: AConnection(sock, T_CLIENT, 0, sock, 1), nick_(nick), operator_(false), server_(server)
+User::User(const int sock, const std::string& server, const std::string& nick, const std::string& host)
+		: AConnection(sock, T_CLIENT, 0, sock, 1), nick_(nick), host_(host), modes_(0), mode_(0), operator_(false),
+		  server_(server)
 {
-	host_ = std::string(get_sock_host(sock));
-
+	update_prefix();
 }
 
 User::User(const int sock, const std::string& host, const int hopcount, const int source_sock, int token)
-		: AConnection(sock, T_CLIENT, hopcount, source_sock, token), operator_(false), host_(host)
+		: AConnection(sock, T_CLIENT, hopcount, source_sock, token), host_(host), modes_(0), mode_(0), operator_(false)
 {
-
+	update_prefix();
 }
 
 User::~User() {}
 
-void	User::set_nick		(const std::string& nick)		{ nick_ = nick; }
-void	User::set_username	(const std::string& username)	{ username_ = username; }
+void	User::set_nick		(const std::string& nick)		{ nick_ = nick; update_prefix(); }
+void	User::set_username	(const std::string& username)	{ username_ = username; update_prefix(); }
 void	User::set_realname (const std::string& realname)	{ realname_ = realname; }
-void	User::set_password	(const std::string& password)	{ password_ = password; }
 void	User::set_mode		(const int mode)				{ mode_ = mode; }
 void	User::set_operator	(bool is_operator)				{ operator_ = is_operator; }
-void	User::set_netwideID	(const std::string& netwideID)	{ netwideID_ = netwideID; }
-void    User::set_mode_str  (char mode)                     { mode_str_.push_back(mode ); }
-void    User::set_mode_str(const std::string &mode_str)     { mode_str_ = mode_str; }
-void    User::del_mode_str  (char mode)                     { mode_str_.erase(mode_str_.find(mode)); }
-
-const std::string&	User::nick			() const { return nick_; }
-const std::string&	User::username		() const { return username_; }
-const std::string&	User::realname		() const { return realname_; }
-const std::string&	User::password		() const { return password_; }
+void    User::set_mode_str  (char mode)                     { modes_ |= mode_bit(mode); }
+void    User::del_mode_str  (char mode)                     { modes_ &= ~mode_bit(mode); }
+
+void    User::set_mode_str(const std::string &mode_str)
+{
+	modes_ = 0;
+	for (size_t i = 0; i < mode_str.size(); ++i)
+		modes_ |= mode_bit(mode_str[i]);
+}
+
+/**
+ * @description	Bit of mode letter in modes_
+ * @param		mode: letter
+ * @return		bit, 0 for anything but a letter
+ */
+uint64_t	User::mode_bit(char mode)
+{
+	if (mode >= 'a' && mode <= 'z')
+		return 1ULL << (mode - 'a');
+	if (mode >= 'A' && mode <= 'Z')
+		return 1ULL << (26 + mode - 'A');
+	return 0;
+}
+
+const std::string&	User::nick			() const { return nick_.str(); }
+const std::string&	User::username		() const { return username_.str(); }
+const std::string&	User::realname		() const { return realname_.str(); }
 int					User::mode			() const { return mode_; }
 bool 				User::is_operator	() const { return operator_; }
-const std::string&	User::netwideID		() const { return netwideID_; }
-const std::string&	User::server		() const { return server_; }
-const std::string&	User::host			() const { return host_; }
-const std::string&	User::mode_str		() const {return mode_str_; }
+const std::string&	User::server		() const { return server_.str(); }
+const std::string&	User::host			() const { return host_.str(); }
+bool				User::has_mode		(char mode) const { return (modes_ & mode_bit(mode)) != 0; }
+std::string			User::prefix		() const { return wire_prefix_.substr(1, wire_prefix_.size() - 2); }
+const std::string&	User::wire_prefix	() const { return wire_prefix_; }
 
-void User::set_channel(const std::string &channel) {
-	std::vector<std::string>::iterator itr = channels_.begin();
+/**
+ * @description	Rebuilds the wire prefix after nick or user name change
+ */
+void	User::update_prefix()
+{
+	const std::string&	nick		= nick_.str();
+	const std::string&	username	= username_.str();
+	const std::string&	host		= host_.str();
+
+	wire_prefix_.clear();
+	wire_prefix_.reserve(nick.size() + username.size() + host.size() + 4);
+	wire_prefix_.append(":").append(nick).append("!").append(username).append("@").append(host).append(" ");
+}
+
+/**
+ * @description	Mode letters in alphabetical order, lowercase first
+ */
+std::string			User::mode_str		() const
+{
+	std::string	letters;
+	for (char mode = 'a'; mode <= 'z'; ++mode)
+	{
+		if (has_mode(mode))
+			letters.push_back(mode);
+	}
+	for (char mode = 'A'; mode <= 'Z'; ++mode)
+	{
+		if (has_mode(mode))
+			letters.push_back(mode);
+	}
+	return letters;
+}
+
+void User::set_channel(const Atom &channel) {
+	std::vector<Atom>::iterator itr = channels_.begin();
 
 	while (itr != channels_.end())
 	{
@@ -58,8 +118,8 @@ void User::set_channel(const std::string &channel) {
 	channels_.push_back(channel);
 }
 
-void User::del_channel(const std::string &channel) {
-	std::vector<std::string>::iterator itr = channels_.begin();
+void User::del_channel(const Atom &channel) {
+	std::vector<Atom>::iterator itr = channels_.begin();
 
 	while (itr != channels_.end())
 	{
@@ -71,6 +131,18 @@ void User::del_channel(const std::string &channel) {
 	}
 }
 
-std::vector<std::string>& User::channels() {
+/**
+ * @description	Memory held by the user alone: the object, its prefix and channel list
+ * 				(names are interned and shared, so they aren't counted)
+ * @return		bytes
+ */
+size_t	User::footprint() const
+{
+	std::string	empty;
+	size_t		prefix = (wire_prefix_.capacity() > empty.capacity()) ? wire_prefix_.capacity() + 1 : 0;
+	return sizeof(User) + prefix + channels_.capacity() * sizeof(Atom);
+}
+
+std::vector<Atom>& User::channels() {
 	return channels_;
 }
@@ -3,24 +3,39 @@
 #define FT_IRC_USER_HPP
 
 #include "AConnection.hpp"
+#include "Atom.hpp"
+#include "SlabPool.hpp"
 #include "utils.hpp"
+#include <stdint.h>
 #include <string>
 #include <vector>
 
+/**
+ * Network user, local or remote. Fields read for every message and WHO/NAMES
+ * line come first, so they share a cache line with the connection header;
+ * registration and WHOIS data follow. The prefix of messages from the user is
+ * kept ready and rebuilt only when its nick or user name changes. Modes are
+ * bits, not a string, and the input buffer of a local user lives in its Link,
+ * so a remote user carries no I/O state at all.
+ */
 class User : public AConnection
 {
 private:
-	std::string	nick_;
-	std::string	username_;
-	std::string realname_;
-	std::string password_;
-	int			mode_;
-	std::string mode_str_;
+	/// Hot
+	Atom		nick_;
+	Atom		host_;
+	std::string	wire_prefix_;	// ":nick!user@host " for messages from the user
+	uint64_t	modes_;		// User modes a-z and A-Z as bits
+	int			mode_;		// Mode mask of USER
 	bool 		operator_;
-	std::string netwideID_;
-	std::string	server_;
-	std::string host_;
-	std::vector<std::string> channels_;
+	/// Cold
+	Atom		username_;
+	Atom		realname_;
+	Atom		server_;
+	std::vector<Atom> channels_;
+
+	static uint64_t	mode_bit		(char mode);
+	void			update_prefix	();
 
 	/// Unused constructors
 	User() : AConnection(0, T_CLIENT,0, 0, 0) {};
@@ -28,34 +43,38 @@ private:
 	User& operator= (const User& other) { std::cout << other.nick(); return *this; };
 
 public:
-	User(const int sock, const std::string& server, const std::string& nick); // Constructor for local user
+	User(const int sock, const std::string& server, const std::string& nick, const std::string& host); // Constructor for local user
 	User(const int sock, const std::string& host, const int hopcount, const int source_sock, int token); // Constructor for external user
 	~User();
 
+	static SlabPool&	pool			();
+	static void*		operator new	(size_t size);
+	static void			operator delete	(void* ptr, size_t size);
+
 	void	set_nick		(const std::string& nick);
 	void	set_username	(const std::string& username);
 	void	set_realname 	(const std::string& realname);
-	void	set_password	(const std::string& password);
 	void	set_mode		(const int mode);
 	void	set_mode_str	(char mode);
 	void 	set_mode_str	(const std::string& mode_str);
 	void	del_mode_str	(char mode);
 	void	set_operator	(bool is_operator);
-	void	set_netwideID	(const std::string& netwideID);
-    void    set_channel     (const std::string& channel);
-    void    del_channel     (const std::string& channel);
+    void    set_channel     (const Atom& channel);
+    void    del_channel     (const Atom& channel);
 
 	const std::string&	nick		() const;
 	const std::string&	username	() const;
 	const std::string&	realname	() const;
-	const std::string&	password	() const;
 	int					mode		() const;
-	const std::string&  mode_str    () const;
+	std::string			mode_str    () const;
+	bool				has_mode	(char mode) const;
 	bool 				is_operator	() const;
-	const std::string&	netwideID	() const;
 	const std::string&	server		() const;
 	const std::string&	host		() const;
-    std::vector<std::string>& channels();
+	std::string			prefix		() const;	// nick!user@host
+	const std::string&	wire_prefix	() const;	// :nick!user@host with a space
+	size_t				footprint	() const;
+    std::vector<Atom>& channels();
 };
 
 
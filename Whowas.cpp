@@ -0,0 +1,75 @@
+
+#include "Whowas.hpp"
+#include "utils.hpp"
+
+Whowas::Whowas(size_t capacity) : ring_(capacity ? capacity : 1), next_(0), size_(0) {}
+
+/**
+ * @description	Changes capacity, remembered nicks are dropped
+ * @param		capacity: entries kept (at least 1)
+ */
+void	Whowas::resize(size_t capacity)
+{
+	if (capacity == 0)
+		capacity = 1;
+	if (capacity == ring_.size())
+		return;
+	std::vector<WhowasEntry>(capacity).swap(ring_);
+	index_.clear();
+	next_ = 0;
+	size_ = 0;
+}
+
+/**
+ * @description	Remembers a departed nick, overwrites the oldest entry when full
+ */
+void	Whowas::add(const std::string& nick, const std::string& username, const std::string& host,
+					const std::string& realname, const std::string& server, time_t time)
+{
+	WhowasEntry& entry = ring_[next_];
+	if (size_ == ring_.size())		// Forget the overwritten entry
+	{
+		typedef std::multimap<std::string, size_t>::iterator index_it;
+		std::pair<index_it, index_it> range = index_.equal_range(entry.folded);
+		for (index_it it = range.first; it != range.second; ++it)
+		{
+			if (it->second == next_)
+			{
+				index_.erase(it);
+				break;
+			}
+		}
+	}
+	else
+		++size_;
+	entry.nick = nick;
+	entry.folded = casefold(nick);
+	entry.username = username;
+	entry.host = host;
+	entry.realname = realname;
+	entry.server = server;
+	entry.time = time;
+	index_.insert(std::make_pair(entry.folded, next_));
+	next_ = (next_ + 1) % ring_.size();
+}
+
+/**
+ * @description	Finds entries of nick, newest first
+ * @param		nick: any case
+ * @param		count: max entries (0 - all)
+ * @param		found: entries are appended here
+ */
+void	Whowas::find(const std::string& nick, size_t count, std::vector<const WhowasEntry*>& found) const
+{
+	typedef std::multimap<std::string, size_t>::const_iterator index_it;
+	std::pair<index_it, index_it> range = index_.equal_range(casefold(nick));
+	size_t added = 0;
+	for (index_it it = range.second; it != range.first && (count == 0 || added < count); ++added)
+	{
+		--it;
+		found.push_back(&ring_[it->second]);
+	}
+}
+
+size_t	Whowas::size		() const { return size_; }
+size_t	Whowas::capacity	() const { return ring_.size(); }
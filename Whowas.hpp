@@ -0,0 +1,50 @@
+
+#ifndef FT_IRC_WHOWAS_HPP
+#define FT_IRC_WHOWAS_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ctime>
+
+#define WHOWAS_DEFAULT_SIZE	1024
+
+struct WhowasEntry
+{
+	std::string	nick;
+	std::string	folded;		// Casefolded nick (index key)
+	std::string	username;
+	std::string	host;
+	std::string	realname;
+	std::string	server;
+	time_t		time;		// When the nick was left
+};
+
+/**
+ * Departed nicks for WHOWAS: a fixed-size ring, the oldest entry is
+ * overwritten, plus an index of slots by casefolded nick.
+ */
+class Whowas
+{
+private:
+	std::vector<WhowasEntry>				ring_;
+	size_t									next_;		// Slot to write next
+	size_t									size_;		// Slots in use
+	std::multimap<std::string, size_t>		index_;		// Equal nicks are kept in insertion order
+
+	Whowas				(const Whowas& other);
+	Whowas&	operator=	(const Whowas& other);
+
+public:
+	explicit Whowas(size_t capacity = WHOWAS_DEFAULT_SIZE);
+
+	void	resize		(size_t capacity);
+	void	add			(const std::string& nick, const std::string& username, const std::string& host,
+						 const std::string& realname, const std::string& server, time_t time);
+	void	find		(const std::string& nick, size_t count, std::vector<const WhowasEntry*>& found) const;
+
+	size_t	size		() const;
+	size_t	capacity	() const;
+};
+
+#endif //FT_IRC_WHOWAS_HPP
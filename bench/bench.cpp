@@ -0,0 +1,401 @@
+
+#include "Irisha.hpp"
+#include "Channel.hpp"
+#include "User.hpp"
+#include "parser.hpp"
+#include "Stats.hpp"
+#include "MaskSet.hpp"
+#include "CidrTrie.hpp"
+#include "SlabPool.hpp"
+
+#include <arpa/inet.h>
+#include "utils.hpp"
+
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <iomanip>
+
+/// Allocation counting
+static unsigned long g_allocs = 0;
+
+void* operator new(size_t size)
+{
+	++g_allocs;
+	void* ptr = malloc(size == 0 ? 1 : size);
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	++g_allocs;
+	void* ptr = malloc(size == 0 ? 1 : size);
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept				{ free(ptr); }
+void operator delete[](void* ptr) noexcept				{ free(ptr); }
+void operator delete(void* ptr, size_t) noexcept		{ free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept		{ free(ptr); }
+
+/// Corpora
+#define BAN_COUNT 1000
+#define ZLINE_COUNT 10000
+struct Corpus
+{
+	std::vector<std::string>	privmsgs;		// Short client lines
+	std::vector<std::string>	server_lines;	// Lines of a server burst (NICK/NJOIN/MODE)
+	std::string					burst;			// The same burst as it arrives from a socket
+	std::string					join_list;		// "#chan1,#chan2,..." JOIN argument
+	Channel*					big_channel;	// Long NAMES reply
+	Channel*					small_channel;
+	User*						joiner;			// Joins and parts big_channel
+	std::vector<User*>			users;
+	MaskSet						bans;			// Channel ban list
+	std::vector<Mask>			ban_masks;		// The same masks for a linear scan
+	std::vector<std::string>	joiners;		// nick!user@host of joining users
+	CidrTrie					zlines;			// Z-lines of /16 to /32 networks
+	std::vector<sockaddr_in>	peers;			// Addresses of accepted sockets
+};
+
+static volatile size_t	g_sink = 0;	// Keeps results alive
+static Corpus			g_corpus;
+
+static std::string	make_nick(size_t i)
+{
+	return "user" + int_to_str(static_cast<int>(i));
+}
+
+static void	prepare_corpus(Corpus& c)
+{
+	static const char* texts[] = { ":hi", ":hello everyone, how is it going?", ":lol",
+		":has anyone seen the latest build logs? the linker step is taking forever again" };
+
+	for (size_t i = 0; i < 64; ++i)
+	{
+		std::string line = ":" + make_nick(i) + " PRIVMSG ";
+		line += (i % 3 == 0) ? make_nick(i + 1) : "#chan" + int_to_str(static_cast<int>(i % 7));
+		line += " " + std::string(texts[i % 4]);
+		c.privmsgs.push_back(line);
+	}
+
+	for (size_t i = 0; i < 300; ++i)
+		c.server_lines.push_back(":irc.irisha.net NICK " + make_nick(i) + " 1 ~" + make_nick(i)
+								 + " 10.0.0." + int_to_str(static_cast<int>(i % 250)) + " 1 +i :Real Name " + make_nick(i));
+	for (size_t i = 0; i < 40; ++i)
+	{
+		std::string njoin = ":irc.irisha.net NJOIN #chan" + int_to_str(static_cast<int>(i)) + " :@" + make_nick(i);
+		for (size_t j = 1; j < 12; ++j)
+			njoin += "," + make_nick((i * 7 + j) % 300);
+		c.server_lines.push_back(njoin);
+		c.server_lines.push_back(":irc.irisha.net MODE #chan" + int_to_str(static_cast<int>(i)) + " +nt");
+	}
+	for (size_t i = 0; i < c.server_lines.size(); ++i)
+		c.burst += c.server_lines[i] + "\r\n";
+
+	for (size_t i = 0; i < 20; ++i)
+		c.join_list += (i ? ",#chan" : "#chan") + int_to_str(static_cast<int>(i));
+
+	c.big_channel = new Channel("#big");
+	c.small_channel = new Channel("#small");
+	for (size_t i = 0; i < 500; ++i)
+	{
+		User* user = new User(U_EXTERNAL_CONNECTION, "10.0.0.1", 1, 4, 1);
+		user->set_nick(make_nick(i));
+		c.users.push_back(user);
+		c.big_channel->addUser(user);
+		if (i % 25 == 0)
+			c.big_channel->addOperators(user);
+		if (i < 8)
+		{
+			c.small_channel->addUser(user);
+			if (i == 0)
+				c.small_channel->addOperators(user);
+		}
+	}
+	c.joiner = new User(U_EXTERNAL_CONNECTION, "10.0.0.1", 1, 4, 1);
+	c.joiner->set_nick("joiner");
+
+	for (size_t i = 0; i < BAN_COUNT; ++i)
+	{
+		std::string n = int_to_str(static_cast<int>(i));
+		std::string mask;
+		if (i % 100 == 99)
+			mask = "*!*spam" + n + "*@*";
+		else if (i % 2 == 0)
+			mask = "bad" + n + "*!*@*";
+		else
+			mask = "*!*@*.pool-" + n + ".example.net";
+		c.bans.add(mask, "op", 0);
+		c.ban_masks.push_back(Mask(mask));
+	}
+	for (size_t i = 0; i < ZLINE_COUNT; ++i)
+		c.zlines.add(int_to_str(static_cast<int>(i % 200 + 1)) + "." + int_to_str(static_cast<int>(i / 200 % 256)) + "."
+					 + int_to_str(static_cast<int>(i * 7 % 256)) + ".0/" + int_to_str(static_cast<int>(16 + i % 17)), CIDR_BAN);
+	for (size_t i = 0; i < 64; ++i)
+	{
+		sockaddr_in peer;
+		memset(&peer, 0, sizeof(peer));
+		peer.sin_family = AF_INET;
+		peer.sin_addr.s_addr = htonl(static_cast<uint32_t>(0x01000000U * (i % 250 + 1) + i * 2654435761U % 0x1000000U));
+		c.peers.push_back(peer);
+	}
+	for (size_t i = 0; i < 64; ++i)
+		c.joiners.push_back(make_nick(i) + "!~" + make_nick(i) + "@host-" + int_to_str(static_cast<int>(i)) + ".isp.example.org");
+}
+
+/// Benchmarks (each function performs one operation)
+static void	bm_parse_msg_privmsg(size_t i)
+{
+	static Command cmd;
+	parse_msg(g_corpus.privmsgs[i % g_corpus.privmsgs.size()], cmd);
+	g_sink += cmd.arguments_.size();
+}
+
+static void	bm_parse_msg_burst_line(size_t i)
+{
+	static Command cmd;
+	parse_msg(g_corpus.server_lines[i % g_corpus.server_lines.size()], cmd);
+	g_sink += cmd.arguments_.size();
+}
+
+static void	bm_next_line_single(size_t i)
+{
+	std::string	line;
+	std::string	buff = g_corpus.privmsgs[i % g_corpus.privmsgs.size()] + "\r\n";
+	size_t		begin = 0;
+	while (next_line(buff, begin, line))
+		g_sink += line.size();
+}
+
+static void	bm_next_line_burst(size_t i)
+{
+	(void)i;
+	std::string	line;
+	size_t		begin = 0;
+	while (next_line(g_corpus.burst, begin, line))
+		g_sink += line.size();
+}
+
+static void	bm_parse_arr_join_list(size_t i)
+{
+	(void)i;
+	std::vector<std::string>	arr;
+	std::string					list = g_corpus.join_list;
+	parse_arr(arr, list, ',');
+	g_sink += arr.size();
+}
+
+static void	bm_rpl_code_to_str(size_t i)
+{
+	static const eReply codes[] = { RPL_WELCOME, RPL_LUSERCLIENT, RPL_NAMREPLY, RPL_ENDOFNAME, RPL_MOTD };
+	g_sink += rpl_code_to_str(codes[i % 5]).size();
+}
+
+static void	bm_int_to_str(size_t i)
+{
+	g_sink += int_to_str(static_cast<int>(i * 7919)).size();
+}
+
+static Arena	g_arena;
+
+static void	bm_numeric_parts(size_t i)
+{
+	ScratchString	line(g_arena);
+	char			digits[3];
+
+	line.reserve(IRC_LINE_MAX);
+	write_code(digits, RPL_LUSERCLIENT);
+	append_parts(line, ":irc.irisha.net ", StringRef(digits, 3), ' ', g_corpus.users[i % 500]->nick(),
+				 " :There are ", static_cast<int>(i), " users on ", 3, " servers");
+	g_sink += line.size();
+	g_arena.reset();
+}
+
+static void	bm_numeric_concat(size_t i)
+{
+	std::string line = ":irc.irisha.net " + rpl_code_to_str(RPL_LUSERCLIENT) + " " + g_corpus.users[i % 500]->nick()
+					   + " :There are " + int_to_str(static_cast<int>(i)) + " users on " + int_to_str(3) + " servers";
+	g_sink += line.size();
+}
+
+static void	bm_bans_indexed(size_t i)
+{
+	g_sink += g_corpus.bans.match(g_corpus.joiners[i % g_corpus.joiners.size()]);
+}
+
+static void	bm_bans_linear(size_t i)
+{
+	const std::string& prefix = g_corpus.joiners[i % g_corpus.joiners.size()];
+	for (size_t j = 0; j < g_corpus.ban_masks.size(); ++j)
+	{
+		if (g_corpus.ban_masks[j].match(prefix))
+		{
+			++g_sink;
+			break;
+		}
+	}
+}
+
+static void	bm_zline_lookup(size_t i)
+{
+	const sockaddr_in& peer = g_corpus.peers[i % g_corpus.peers.size()];
+	g_sink += g_corpus.zlines.lookup(reinterpret_cast<const sockaddr*>(&peer));
+}
+
+#define NAMES_WIDTH 440		// Segment width of a 353 line on a short domain
+
+static void	bm_names_small(size_t i)
+{
+	(void)i;
+	g_corpus.small_channel->invalidateNames();
+	g_sink += g_corpus.small_channel->getNames(NAMES_WIDTH).size();
+}
+
+static void	bm_names_big(size_t i)
+{
+	(void)i;
+	g_corpus.big_channel->invalidateNames();
+	g_sink += g_corpus.big_channel->getNames(NAMES_WIDTH).size();
+}
+
+static void	bm_names_join_part(size_t i)
+{
+	(void)i;
+	Channel* channel = g_corpus.big_channel;
+	channel->addUser(g_corpus.joiner);
+	g_sink += channel->getNames(NAMES_WIDTH).size();
+	channel->delUser(g_corpus.joiner);
+}
+
+static void	bm_histogram_record(size_t i)
+{
+	static Histogram histogram;
+	histogram.record((i * 2654435761UL) % 100000);
+	g_sink += histogram.count();
+}
+
+#define CHURN_OBJECTS	64	// Objects alive at once in churn benchmarks
+
+static void	bm_pool_churn(size_t i)
+{
+	static SlabPool	pool("bench", sizeof(User));
+	void*			objects[CHURN_OBJECTS];
+
+	(void)i;
+	for (size_t n = 0; n < CHURN_OBJECTS; ++n)
+		objects[n] = pool.allocate(sizeof(User));
+	for (size_t n = CHURN_OBJECTS; n > 0; --n)
+		pool.release(objects[n - 1], sizeof(User));
+	g_sink += pool.used();
+}
+
+static void	bm_heap_churn(size_t i)
+{
+	void*	objects[CHURN_OBJECTS];
+
+	(void)i;
+	for (size_t n = 0; n < CHURN_OBJECTS; ++n)
+		objects[n] = ::operator new(sizeof(User));
+	for (size_t n = CHURN_OBJECTS; n > 0; --n)
+		::operator delete(objects[n - 1]);
+	g_sink += CHURN_OBJECTS;
+}
+
+struct Benchmark
+{
+	const char*	name;
+	void		(*run)(size_t);
+	size_t		bytes;	// Input bytes per operation (0 if not applicable)
+};
+
+/**
+ * @description	Returns monotonic time in nanoseconds
+ */
+static double	now_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<double>(ts.tv_sec) * 1e9 + static_cast<double>(ts.tv_nsec);
+}
+
+/**
+ * @description	Runs benchmark until it takes at least min_ns and prints ns/op and allocs/op
+ */
+static void	run_benchmark(const Benchmark& bm, double min_ns)
+{
+	size_t	iterations = 1;
+	double	elapsed = 0;
+	unsigned long	allocs = 0;
+
+	for (size_t i = 0; i < 100; ++i) // Warm up caches and static buffers
+		bm.run(i);
+	while (true)
+	{
+		unsigned long	allocs_before = g_allocs;
+		double			start = now_ns();
+		for (size_t i = 0; i < iterations; ++i)
+			bm.run(i);
+		elapsed = now_ns() - start;
+		allocs = g_allocs - allocs_before;
+		if (elapsed >= min_ns || iterations >= (1UL << 30))
+			break;
+		iterations *= (elapsed < min_ns / 10) ? 10 : 2;
+	}
+	double ns_op = elapsed / static_cast<double>(iterations);
+	std::cout << std::left << std::setw(28) << bm.name << std::right
+			  << std::setw(12) << iterations
+			  << std::setw(14) << std::fixed << std::setprecision(1) << ns_op
+			  << std::setw(14) << std::setprecision(2) << static_cast<double>(allocs) / static_cast<double>(iterations);
+	if (bm.bytes != 0)
+		std::cout << std::setw(12) << std::setprecision(1) << static_cast<double>(bm.bytes) * 1e3 / ns_op;
+	std::cout << std::endl;
+}
+
+/**
+ * Usage: irisha_bench [filter] [min_ms]
+ * Runs every benchmark whose name contains filter
+ */
+int	main(int argc, char* argv[])
+{
+	std::string	filter = (argc > 1) ? argv[1] : "";
+	double		min_ns = (argc > 2) ? atof(argv[2]) * 1e6 : 200 * 1e6;
+
+	prepare_corpus(g_corpus);
+
+	const Benchmark benchmarks[] = {
+		{ "parse_msg/privmsg",		bm_parse_msg_privmsg,		0 },
+		{ "parse_msg/burst_line",	bm_parse_msg_burst_line,	0 },
+		{ "next_line/single",		bm_next_line_single,		0 },
+		{ "next_line/burst",		bm_next_line_burst,			g_corpus.burst.size() },
+		{ "parse_arr/join_list",	bm_parse_arr_join_list,		g_corpus.join_list.size() },
+		{ "rpl_code_to_str",		bm_rpl_code_to_str,			0 },
+		{ "int_to_str",				bm_int_to_str,				0 },
+		{ "numeric/parts",			bm_numeric_parts,			0 },
+		{ "numeric/concat",			bm_numeric_concat,			0 },
+		{ "names/rebuild/8",		bm_names_small,				0 },
+		{ "names/rebuild/500",		bm_names_big,				0 },
+		{ "names/join_part/500",	bm_names_join_part,			0 },
+		{ "bans/indexed/1000",		bm_bans_indexed,			0 },
+		{ "bans/linear/1000",		bm_bans_linear,				0 },
+		{ "zline/lookup/10000",		bm_zline_lookup,			0 },
+		{ "histogram/record",		bm_histogram_record,		0 },
+		{ "pool/churn/64",			bm_pool_churn,				0 },
+		{ "heap/churn/64",			bm_heap_churn,				0 },
+	};
+
+	std::cout << std::left << std::setw(28) << "benchmark" << std::right << std::setw(12) << "iterations"
+			  << std::setw(14) << "ns/op" << std::setw(14) << "allocs/op" << std::setw(12) << "MB/s" << std::endl;
+	for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i)
+	{
+		if (filter.empty() || std::string(benchmarks[i].name).find(filter) != std::string::npos)
+			run_benchmark(benchmarks[i], min_ns);
+	}
+	std::cout << "checksum " << g_sink << std::endl;
+	return 0;
+}
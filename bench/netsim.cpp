@@ -0,0 +1,363 @@
+
+#include "Irisha.hpp"
+#include "utils.hpp"
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+
+/**
+ * In-process IRC network: several Irisha instances linked with socketpairs,
+ * driven by one thread on a virtual clock. Used to measure netjoin bursts and
+ * netsplit cleanup without starting real processes.
+ *
+ * Usage: irisha_netsim [users] [channels] [servers] [topology]
+ *   topology: "chain" (s1-s0, s2-s1, ...) or "star" (every server links to s0)
+ */
+
+static time_t	g_clock;	// Virtual clock shared by all servers
+
+struct Usage
+{
+	double	wall_ms;
+	double	cpu_ms;
+	long	max_rss_kb;
+};
+
+static double	now_ms()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<double>(ts.tv_sec) * 1e3 + static_cast<double>(ts.tv_nsec) / 1e6;
+}
+
+static double	cpu_ms()
+{
+	rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e3 + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e3;
+}
+
+static long	max_rss_kb()
+{
+	rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+	return ru.ru_maxrss / 1024;
+#else
+	return ru.ru_maxrss;
+#endif
+}
+
+/**
+ * Raw server-side peer used to load the network: it registers as a server
+ * and introduces users and channels with NICK/NJOIN lines.
+ */
+class Feeder
+{
+private:
+	int			sock_;
+	std::string	out_;
+	std::string	in_;
+
+public:
+	explicit Feeder(int sock) : sock_(sock)
+	{
+		fcntl(sock_, F_SETFL, O_NONBLOCK);
+	}
+	~Feeder() { close(sock_); }
+
+	void	queue(const std::string& line) { out_ += line + "\r\n"; }
+	bool	idle() const { return out_.empty(); }
+
+	void	pump()
+	{
+		if (!out_.empty())
+		{
+			ssize_t n = send(sock_, out_.data(), out_.size(), MSG_DONTWAIT);
+			if (n > 0)
+				out_.erase(0, static_cast<size_t>(n));
+		}
+		char	buff[65536];
+		ssize_t	n;
+		while ((n = recv(sock_, buff, sizeof(buff), MSG_DONTWAIT)) > 0)
+			in_.append(buff, static_cast<size_t>(n));
+		size_t	end;
+		while ((end = in_.find('\n')) != std::string::npos) // Keep the link alive
+		{
+			std::string line = in_.substr(0, end);
+			in_.erase(0, end + 1);
+			if (line.find(" PING ") != std::string::npos || line.compare(0, 5, "PING ") == 0)
+				queue("PONG feed.irisha.net");
+		}
+	}
+};
+
+class NetSim
+{
+private:
+	std::vector<Irisha*>	servers_;
+	std::vector<int>		link_fds_;	// link_fds_[k]: socket of server k+1 uplink (on the accepting side)
+	Feeder*					feeder_;
+	std::string				dir_;
+
+	std::string	write_config(size_t index)
+	{
+		std::string		path = dir_ + "/s" + int_to_str(static_cast<int>(index)) + ".conf";
+		std::ofstream	conf(path.c_str());
+		conf << "server-domain = s" << index << ".irisha.net\n"
+			 << "welcome-message = netsim\n"
+			 << "oper-password = opsw\n"
+			 << "ping-timeout = 20\n"
+			 << "register-timeout = 20\n"
+			 << "connection-timeout = 120\n"
+			 << "admin-location = netsim\n"
+			 << "admin-info = netsim\n"
+			 << "admin-mail = netsim@irisha.net\n"
+			 << "time-stamps = no\n";
+		return path;
+	}
+
+public:
+	NetSim() : feeder_(nullptr)
+	{
+		char tmpl[] = "/tmp/irisha_netsim_XXXXXX";
+		if (mkdtemp(tmpl) == nullptr)
+			throw std::runtime_error("Can't create temporary directory");
+		dir_ = tmpl;
+	}
+
+	~NetSim()
+	{
+		for (size_t i = 0; i < servers_.size(); ++i)
+		{
+			delete servers_[i];
+			unlink((dir_ + "/s" + int_to_str(static_cast<int>(i)) + ".conf").c_str());
+		}
+		delete feeder_;
+		rmdir(dir_.c_str());
+	}
+
+	Irisha*	add_server()
+	{
+		Irisha* server = new Irisha(write_config(servers_.size()), "pass");
+		servers_.push_back(server);
+		return server;
+	}
+
+	Irisha*	server(size_t i) { return servers_[i]; }
+
+	/**
+	 * @description	Connects server "from" to server "to" (from registers on to)
+	 * @return		socket of the link on the "to" side
+	 */
+	int		link(size_t from, size_t to)
+	{
+		int fds[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+			throw std::runtime_error("socketpair failed");
+		servers_[to]->adopt_connection(fds[0]);
+		servers_[from]->link_server(fds[1], "pass");
+		return fds[0];
+	}
+
+	void	attach_feeder(size_t to)
+	{
+		int fds[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+			throw std::runtime_error("socketpair failed");
+		servers_[to]->adopt_connection(fds[0]);
+		feeder_ = new Feeder(fds[1]);
+		feeder_->queue("PASS pass 0210 IRC|");
+		feeder_->queue("SERVER feed.irisha.net 1 :netsim feeder");
+	}
+
+	Feeder*	feeder() { return feeder_; }
+
+	/**
+	 * @description	Compares maintained counters of every server with a full scan
+	 */
+	bool	check_counters() const
+	{
+		bool consistent = true;
+		for (size_t i = 0; i < servers_.size(); ++i)
+			consistent = servers_[i]->check_counters() && consistent;
+		return consistent;
+	}
+
+	/**
+	 * @description	Runs one iteration of every server (without waiting)
+	 */
+	void	step()
+	{
+		timeval zero;
+		for (size_t i = 0; i < servers_.size(); ++i)
+		{
+			zero.tv_sec = 0;
+			zero.tv_usec = 0;
+			servers_[i]->run_once(&zero);
+		}
+		if (feeder_ != nullptr)
+			feeder_->pump();
+	}
+
+	/**
+	 * @description	Steps the network until servers first..last know expected users and channels
+	 * @return		false if it didn't converge in max_steps
+	 */
+	bool	converge(int users, int channels, size_t max_steps, size_t first, size_t last)
+	{
+		for (size_t n = 0; n < max_steps; ++n)
+		{
+			step();
+			bool done = (feeder_ == nullptr || feeder_->idle());
+			for (size_t i = first; i <= last && done; ++i)
+			{
+				int u, s, c;
+				servers_[i]->network_size(u, s, c);
+				done = (u == users && c == channels);
+			}
+			if (done)
+				return true;
+		}
+		return false;
+	}
+
+	/**
+	 * @description	Advances virtual clock second by second (lets PING/PONG and timeouts run)
+	 */
+	void	advance(int seconds)
+	{
+		for (int i = 0; i < seconds; ++i)
+		{
+			++g_clock;
+			for (int j = 0; j < 20; ++j)
+				step();
+		}
+	}
+};
+
+static NetSim*	g_net = nullptr;
+
+static void	report(const std::string& phase, const Usage& usage, bool ok)
+{
+	if (g_net != nullptr && !g_net->check_counters())
+		ok = false;
+	std::cerr << std::left << std::setw(26) << phase << std::right << std::fixed << std::setprecision(1)
+			  << std::setw(12) << usage.wall_ms << " ms"
+			  << std::setw(12) << usage.cpu_ms << " ms cpu"
+			  << std::setw(10) << usage.max_rss_kb << " KB rss"
+			  << (ok ? "" : "  (did not converge)") << std::endl;
+}
+
+struct Measure
+{
+	double	wall;
+	double	cpu;
+
+	Measure() : wall(now_ms()), cpu(cpu_ms()) {}
+	Usage	stop() const
+	{
+		Usage usage;
+		usage.wall_ms = now_ms() - wall;
+		usage.cpu_ms = cpu_ms() - cpu;
+		usage.max_rss_kb = max_rss_kb();
+		return usage;
+	}
+};
+
+int	main(int argc, char* argv[])
+{
+	int			users		= (argc > 1) ? atoi(argv[1]) : 1000;
+	int			channels	= (argc > 2) ? atoi(argv[2]) : 100;
+	size_t		servers		= (argc > 3) ? static_cast<size_t>(atoi(argv[3])) : 3;
+	std::string	topology	= (argc > 4) ? argv[4] : "chain";
+	size_t		max_steps	= 1000000;
+
+	if (users < 1 || channels < 0 || channels > users || servers < 2)
+	{
+		std::cerr << "Usage: irisha_netsim [users] [channels <= users] [servers >= 2] [chain|star]" << std::endl;
+		return 1;
+	}
+
+	std::ofstream	null_stream("/dev/null");
+	std::streambuf*	out = std::cout.rdbuf(null_stream.rdbuf()); // Servers log every message to stdout
+
+	g_clock = time(nullptr);
+	set_virtual_time(&g_clock);
+	try
+	{
+		NetSim	net;
+		g_net = &net;
+		for (size_t i = 0; i < servers; ++i)
+			net.add_server();
+
+		std::cerr << "netsim: " << users << " users, " << channels << " channels, "
+				  << servers << " servers (" << topology << ")" << std::endl;
+
+		// Load: the feeder introduces users and channels to s0
+		Measure	load;
+		net.attach_feeder(0);
+		for (int i = 0; i < users; ++i)
+		{
+			std::string nick = "u" + int_to_str(i);
+			net.feeder()->queue(":feed.irisha.net NICK " + nick + " 1 ~" + nick + " 10.0." + int_to_str(i / 250 % 250)
+								+ "." + int_to_str(i % 250) + " 1 +i :netsim user");
+		}
+		for (int c = 0; c < channels; ++c)
+		{
+			std::string	members = "@u" + int_to_str(c);
+			for (int m = 1; m < 10; ++m)
+				members += ",u" + int_to_str((c + m * channels) % users);
+			net.feeder()->queue(":feed.irisha.net NJOIN #chan" + int_to_str(c) + " :" + members);
+		}
+		bool ok = net.converge(users, channels, max_steps, 0, 0);
+		report("load s0", load.stop(), ok);
+
+		// Netjoin: every other server links and receives the burst
+		std::vector<int> uplinks;
+		for (size_t i = 1; i < servers; ++i)
+		{
+			Measure join;
+			uplinks.push_back(net.link(i, topology == "star" ? 0 : i - 1));
+			ok = net.converge(users, channels, max_steps, i, i);
+			report("netjoin s" + int_to_str(static_cast<int>(i)), join.stop(), ok);
+		}
+
+		// Idle: PING/PONG rounds on the virtual clock
+		Measure idle;
+		net.advance(60);
+		int u, s, c;
+		net.server(servers - 1)->network_size(u, s, c);
+		report("idle 60s (virtual)", idle.stop(), u == users && c == channels);
+
+		// Netsplit: the last server loses its uplink and drops everything it learned through it
+		Measure split;
+		shutdown(uplinks.back(), SHUT_RDWR);
+		ok = false;
+		for (size_t n = 0; n < max_steps && !ok; ++n)
+		{
+			net.step();
+			net.server(servers - 1)->network_size(u, s, c);
+			ok = (u == 0 && c == 0);
+		}
+		report("netsplit s" + int_to_str(static_cast<int>(servers - 1)), split.stop(), ok);
+		g_net = nullptr;
+	}
+	catch (std::exception& e)
+	{
+		std::cout.rdbuf(out);
+		std::cerr << RED BOLD E_SCULL " ALARM! " << e.what() << " " E_SCULL CLR << std::endl;
+		return 1;
+	}
+	std::cout.rdbuf(out);
+	set_virtual_time(nullptr);
+	return 0;
+}
@@ -0,0 +1,145 @@
+
+#include "format.hpp"
+
+#include <climits>
+#include <cstdio>
+
+/**
+ * @description	Writes decimal digits of num
+ * @param		out: room for DIGITS_MAX characters
+ * @param		num
+ * @return		characters written
+ */
+size_t	write_ulong(char* out, unsigned long num)
+{
+	char	reversed[DIGITS_MAX];
+	size_t	size = 0;
+
+	do
+	{
+		reversed[size++] = static_cast<char>('0' + num % 10);
+		num /= 10;
+	} while (num != 0);
+	for (size_t i = 0; i < size; ++i)
+		out[i] = reversed[size - 1 - i];
+	return size;
+}
+
+size_t	write_long(char* out, long num)
+{
+	if (num >= 0)
+		return write_ulong(out, static_cast<unsigned long>(num));
+	*out = '-';
+	return write_ulong(out + 1, 0UL - static_cast<unsigned long>(num)) + 1;
+}
+
+/**
+ * @description	Writes num like an output stream does (6 significant digits)
+ * @param		out: room for DOUBLE_MAX characters
+ * @param		num
+ * @return		characters written
+ */
+size_t	write_double(char* out, double num)
+{
+	int size = snprintf(out, DOUBLE_MAX, "%g", num);
+	return (size < 0) ? 0 : static_cast<size_t>(size);
+}
+
+/**
+ * @description	Writes three digits of reply code
+ * @param		out: room for 3 characters
+ * @param		code
+ */
+void	write_code(char* out, int code)
+{
+	out[0] = static_cast<char>('0' + code / 100 % 10);
+	out[1] = static_cast<char>('0' + code / 10 % 10);
+	out[2] = static_cast<char>('0' + code % 10);
+}
+
+/**
+ * @description	Parses decimal number with optional sign
+ * @param		str: nothing but the number
+ * @param		value: result, untouched on failure
+ * @return		false if str is empty, has other characters or overflows long
+ */
+bool	parse_long(const std::string& str, long& value)
+{
+	size_t			i = 0;
+	bool			negative = false;
+	unsigned long	limit = LONG_MAX;
+	unsigned long	result = 0;
+
+	if (i < str.size() && (str[i] == '-' || str[i] == '+'))
+		negative = (str[i++] == '-');
+	if (negative)
+		limit = static_cast<unsigned long>(LONG_MAX) + 1;
+	if (i == str.size())
+		return false;
+	for (; i < str.size(); ++i)
+	{
+		if (str[i] < '0' || str[i] > '9')
+			return false;
+		unsigned digit = static_cast<unsigned>(str[i] - '0');
+		if (result > (limit - digit) / 10)
+			return false;
+		result = result * 10 + digit;
+	}
+	value = negative ? static_cast<long>(0UL - result) : static_cast<long>(result);
+	return true;
+}
+
+bool	parse_int(const std::string& str, int& value)
+{
+	long number;
+
+	if (!parse_long(str, number) || number < INT_MIN || number > INT_MAX)
+		return false;
+	value = static_cast<int>(number);
+	return true;
+}
+
+/**
+ * @description	Turns string into int the lenient way: leading spaces are
+ * 				skipped, the number ends at the first other character
+ * @param		str
+ * @return		converted integer, 0 if there are no digits, clamped to int range
+ */
+int str_to_int(const std::string& str)
+{
+	size_t	i = str.find_first_not_of(" \t\n\v\f\r");
+	bool	negative = false;
+	long	number = 0;
+
+	if (i == std::string::npos)
+		return 0;
+	if (str[i] == '-' || str[i] == '+')
+		negative = (str[i++] == '-');
+	for (; i < str.size() && str[i] >= '0' && str[i] <= '9'; ++i)
+	{
+		number = number * 10 + (str[i] - '0');
+		if (number > static_cast<long>(INT_MAX) + 1)
+			break;
+	}
+	if (negative)
+		return (-number < INT_MIN) ? INT_MIN : static_cast<int>(-number);
+	return (number > INT_MAX) ? INT_MAX : static_cast<int>(number);
+}
+
+std::string int_to_str(int num)
+{
+	char digits[DIGITS_MAX];
+	return std::string(digits, write_long(digits, num));
+}
+
+std::string ulong_to_str(unsigned long num)
+{
+	char digits[DIGITS_MAX];
+	return std::string(digits, write_ulong(digits, num));
+}
+
+std::string double_to_str(double num)
+{
+	char digits[DOUBLE_MAX];
+	return std::string(digits, write_double(digits, num));
+}
@@ -0,0 +1,27 @@
+
+#ifndef FT_IRC_FORMAT_HPP
+#define FT_IRC_FORMAT_HPP
+
+#include <cstddef>
+#include <string>
+
+#define DIGITS_MAX		21		// Characters of the longest formatted long with sign
+#define DOUBLE_MAX		32		// Characters of a formatted double
+
+/// Numbers into caller buffers, no streams and no heap
+size_t		write_ulong			(char* out, unsigned long num);
+size_t		write_long			(char* out, long num);
+size_t		write_double		(char* out, double num);
+void		write_code			(char* out, int code);
+
+/// Strict parsing: the whole string has to be a number in range
+bool		parse_long			(const std::string& str, long& value);
+bool		parse_int			(const std::string& str, int& value);
+
+/// Conversions to strings (short numbers fit the string without heap)
+int			str_to_int			(const std::string& str);
+std::string int_to_str          (int num);
+std::string ulong_to_str		(unsigned long num);
+std::string double_to_str		(double num);
+
+#endif //FT_IRC_FORMAT_HPP
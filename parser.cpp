@@ -5,72 +5,98 @@
 #include <cstring>
 #include <sstream>
 
+static bool next_word(const std::string& msg, size_t& pos, size_t& begin, size_t& end)
+{
+    if (pos >= msg.size())
+        return false;
+    begin = pos;
+    end = msg.find(' ', pos);
+    if (end == std::string::npos)
+        end = msg.size();
+    pos = end + 1;
+    return true;
+}
+
 /**
- * @description	Parses command line to Command structure
+ * @description	Parses command line to Command structure. Words are split by single
+ * 				spaces, strings of the previous command are reused, so a line
+ * 				like the last one is parsed without allocations
  * @param		msg: message
  * @param		cmd: Command structure
  */
 void 	parse_msg(const std::string& msg, Command& cmd)
 {
-    std::list<std::string> array;
-    std::istringstream is(msg);
-    std::string s;
+    size_t  pos = 0;
+    size_t  begin = 0;
+    size_t  end = 0;
+    size_t  argc = 0;
 
     cmd.line_ = msg;
     cmd.prefix_.clear();
     cmd.command_.clear();
-    cmd.arguments_.clear();
-    while (std::getline(is, s, ' '))
-        array.push_back(s);
-    if (!array.empty()) {
-        if (array.front()[0] == ':') {
-            cmd.prefix_.append(array.front().erase(0, 1));
-            array.pop_front();
+    if (next_word(msg, pos, begin, end) && msg[begin] == ':')
+    {
+        cmd.prefix_.assign(msg, begin + 1, end - begin - 1);
+        if (!next_word(msg, pos, begin, end))
+            begin = end = msg.size();
+    }
+    cmd.command_.assign(msg, begin, end - begin);
+    while (next_word(msg, pos, begin, end))
+    {
+        if (msg[begin] == ':')  // The trailing argument is the rest of the line (without one ending space)
+        {
+            end = (msg[msg.size() - 1] == ' ') ? msg.size() - 1 : msg.size();
+            pos = msg.size();
         }
-        cmd.command_.append(array.front());
-        if (!array.empty())
-		    array.pop_front();
-		while (!array.empty()) {
-			if (array.front()[0] == ':')
-				break;
-			cmd.arguments_.push_back(array.front());
-			array.pop_front();
-		}
-		s.clear();
-		while (!array.empty())
-		{
-			if (!s.empty())
-				s.append(" ");
-			s.append(array.front());
-			array.pop_front();
-		}
-		if (!s.empty())
-			cmd.arguments_.push_back(s);
+        if (argc < cmd.arguments_.size())
+            cmd.arguments_[argc].assign(msg, begin, end - begin);
+        else
+            cmd.arguments_.push_back(msg.substr(begin, end - begin));
+        ++argc;
     }
+    cmd.arguments_.resize(argc);
 }
 
-void parse_arr_msg(std::deque<std::string>& arr_msg, std::string& buff)
+/**
+ * @description	Takes the next complete line (ending with LF or CRLF) of buffer,
+ * 				empty lines are skipped. Incomplete last line stays in buffer until
+ * 				the rest of it arrives
+ * @param		buff: received data
+ * @param		begin: where to start, moved past the line
+ * @param		line: the line without line ending
+ * @return		false if there is no complete line from begin
+ */
+bool next_line(const std::string& buff, size_t& begin, std::string& line)
 {
-    std::string s;
-    std::istringstream is(buff);
+    size_t end;
 
-    if (buff.find('\n') == std::string::npos)
-        return;
-    while (std::getline(is, s, '\r'))
-        arr_msg.push_back(s);
-    if (!arr_msg.empty())
+    while ((end = buff.find('\n', begin)) != std::string::npos)
     {
-        if (arr_msg.operator[](arr_msg.size() - 1) == "\n")
-            arr_msg.pop_back();
-        std::deque<std::string>::iterator itr = arr_msg.begin();
-        while (itr != arr_msg.end())
+        size_t len = end - begin;
+        if (len > 0 && buff[end - 1] == '\r')
+            --len;
+        if (len > 0)
         {
-            if ((*itr).find('\n') != (*itr).npos)
-                (*itr).erase((*itr).find('\n'), 1);
-            itr++;
+            line.assign(buff, begin, len);
+            begin = end + 1;
+            return true;
         }
+        begin = end + 1;
     }
-    buff.clear();
+    return false;
+}
+
+/**
+ * @description	Finds where the command of line starts (after the prefix)
+ * @param		line
+ * @return		command offset or npos if there is no command
+ */
+size_t command_begin(StringRef line)
+{
+    if (line.size == 0 || line.data[0] != ':')
+        return 0;
+    const char* space = static_cast<const char*>(memchr(line.data, ' ', line.size));
+    return (space == nullptr) ? std::string::npos : space - line.data + 1;
 }
 
 void parse_argv(int argc, char *argv[], std::string& host, int& port_network, std::string& password_network, int& port, std::string& password)
@@ -129,6 +155,28 @@ void    parse_arr(std::vector<std::string>& arr, std::string& str, char sep)
         arr.push_back(s);
 }
 
+/**
+ * @description	Splits str like parse_arr() into a vector of handler temporaries
+ * @param		arr: vector taking memory from the loop arena
+ * @param		str: list separated with sep
+ * @param		sep
+ */
+void    parse_arr(ScratchVector<std::string>& arr, const std::string& str, char sep)
+{
+    size_t begin = 0;
+    size_t end;
+
+    while (begin < str.size())
+    {
+        end = str.find(sep, begin);
+        if (end == std::string::npos)
+            end = str.size();
+        arr.push_back(std::string());
+        arr.back().assign(str, begin, end - begin);
+        begin = end + 1;
+    }
+}
+
 void    parse_arr_list(std::list<std::string>& arr, std::string& str, char sep)
 {
     std::string s;
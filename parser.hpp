@@ -10,8 +10,10 @@
 #include <sstream>
 
 void 	parse_msg(const std::string& msg, Command& cmd);
-void    parse_arr_msg(std::deque<std::string>& arr_msg, std::string& buff);
+bool    next_line(const std::string& buff, size_t& begin, std::string& line);
+size_t  command_begin(StringRef line);
 void    parse_arr(std::vector<std::string>& arr, std::string& str, char sep);
+void    parse_arr(ScratchVector<std::string>& arr, const std::string& str, char sep);
 void    parse_arr_list(std::list<std::string>& arr, std::string& str, char sep);
 void    parse_argv(int argc, char *argv[], std::string& host, int& port_network, std::string& password_network, int& port, std::string& password);
 
@@ -0,0 +1,110 @@
+
+#include "ShmStats.hpp"
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+/**
+ * top-like viewer of the server stats segment (stats-shm setting).
+ * Reads shared memory only, the server never notices it.
+ *
+ * Usage: irisha_top [shm-name] [interval_ms] [count]
+ *   shm-name: defaults to /irisha, count 0 (default) refreshes forever
+ */
+
+static bool	by_sendq(const ShmLink& a, const ShmLink& b)
+{
+	return a.sendq > b.sendq;
+}
+
+static double	rate(uint64_t now, uint64_t before, double seconds)
+{
+	if (seconds <= 0 || now < before)
+		return 0;
+	return static_cast<double>(now - before) / seconds;
+}
+
+static void	show(const ShmSegment& now, const ShmSegment& before, bool clear)
+{
+	double seconds = static_cast<double>(now.updated_usec - before.updated_usec) / 1e6;
+
+	if (clear)
+		std::cout << "\033[H\033[2J";
+	std::cout << std::fixed << std::setprecision(1)
+			  << "irisha pid " << now.pid << ", up " << (time(nullptr) - now.start_time) << " s\n"
+			  << "users   " << std::setw(8) << now.local_clients << " local " << std::setw(8) << now.remote_clients << " remote"
+			  << "   unregistered " << now.unregistered << "\n"
+			  << "servers " << std::setw(8) << now.local_servers << " local " << std::setw(8) << now.remote_servers << " remote"
+			  << "   channels " << now.channels << "\n"
+			  << "msg/s   " << std::setw(10) << rate(now.messages_in, before.messages_in, seconds) << " in "
+			  << std::setw(10) << rate(now.messages_out, before.messages_out, seconds) << " out\n"
+			  << "KB/s    " << std::setw(10) << rate(now.bytes_in, before.bytes_in, seconds) / 1024 << " in "
+			  << std::setw(10) << rate(now.bytes_out, before.bytes_out, seconds) / 1024 << " out"
+			  << "   sendq " << now.sendq_bytes << " B\n"
+			  << "loop    " << std::setw(10) << rate(now.loop_iterations, before.loop_iterations, seconds) << " it/s"
+			  << "   p50 " << now.loop_p50_usec << " us  p99 " << now.loop_p99_usec << " us  max " << now.loop_max_usec
+			  << " us  last " << now.loop_last_usec << " us  overruns " << now.budget_overruns << "\n\n";
+
+	ShmLink links[SHM_STATS_LINKS];
+	uint32_t count = std::min<uint32_t>(now.link_count, SHM_STATS_LINKS);
+	std::copy(now.links, now.links + count, links);
+	std::sort(links, links + count, by_sendq);
+	std::cout << "deepest send queues (" << now.link_total << " sockets)\n"
+			  << std::setw(8) << "socket" << std::setw(8) << "type" << std::setw(14) << "sendq" << "\n";
+	for (uint32_t i = 0; i < count && links[i].sendq != 0; ++i)
+		std::cout << std::setw(8) << links[i].socket << std::setw(8) << (links[i].server ? "server" : "client")
+				  << std::setw(14) << links[i].sendq << "\n";
+	std::cout << std::flush;
+}
+
+int	main(int argc, char* argv[])
+{
+	std::string	name		= (argc > 1) ? argv[1] : "/irisha";
+	long		interval	= (argc > 2) ? atol(argv[2]) : 1000;
+	long		count		= (argc > 3) ? atol(argv[3]) : 0;
+
+	if (name[0] != '/')
+		name = "/" + name;
+	if (interval < 10)
+		interval = 10;
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd == -1)
+	{
+		std::cerr << "irisha_top: can't open " << name << " (is stats-shm set and the server running?)" << std::endl;
+		return 1;
+	}
+	void* memory = mmap(nullptr, sizeof(ShmSegment), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		std::cerr << "irisha_top: can't map " << name << std::endl;
+		return 1;
+	}
+	const ShmSegment*	shared = static_cast<const ShmSegment*>(memory);
+	ShmSegment			before;
+	ShmSegment			now;
+	if (!ShmStats::read(shared, before))
+	{
+		std::cerr << "irisha_top: " << name << " is not an Irisha stats segment" << std::endl;
+		return 1;
+	}
+	bool clear = isatty(STDOUT_FILENO);
+	for (long i = 0; count == 0 || i < count; ++i)
+	{
+		usleep(static_cast<useconds_t>(interval) * 1000);
+		if (!ShmStats::read(shared, now))
+			continue;
+		show(now, before, clear);
+		before = now;
+	}
+	munmap(memory, sizeof(ShmSegment));
+	return 0;
+}
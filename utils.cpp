@@ -4,7 +4,6 @@
 #include <arpa/inet.h>
 
 #include <fstream>
-#include <sstream>
 
 ///	Config
 /**
@@ -60,6 +59,25 @@ std::string get_config_value(const std::string& path, const std::string& setting
 	return value;
 }
 
+/**
+ * @description	The get_config_int() function gets numeric setting value from config file
+ * @param		path: path to config file
+ * @param		setting: setting name
+ * @param		default_value: value of absent setting
+ * @return		setting value
+ * @throw		runtime_error if the value isn't a number
+ */
+int	get_config_int(const std::string& path, const std::string& setting, int default_value)
+{
+	std::string value = get_config_value(path, setting);
+	int			number;
+	if (value.empty())
+		return default_value;
+	if (!parse_int(value, number))
+		throw std::runtime_error("Config error: " + setting + " must be a whole number");
+	return number;
+}
+
 /**
  * @description	The check_config() function checks configuration file for errors
  * @param		path: path to config file
@@ -111,7 +129,7 @@ bool is_a_valid_nick(const std::string& nick)
 	static const std::string numbers = "01234567890";
 	static const std::string special = "_[]\\`^{|}-";
 
-	if (nick.empty() || nick.size() > 9 || !isalpha(nick.front()))
+	if (nick.empty() || nick.size() > NICK_MAX_LEN || !isalpha(nick.front()))
 		return false;
 
 	std::string allowed_symbols = letters + numbers + special;
@@ -122,67 +140,96 @@ bool is_a_valid_nick(const std::string& nick)
 
 ///	Other
 /**
- * @description	Turns string into int
- * @param		str
- * @return		converted integer
+ * @description	Lowercases a char by RFC 1459 casemapping ("[]\\^" are upper case of "{}|~")
+ * @param		c
+ * @return		folded char
  */
-int str_to_int(const std::string& str)
+char fold_char(char c)
 {
-	std::istringstream convert(str);
-	int	number;
+	if (c >= 'A' && c <= '^')
+		return static_cast<char>(c + ('a' - 'A'));
+	return c;
+}
 
-	convert >> number;
-	return number;
+/**
+ * @description	Casefolds nick or channel name (RFC 1459 casemapping)
+ * @param		str
+ * @return		folded copy
+ */
+std::string casefold(const std::string& str)
+{
+	std::string folded(str);
+	for (size_t i = 0; i < folded.size(); ++i)
+		folded[i] = fold_char(folded[i]);
+	return folded;
 }
 
-std::string int_to_str(int num)
+std::ostream&	operator<<(std::ostream& out, const StringRef& str)
 {
-	std::ostringstream str;
+	return out.write(str.data, static_cast<std::streamsize>(str.size));
+}
 
-	str << num;
-	return str.str();
+std::string	rpl_code_to_str(const eReply code)
+{
+	char digits[3];
+	write_code(digits, code);
+	return std::string(digits, 3);
 }
 
-std::string double_to_str(double num)
+std::string	rpl_code_to_str(const eError code)
 {
-	std::ostringstream str;
+	char digits[3];
+	write_code(digits, code);
+	return std::string(digits, 3);
+}
 
-	str << num;
-	return str.str();
+/**
+ * @description	Returns text form of peer address
+ * @param		address: address from accept() or nullptr
+ * @return		IPv4 or IPv6 address, "unknown" if there is no address
+ */
+std::string peer_host(const sockaddr* address)
+{
+	char text[INET6_ADDRSTRLEN];
+	const char* host = nullptr;
+
+	if (address != nullptr && address->sa_family == AF_INET)
+		host = inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in*>(address)->sin_addr, text, sizeof(text));
+	else if (address != nullptr && address->sa_family == AF_INET6)
+		host = inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6*>(address)->sin6_addr, text, sizeof(text));
+	return (host == nullptr) ? "unknown" : host;
 }
 
-std::string	rpl_code_to_str(const eReply code)
+///	Clock
+static const time_t*	g_virtual_clock = nullptr;	// Set by in-process simulations, nullptr means real time
+
+/**
+ * @description	Returns current time (virtual time if it was set with set_virtual_time())
+ * @return		seconds since epoch
+ */
+time_t	get_time()
 {
-	std::ostringstream rpl_code;
-	if (code < 100)
-	{
-		if (code < 10)
-			rpl_code << "0";
-		rpl_code << "0";
-	}
-	rpl_code << code;
-	return rpl_code.str();
+	if (g_virtual_clock != nullptr)
+		return *g_virtual_clock;
+	return time(nullptr);
 }
 
-std::string	rpl_code_to_str(const eError code)
+/**
+ * @description	Makes get_time() read the given clock instead of the system one
+ * @param		clock: pointer to virtual time or nullptr to return to the system clock
+ */
+void	set_virtual_time(const time_t* clock)
 {
-	std::ostringstream rpl_code;
-	if (code < 100)
-	{
-		if (code < 10)
-			rpl_code << "0";
-		rpl_code << "0";
-	}
-	rpl_code << code;
-	return rpl_code.str();
+	g_virtual_clock = clock;
 }
 
-char* get_sock_host(int sock)
+/**
+ * @description	Returns monotonic time for measuring durations (not affected by the virtual clock)
+ * @return		microseconds since an unspecified point
+ */
+unsigned long	get_usec()
 {
-	struct sockaddr_in sock_addr;
-	socklen_t len =  sizeof(sock_addr);
-	if (getsockname(sock, reinterpret_cast<struct sockaddr*>(&sock_addr), &len) != -1)
-		return inet_ntoa(sock_addr.sin_addr);
-	else
-		return nullptr;
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<unsigned long>(ts.tv_sec) * 1000000UL + static_cast<unsigned long>(ts.tv_nsec) / 1000UL;
 }
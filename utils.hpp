@@ -2,7 +2,12 @@
 #ifndef FT_IRC_UTILS_HPP
 #define FT_IRC_UTILS_HPP
 
+#include "format.hpp"
+
 #include <iostream>
+#include <string>
+#include <cstring>
+#include <ctime>
 #include <netdb.h>
 #include <sys/socket.h>
 
@@ -44,6 +49,52 @@
 #define E_CROSS		"❌"
 #define E_SLEEP		"💤"
 
+/// Protocol limits
+#define IRC_LINE_MAX	512		// Message length with CRLF (RFC 2812 2.3)
+#define NICK_MAX_LEN	9
+
+/**
+ * Characters of a string the callee only reads: senders take std::string,
+ * a ScratchString or a literal without copying it
+ */
+struct StringRef
+{
+	const char*	data;
+	size_t		size;
+
+	StringRef(const char* str) : data(str), size(strlen(str)) {}
+	StringRef(const char* str, size_t length) : data(str), size(length) {}
+	template <typename Alloc>
+	StringRef(const std::basic_string<char, std::char_traits<char>, Alloc>& str) : data(str.data()), size(str.size()) {}
+};
+
+std::ostream&	operator<<(std::ostream& out, const StringRef& str);
+
+/**
+ * Writers of outgoing lines: parts are appended to str (std::string or
+ * ScratchString) in the order given, numbers without a temporary string.
+ * append_parts(line, nick, " :", count, " users") is resolved at compile time.
+ */
+template <typename String>
+void	append_part(String& str, StringRef part)	{ str.append(part.data, part.size); }
+template <typename String>
+void	append_part(String& str, char part)			{ str.push_back(part); }
+template <typename String>
+void	append_part(String& str, long part)			{ char digits[DIGITS_MAX]; str.append(digits, write_long(digits, part)); }
+template <typename String>
+void	append_part(String& str, int part)			{ append_part(str, static_cast<long>(part)); }
+template <typename String>
+void	append_part(String& str, unsigned long part){ char digits[DIGITS_MAX]; str.append(digits, write_ulong(digits, part)); }
+template <typename String>
+void	append_part(String& str, unsigned part)		{ append_part(str, static_cast<unsigned long>(part)); }
+
+template <typename String, typename... Parts>
+void	append_parts(String& str, const Parts&... parts)
+{
+	int	expand[] = { 0, (append_part(str, parts), 0)... };
+	(void)expand;
+}
+
 enum eUtils
 {
 	U_EXTERNAL_CONNECTION = -1,
@@ -91,6 +142,7 @@ enum eError
 	ERR_INVITEONLYCHAN		= 473,
 	ERR_BANNEDFROMCHAN		= 474,
 	ERR_BADCHANNELKEY		= 475,
+	ERR_BANLISTFULL			= 478,
 	ERR_NOPRIVILEGES		= 481,
 	ERR_CHANOPRIVSNEEDED	= 482,
 	ERR_CANTKILLSERVER		= 483,
@@ -130,6 +182,7 @@ enum eReply
 	RPL_STATSUPTIME		= 242,
 	RPL_STATSOLINE		= 243,
 	RPL_STATSHLINE		= 244,
+	RPL_STATSDEBUG		= 249,
 	RPL_LUSERCLIENT		= 251,
 	RPL_LUSEROP			= 252,
 	RPL_LUSERUNKNOWN	= 253,
@@ -162,6 +215,10 @@ enum eReply
 	RPL_TOPIC			= 332,
 	RPL_INVITING		= 341,
 	RPL_SUMMONIN		= 342,
+	RPL_INVITELIST		= 346,
+	RPL_ENDOFINVITELIST	= 347,
+	RPL_EXCEPTLIST		= 348,
+	RPL_ENDOFEXCEPTLIST	= 349,
 	RPL_VERSION			= 351,
 	RPL_WHOREPLY		= 352,
 	RPL_NAMREPLY		= 353,
@@ -195,20 +252,51 @@ enum eReply
 #define ADMIN_LOC	"admin-location"
 #define TIME_STAMP	"time-stamps"
 #define OPER_PASS	"oper-password"
+#define HANDLER_BUDGET	"handler-budget"
+#define METRICS_PORT	"metrics-port"
+#define STATS_SHM		"stats-shm"
+#define WHOWAS_SIZE		"whowas-size"
+#define Z_LINES			"z-lines"
+#define Z_EXEMPT		"z-exempt"
+#define LISTEN_BACKLOG	"listen-backlog"
+#define MAX_PER_IP		"max-per-ip"
+#define ACCEPT_RATE		"accept-rate"
+#define ACCEPT_BURST	"accept-burst"
+#define MAX_UNREG		"max-unregistered"
+#define FLOOD_RATE		"flood-rate"
+#define FLOOD_BURST		"flood-burst"
+#define CLIENT_QUANTUM	"client-quantum"
+#define SERVER_QUANTUM	"server-quantum"
+#define CLIENT_SENDQ	"client-sendq"
+#define CLIENT_RECVQ	"client-recvq"
+#define OPER_SENDQ		"oper-sendq"
+#define OPER_RECVQ		"oper-recvq"
+#define SERVER_SENDQ	"server-sendq"
+#define SERVER_RECVQ	"server-recvq"
+#define POOL_USERS		"pool-users"
+#define POOL_SERVERS	"pool-servers"
+#define POOL_CHANNELS	"pool-channels"
+#define POOL_UNREG		"pool-unregistered"
+#define MOTD_FILE		"motd-file"
 //#define PASS	"server-password"
 
 /// Config
 void		remove_comment		(std::string& str);
 void		string_trim			(std::string& str, const std::string& trim_symbols);
 std::string	get_config_value	(const std::string& path, const std::string& setting);
+int			get_config_int		(const std::string& path, const std::string& setting, int default_value);
 void		check_config		(const std::string& path);
 
 /// Other
 bool		is_a_valid_nick		(const std::string& nick);
-int			str_to_int			(const std::string& str);
-std::string int_to_str          (int num);
-std::string double_to_str		(double num);
+char		fold_char			(char c);
+std::string	casefold			(const std::string& str);
 std::string	rpl_code_to_str		(const eReply code);
 std::string	rpl_code_to_str		(const eError code);
-char* 		get_sock_host		(int sock);
+std::string	peer_host			(const sockaddr* address);
+
+/// Clock
+time_t		get_time			();
+void		set_virtual_time	(const time_t* clock);
+unsigned long	get_usec		();
 #endif